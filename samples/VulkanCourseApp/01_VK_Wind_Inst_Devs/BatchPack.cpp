@@ -0,0 +1,441 @@
+#include "BatchPack.h"
+
+#include <cstring>
+
+#include <glm/gtc/packing.hpp>
+
+#include "SimdPacket.h"
+
+
+static const BatchPackKernels &getKernels()
+{
+#ifdef SIMD_X86
+	static const BatchPackKernels &kernels = getCpuSimdLevel() >= SimdLevel::AVX2 ? getBatchPackKernelsAvx2()
+		: getCpuSimdLevel() >= SimdLevel::SSE ? getBatchPackKernelsSse() : getBatchPackKernelsScalar();
+	return kernels;
+#else
+	return getBatchPackKernelsScalar();
+#endif
+}
+
+void packHalfArray(const float *in, size_t count, uint16_t *out)
+{
+	getKernels().packHalf(in, count, out);
+}
+
+void unpackHalfArray(const uint16_t *in, size_t count, float *out)
+{
+	getKernels().unpackHalf(in, count, out);
+}
+
+void packSnorm16Array(const float *in, size_t count, int16_t *out)
+{
+	getKernels().packSnorm16(in, count, out);
+}
+
+void unpackSnorm16Array(const int16_t *in, size_t count, float *out)
+{
+	getKernels().unpackSnorm16(in, count, out);
+}
+
+void packUnorm8Array(const float *in, size_t count, uint8_t *out)
+{
+	getKernels().packUnorm8(in, count, out);
+}
+
+void unpackUnorm8Array(const uint8_t *in, size_t count, float *out)
+{
+	getKernels().unpackUnorm8(in, count, out);
+}
+
+void packSnorm3x10_1x2Array(const glm::vec4 *in, size_t count, uint32_t *out)
+{
+	getKernels().packSnorm3x10_1x2(in, count, out);
+}
+
+void unpackSnorm3x10_1x2Array(const uint32_t *in, size_t count, glm::vec4 *out)
+{
+	getKernels().unpackSnorm3x10_1x2(in, count, out);
+}
+
+void packUnorm3x10_1x2Array(const glm::vec4 *in, size_t count, uint32_t *out)
+{
+	getKernels().packUnorm3x10_1x2(in, count, out);
+}
+
+void unpackUnorm3x10_1x2Array(const uint32_t *in, size_t count, glm::vec4 *out)
+{
+	getKernels().unpackUnorm3x10_1x2(in, count, out);
+}
+
+
+/** -- SCALAR: glm, one value at a time -- **/
+
+static uint32_t floatBits(float f)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+static float bitsFloat(uint32_t bits)
+{
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+// Round to nearest even (glm::packHalf1x16 rounds ties away from zero). Same steps as the SSE version, one lane
+static uint16_t floatToHalf(float f)
+{
+	uint32_t bits = floatBits(f);
+	uint32_t sign = bits & 0x80000000u;
+	bits ^= sign;
+
+	uint32_t half;
+	if (bits >= (127u + 16u) << 23)
+	{
+		half = bits > 0x7F800000u ? 0x7E00u : 0x7C00u;		// NaN (quiet), or too large for a half: infinity
+	}
+	else if (bits < (127u - 14u) << 23)
+	{
+		// Subnormal half: adding 0.5 makes the float adder align and round the mantissa
+		half = floatBits(bitsFloat(bits) + 0.5f) - floatBits(0.5f);
+	}
+	else
+	{
+		// Rebias the exponent, then add just under half an ulp, plus one if the kept mantissa is odd
+		half = (bits + 0xFFFu - ((127u - 15u) << 23) + ((bits >> 13) & 1u)) >> 13;
+	}
+	return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+static void packHalfScalar(const float *in, size_t count, uint16_t *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = floatToHalf(in[i]);
+	}
+}
+
+static void unpackHalfScalar(const uint16_t *in, size_t count, float *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = glm::unpackHalf1x16(in[i]);
+	}
+}
+
+static void packSnorm16Scalar(const float *in, size_t count, int16_t *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = static_cast<int16_t>(glm::packSnorm1x16(in[i]));
+	}
+}
+
+static void unpackSnorm16Scalar(const int16_t *in, size_t count, float *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = glm::unpackSnorm1x16(static_cast<uint16_t>(in[i]));
+	}
+}
+
+static void packUnorm8Scalar(const float *in, size_t count, uint8_t *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = glm::packUnorm1x8(in[i]);
+	}
+}
+
+static void unpackUnorm8Scalar(const uint8_t *in, size_t count, float *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = glm::unpackUnorm1x8(in[i]);
+	}
+}
+
+static void packSnorm3x10_1x2Scalar(const glm::vec4 *in, size_t count, uint32_t *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = glm::packSnorm3x10_1x2(in[i]);
+	}
+}
+
+static void unpackSnorm3x10_1x2Scalar(const uint32_t *in, size_t count, glm::vec4 *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = glm::unpackSnorm3x10_1x2(in[i]);
+	}
+}
+
+static void packUnorm3x10_1x2Scalar(const glm::vec4 *in, size_t count, uint32_t *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = glm::packUnorm3x10_1x2(in[i]);
+	}
+}
+
+static void unpackUnorm3x10_1x2Scalar(const uint32_t *in, size_t count, glm::vec4 *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = glm::unpackUnorm3x10_1x2(in[i]);
+	}
+}
+
+const BatchPackKernels &getBatchPackKernelsScalar()
+{
+	static const BatchPackKernels kernels = {
+		packHalfScalar, unpackHalfScalar, packSnorm16Scalar, unpackSnorm16Scalar, packUnorm8Scalar, unpackUnorm8Scalar,
+		packSnorm3x10_1x2Scalar, unpackSnorm3x10_1x2Scalar, packUnorm3x10_1x2Scalar, unpackUnorm3x10_1x2Scalar };
+	return kernels;
+}
+
+
+#ifdef SIMD_X86
+/** -- SSE2: 4 values per instruction, half conversion with integer math -- **/
+
+static inline __m128 clampSse(__m128 v, float low, float high)
+{
+	return _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(low)), _mm_set1_ps(high));
+}
+
+// std::round of a >= 0 (halfway cases away from zero, like glm): truncate, then add one if the fraction is 0.5 or more
+static inline __m128i roundPositiveSse(__m128 a)
+{
+	__m128i truncated = _mm_cvttps_epi32(a);
+	__m128 fraction = _mm_sub_ps(a, _mm_cvtepi32_ps(truncated));
+	return _mm_sub_epi32(truncated, _mm_castps_si128(_mm_cmpge_ps(fraction, _mm_set1_ps(0.5f))));
+}
+
+static inline __m128i roundSse(__m128 v)
+{
+	__m128 sign = _mm_and_ps(v, _mm_set1_ps(-0.0f));
+	__m128i rounded = roundPositiveSse(_mm_xor_ps(v, sign));
+	__m128i negative = _mm_srai_epi32(_mm_castps_si128(sign), 31);
+	return _mm_sub_epi32(_mm_xor_si128(rounded, negative), negative);
+}
+
+// 2x4 values in the low 16 bits of each lane -> 8 x 16 bits (sign extended first, so the saturating pack keeps them as is)
+static inline __m128i packLow16Sse(__m128i lo, __m128i hi)
+{
+	return _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(lo, 16), 16), _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16));
+}
+
+// Each float to a half in the low 16 bits of its lane, as floatToHalf
+static inline __m128i floatToHalfSse(__m128 f)
+{
+	__m128 sign = _mm_and_ps(f, _mm_set1_ps(-0.0f));
+	__m128 absolute = _mm_xor_ps(f, sign);
+	__m128i bits = _mm_castps_si128(absolute);
+
+	__m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absolute, _mm_set1_ps(0.5f))), _mm_castps_si128(_mm_set1_ps(0.5f)));
+	__m128i odd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+	__m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(bits, _mm_set1_epi32(0xFFF - ((127 - 15) << 23))), odd), 13);
+	__m128i nan = _mm_castps_si128(_mm_cmpunord_ps(absolute, absolute));
+	__m128i special = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(nan, _mm_set1_epi32(0x200)));
+
+	__m128i isSubnormal = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), bits);
+	__m128i isFinite = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), bits);
+	__m128i half = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+	half = _mm_or_si128(_mm_and_si128(isFinite, half), _mm_andnot_si128(isFinite, special));
+	return _mm_or_si128(half, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+}
+
+// Halves in the low 16 bits of each lane to floats: exponent and mantissa shifted into place and rebiased. Subnormals
+// come out as 2^-14 too much, taken off again with a float subtract (which normalizes them); infinity and NaN get the
+// maximum exponent. No step sees a denormal float, those can be a hundred times slower
+static inline __m128 halfToFloatSse(__m128i half)
+{
+	__m128i magnitude = _mm_and_si128(half, _mm_set1_epi32(0x7FFF));
+	__m128i shifted = _mm_slli_epi32(magnitude, 13);
+	__m128i exponent = _mm_and_si128(shifted, _mm_set1_epi32(0x7C00 << 13));
+	__m128i normal = _mm_add_epi32(shifted, _mm_set1_epi32((127 - 15) << 23));
+	__m128i infNan = _mm_add_epi32(normal, _mm_set1_epi32((128 - 16) << 23));
+	__m128i subnormal = _mm_castps_si128(_mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(normal, _mm_set1_epi32(1 << 23))),
+		_mm_castsi128_ps(_mm_set1_epi32((127 - 14) << 23))));
+
+	__m128i isInfNan = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(0x7C00 << 13));
+	__m128i isSubnormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+	__m128i result = _mm_or_si128(_mm_and_si128(isInfNan, infNan), _mm_andnot_si128(isInfNan, normal));
+	result = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, result));
+	return _mm_castsi128_ps(_mm_or_si128(result, _mm_slli_epi32(_mm_xor_si128(half, magnitude), 16)));
+}
+
+static void packHalfSse(const float *in, size_t count, uint16_t *out)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i lo = floatToHalfSse(_mm_loadu_ps(in + i));
+		__m128i hi = floatToHalfSse(_mm_loadu_ps(in + i + 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packLow16Sse(lo, hi));
+	}
+	packHalfScalar(in + i, count - i, out + i);
+}
+
+static void unpackHalfSse(const uint16_t *in, size_t count, float *out)
+{
+	__m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+		_mm_storeu_ps(out + i, halfToFloatSse(_mm_unpacklo_epi16(halves, zero)));
+		_mm_storeu_ps(out + i + 4, halfToFloatSse(_mm_unpackhi_epi16(halves, zero)));
+	}
+	unpackHalfScalar(in + i, count - i, out + i);
+}
+
+static void packSnorm16Sse(const float *in, size_t count, int16_t *out)
+{
+	__m128 scale = _mm_set1_ps(32767.0f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i lo = roundSse(_mm_mul_ps(clampSse(_mm_loadu_ps(in + i), -1.0f, 1.0f), scale));
+		__m128i hi = roundSse(_mm_mul_ps(clampSse(_mm_loadu_ps(in + i + 4), -1.0f, 1.0f), scale));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(lo, hi));
+	}
+	packSnorm16Scalar(in + i, count - i, out + i);
+}
+
+static void unpackSnorm16Sse(const int16_t *in, size_t count, float *out)
+{
+	__m128 scale = _mm_set1_ps(1.0f / 32767.0f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		// Each value into the top half of a lane, then shifted down with its sign
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+		__m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16));
+		__m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16));
+		_mm_storeu_ps(out + i, clampSse(_mm_mul_ps(lo, scale), -1.0f, 1.0f));
+		_mm_storeu_ps(out + i + 4, clampSse(_mm_mul_ps(hi, scale), -1.0f, 1.0f));
+	}
+	unpackSnorm16Scalar(in + i, count - i, out + i);
+}
+
+static void packUnorm8Sse(const float *in, size_t count, uint8_t *out)
+{
+	__m128 scale = _mm_set1_ps(255.0f);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i rounded[4];
+		for (int j = 0; j < 4; j++)
+		{
+			rounded[j] = roundPositiveSse(_mm_mul_ps(clampSse(_mm_loadu_ps(in + i + j * 4), 0.0f, 1.0f), scale));
+		}
+		__m128i words = _mm_packus_epi16(_mm_packs_epi32(rounded[0], rounded[1]), _mm_packs_epi32(rounded[2], rounded[3]));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), words);
+	}
+	packUnorm8Scalar(in + i, count - i, out + i);
+}
+
+static void unpackUnorm8Sse(const uint8_t *in, size_t count, float *out)
+{
+	__m128 scale = _mm_set1_ps(1.0f / 255.0f);
+	__m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+		__m128i words[2] = { _mm_unpacklo_epi8(bytes, zero), _mm_unpackhi_epi8(bytes, zero) };
+		for (int j = 0; j < 2; j++)
+		{
+			_mm_storeu_ps(out + i + j * 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words[j], zero)), scale));
+			_mm_storeu_ps(out + i + j * 8 + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words[j], zero)), scale));
+		}
+	}
+	unpackUnorm8Scalar(in + i, count - i, out + i);
+}
+
+// 4 vec4 at a time, transposed so each register holds one field of all 4
+static void packSnorm3x10_1x2Sse(const glm::vec4 *in, size_t count, uint32_t *out)
+{
+	__m128 scale = _mm_set1_ps(511.0f);
+	__m128i mask = _mm_set1_epi32(0x3FF);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		vec4x4 v;
+		loadVec4(in + i, v);
+		__m128i x = _mm_and_si128(roundSse(_mm_mul_ps(clampSse(v.x.v, -1.0f, 1.0f), scale)), mask);
+		__m128i y = _mm_and_si128(roundSse(_mm_mul_ps(clampSse(v.y.v, -1.0f, 1.0f), scale)), mask);
+		__m128i z = _mm_and_si128(roundSse(_mm_mul_ps(clampSse(v.z.v, -1.0f, 1.0f), scale)), mask);
+		__m128i w = roundSse(clampSse(v.w.v, -1.0f, 1.0f));
+		__m128i packed = _mm_or_si128(_mm_or_si128(x, _mm_slli_epi32(y, 10)), _mm_or_si128(_mm_slli_epi32(z, 20), _mm_slli_epi32(w, 30)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+	}
+	packSnorm3x10_1x2Scalar(in + i, count - i, out + i);
+}
+
+static void unpackSnorm3x10_1x2Sse(const uint32_t *in, size_t count, glm::vec4 *out)
+{
+	__m128 scale = _mm_set1_ps(1.0f / 511.0f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		// Each field to the top of the lane, then shifted down with its sign
+		__m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+		__m128 x = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 22), 22));
+		__m128 y = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 12), 22));
+		__m128 z = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 2), 22));
+		__m128 w = _mm_cvtepi32_ps(_mm_srai_epi32(packed, 30));
+		storeVec4(out + i, vec4x4(clampSse(_mm_mul_ps(x, scale), -1.0f, 1.0f), clampSse(_mm_mul_ps(y, scale), -1.0f, 1.0f),
+			clampSse(_mm_mul_ps(z, scale), -1.0f, 1.0f), clampSse(w, -1.0f, 1.0f)));
+	}
+	unpackSnorm3x10_1x2Scalar(in + i, count - i, out + i);
+}
+
+static void packUnorm3x10_1x2Sse(const glm::vec4 *in, size_t count, uint32_t *out)
+{
+	__m128 scale = _mm_set1_ps(1023.0f);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		vec4x4 v;
+		loadVec4(in + i, v);
+		__m128i x = roundPositiveSse(_mm_mul_ps(clampSse(v.x.v, 0.0f, 1.0f), scale));
+		__m128i y = roundPositiveSse(_mm_mul_ps(clampSse(v.y.v, 0.0f, 1.0f), scale));
+		__m128i z = roundPositiveSse(_mm_mul_ps(clampSse(v.z.v, 0.0f, 1.0f), scale));
+		__m128i w = roundPositiveSse(_mm_mul_ps(clampSse(v.w.v, 0.0f, 1.0f), _mm_set1_ps(3.0f)));
+		__m128i packed = _mm_or_si128(_mm_or_si128(x, _mm_slli_epi32(y, 10)), _mm_or_si128(_mm_slli_epi32(z, 20), _mm_slli_epi32(w, 30)));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+	}
+	packUnorm3x10_1x2Scalar(in + i, count - i, out + i);
+}
+
+static void unpackUnorm3x10_1x2Sse(const uint32_t *in, size_t count, glm::vec4 *out)
+{
+	__m128 scale = _mm_set1_ps(1.0f / 1023.0f);
+	__m128i mask = _mm_set1_epi32(0x3FF);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+		__m128 x = _mm_cvtepi32_ps(_mm_and_si128(packed, mask));
+		__m128 y = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 10), mask));
+		__m128 z = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(packed, 20), mask));
+		__m128 w = _mm_cvtepi32_ps(_mm_srli_epi32(packed, 30));
+		storeVec4(out + i, vec4x4(_mm_mul_ps(x, scale), _mm_mul_ps(y, scale), _mm_mul_ps(z, scale), _mm_mul_ps(w, _mm_set1_ps(1.0f / 3.0f))));
+	}
+	unpackUnorm3x10_1x2Scalar(in + i, count - i, out + i);
+}
+
+const BatchPackKernels &getBatchPackKernelsSse()
+{
+	static const BatchPackKernels kernels = {
+		packHalfSse, unpackHalfSse, packSnorm16Sse, unpackSnorm16Sse, packUnorm8Sse, unpackUnorm8Sse,
+		packSnorm3x10_1x2Sse, unpackSnorm3x10_1x2Sse, packUnorm3x10_1x2Sse, unpackUnorm3x10_1x2Sse };
+	return kernels;
+}
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "CpuFeatures.h"
+
+// Whole array versions of glm/gtc/packing.hpp, for compressing vertex data at load time: AVX2 + F16C (8 values per
+// instruction), SSE2 (4) or one value at a time, whichever the CPU supports (picked at run time).
+// Same bits as the glm functions named below, except packHalfArray: glm rounds ties away from zero, these round them to
+// even like F16C and GPUs do (glm is off by one in the last bit for those). NaNs stay NaNs, their payload may not survive.
+// NOTE: input and output arrays must not overlap
+
+// out[i] = glm::packHalf1x16(in[i])
+void packHalfArray(const float *in, size_t count, uint16_t *out);
+// out[i] = glm::unpackHalf1x16(in[i])
+void unpackHalfArray(const uint16_t *in, size_t count, float *out);
+
+// out[i] = glm::packSnorm1x16(in[i])		(round(clamp(v, -1, 1) * 32767))
+void packSnorm16Array(const float *in, size_t count, int16_t *out);
+// out[i] = glm::unpackSnorm1x16(in[i])
+void unpackSnorm16Array(const int16_t *in, size_t count, float *out);
+
+// out[i] = glm::packUnorm1x8(in[i])		(round(clamp(v, 0, 1) * 255))
+void packUnorm8Array(const float *in, size_t count, uint8_t *out);
+// out[i] = glm::unpackUnorm1x8(in[i])
+void unpackUnorm8Array(const uint8_t *in, size_t count, float *out);
+
+// out[i] = glm::packSnorm3x10_1x2(in[i])	(x in bits 0-9, y 10-19, z 20-29, w 30-31: VK_FORMAT_A2B10G10R10_SNORM_PACK32)
+void packSnorm3x10_1x2Array(const glm::vec4 *in, size_t count, uint32_t *out);
+// out[i] = glm::unpackSnorm3x10_1x2(in[i])
+void unpackSnorm3x10_1x2Array(const uint32_t *in, size_t count, glm::vec4 *out);
+
+// out[i] = glm::packUnorm3x10_1x2(in[i])	(VK_FORMAT_A2B10G10R10_UNORM_PACK32)
+void packUnorm3x10_1x2Array(const glm::vec4 *in, size_t count, uint32_t *out);
+// out[i] = glm::unpackUnorm3x10_1x2(in[i])
+void unpackUnorm3x10_1x2Array(const uint32_t *in, size_t count, glm::vec4 *out);
+
+
+// -- Kernels of one instruction set (the functions above use the best one the CPU has)
+struct BatchPackKernels
+{
+	void (*packHalf)(const float *in, size_t count, uint16_t *out);
+	void (*unpackHalf)(const uint16_t *in, size_t count, float *out);
+	void (*packSnorm16)(const float *in, size_t count, int16_t *out);
+	void (*unpackSnorm16)(const int16_t *in, size_t count, float *out);
+	void (*packUnorm8)(const float *in, size_t count, uint8_t *out);
+	void (*unpackUnorm8)(const uint8_t *in, size_t count, float *out);
+	void (*packSnorm3x10_1x2)(const glm::vec4 *in, size_t count, uint32_t *out);
+	void (*unpackSnorm3x10_1x2)(const uint32_t *in, size_t count, glm::vec4 *out);
+	void (*packUnorm3x10_1x2)(const glm::vec4 *in, size_t count, uint32_t *out);
+	void (*unpackUnorm3x10_1x2)(const uint32_t *in, size_t count, glm::vec4 *out);
+};
+
+const BatchPackKernels &getBatchPackKernelsScalar();
+#ifdef SIMD_X86
+const BatchPackKernels &getBatchPackKernelsSse();
+const BatchPackKernels &getBatchPackKernelsAvx2();
+#endif
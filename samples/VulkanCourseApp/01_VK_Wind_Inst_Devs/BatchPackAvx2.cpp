@@ -0,0 +1,220 @@
+#include "BatchPack.h"
+
+#ifdef SIMD_X86
+#define SIMD_PACKET_AVX2
+#include "SimdPacket.h"
+
+// Only ever called after CPUID said AVX2 + FMA + F16C are there; GCC/Clang need to be allowed to emit them here
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_KERNEL __attribute__((target("avx2,fma,f16c")))
+#else
+#define AVX2_KERNEL
+#endif
+
+
+AVX2_KERNEL static inline __m256 clampAvx2(__m256 v, float low, float high)
+{
+	return _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(low)), _mm256_set1_ps(high));
+}
+
+// std::round of a >= 0, as roundPositiveSse
+AVX2_KERNEL static inline __m256i roundPositiveAvx2(__m256 a)
+{
+	__m256i truncated = _mm256_cvttps_epi32(a);
+	__m256 fraction = _mm256_sub_ps(a, _mm256_cvtepi32_ps(truncated));
+	return _mm256_sub_epi32(truncated, _mm256_castps_si256(_mm256_cmp_ps(fraction, _mm256_set1_ps(0.5f), _CMP_GE_OQ)));
+}
+
+AVX2_KERNEL static inline __m256i roundAvx2(__m256 v)
+{
+	__m256 sign = _mm256_and_ps(v, _mm256_set1_ps(-0.0f));
+	__m256i rounded = roundPositiveAvx2(_mm256_xor_ps(v, sign));
+	__m256i negative = _mm256_srai_epi32(_mm256_castps_si256(sign), 31);
+	return _mm256_sub_epi32(_mm256_xor_si256(rounded, negative), negative);
+}
+
+AVX2_KERNEL static void packHalfAvx2(const float *in, size_t count, uint16_t *out)
+{
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i lo = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+		__m128i hi = _mm256_cvtps_ph(_mm256_loadu_ps(in + i + 8), _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), lo);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8), hi);
+	}
+	_mm256_zeroupper();
+
+	getBatchPackKernelsSse().packHalf(in + i, count - i, out + i);
+}
+
+AVX2_KERNEL static void unpackHalfAvx2(const uint16_t *in, size_t count, float *out)
+{
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i))));
+		_mm256_storeu_ps(out + i + 8, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 8))));
+	}
+	_mm256_zeroupper();
+
+	getBatchPackKernelsSse().unpackHalf(in + i, count - i, out + i);
+}
+
+AVX2_KERNEL static void packSnorm16Avx2(const float *in, size_t count, int16_t *out)
+{
+	__m256 scale = _mm256_set1_ps(32767.0f);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m256i lo = roundAvx2(_mm256_mul_ps(clampAvx2(_mm256_loadu_ps(in + i), -1.0f, 1.0f), scale));
+		__m256i hi = roundAvx2(_mm256_mul_ps(clampAvx2(_mm256_loadu_ps(in + i + 8), -1.0f, 1.0f), scale));
+		// The pack works within 128 bit lanes (lo0-3 hi0-3 lo4-7 hi4-7): put the 64 bit quarters back in order
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+	}
+	_mm256_zeroupper();
+
+	getBatchPackKernelsSse().packSnorm16(in + i, count - i, out + i);
+}
+
+AVX2_KERNEL static void unpackSnorm16Avx2(const int16_t *in, size_t count, float *out)
+{
+	__m256 scale = _mm256_set1_ps(1.0f / 32767.0f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i values = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)));
+		_mm256_storeu_ps(out + i, clampAvx2(_mm256_mul_ps(_mm256_cvtepi32_ps(values), scale), -1.0f, 1.0f));
+	}
+	_mm256_zeroupper();
+
+	getBatchPackKernelsSse().unpackSnorm16(in + i, count - i, out + i);
+}
+
+AVX2_KERNEL static void packUnorm8Avx2(const float *in, size_t count, uint8_t *out)
+{
+	__m256 scale = _mm256_set1_ps(255.0f);
+	// The packs work within 128 bit lanes: dword j holds lanes 0-3 of rounded[j], dword 4 + j its lanes 4-7
+	__m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32)
+	{
+		__m256i rounded[4];
+		for (int j = 0; j < 4; j++)
+		{
+			rounded[j] = roundPositiveAvx2(_mm256_mul_ps(clampAvx2(_mm256_loadu_ps(in + i + j * 8), 0.0f, 1.0f), scale));
+		}
+		__m256i bytes = _mm256_packus_epi16(_mm256_packs_epi32(rounded[0], rounded[1]), _mm256_packs_epi32(rounded[2], rounded[3]));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_permutevar8x32_epi32(bytes, order));
+	}
+	_mm256_zeroupper();
+
+	getBatchPackKernelsSse().packUnorm8(in + i, count - i, out + i);
+}
+
+AVX2_KERNEL static void unpackUnorm8Avx2(const uint8_t *in, size_t count, float *out)
+{
+	__m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i values = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i)));
+		_mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(values), scale));
+	}
+	_mm256_zeroupper();
+
+	getBatchPackKernelsSse().unpackUnorm8(in + i, count - i, out + i);
+}
+
+// 8 vec4 at a time, transposed so each register holds one field of all 8
+AVX2_KERNEL static void packSnorm3x10_1x2Avx2(const glm::vec4 *in, size_t count, uint32_t *out)
+{
+	__m256 scale = _mm256_set1_ps(511.0f);
+	__m256i mask = _mm256_set1_epi32(0x3FF);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		vec4x8 v;
+		loadVec4(in + i, v);
+		__m256i x = _mm256_and_si256(roundAvx2(_mm256_mul_ps(clampAvx2(v.x.v, -1.0f, 1.0f), scale)), mask);
+		__m256i y = _mm256_and_si256(roundAvx2(_mm256_mul_ps(clampAvx2(v.y.v, -1.0f, 1.0f), scale)), mask);
+		__m256i z = _mm256_and_si256(roundAvx2(_mm256_mul_ps(clampAvx2(v.z.v, -1.0f, 1.0f), scale)), mask);
+		__m256i w = roundAvx2(clampAvx2(v.w.v, -1.0f, 1.0f));
+		__m256i packed = _mm256_or_si256(_mm256_or_si256(x, _mm256_slli_epi32(y, 10)),
+			_mm256_or_si256(_mm256_slli_epi32(z, 20), _mm256_slli_epi32(w, 30)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+	}
+	_mm256_zeroupper();
+
+	getBatchPackKernelsSse().packSnorm3x10_1x2(in + i, count - i, out + i);
+}
+
+AVX2_KERNEL static void unpackSnorm3x10_1x2Avx2(const uint32_t *in, size_t count, glm::vec4 *out)
+{
+	__m256 scale = _mm256_set1_ps(1.0f / 511.0f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+		__m256 x = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(packed, 22), 22));
+		__m256 y = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(packed, 12), 22));
+		__m256 z = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(packed, 2), 22));
+		__m256 w = _mm256_cvtepi32_ps(_mm256_srai_epi32(packed, 30));
+		storeVec4(out + i, vec4x8(clampAvx2(_mm256_mul_ps(x, scale), -1.0f, 1.0f), clampAvx2(_mm256_mul_ps(y, scale), -1.0f, 1.0f),
+			clampAvx2(_mm256_mul_ps(z, scale), -1.0f, 1.0f), clampAvx2(w, -1.0f, 1.0f)));
+	}
+	_mm256_zeroupper();
+
+	getBatchPackKernelsSse().unpackSnorm3x10_1x2(in + i, count - i, out + i);
+}
+
+AVX2_KERNEL static void packUnorm3x10_1x2Avx2(const glm::vec4 *in, size_t count, uint32_t *out)
+{
+	__m256 scale = _mm256_set1_ps(1023.0f);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		vec4x8 v;
+		loadVec4(in + i, v);
+		__m256i x = roundPositiveAvx2(_mm256_mul_ps(clampAvx2(v.x.v, 0.0f, 1.0f), scale));
+		__m256i y = roundPositiveAvx2(_mm256_mul_ps(clampAvx2(v.y.v, 0.0f, 1.0f), scale));
+		__m256i z = roundPositiveAvx2(_mm256_mul_ps(clampAvx2(v.z.v, 0.0f, 1.0f), scale));
+		__m256i w = roundPositiveAvx2(_mm256_mul_ps(clampAvx2(v.w.v, 0.0f, 1.0f), _mm256_set1_ps(3.0f)));
+		__m256i packed = _mm256_or_si256(_mm256_or_si256(x, _mm256_slli_epi32(y, 10)),
+			_mm256_or_si256(_mm256_slli_epi32(z, 20), _mm256_slli_epi32(w, 30)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+	}
+	_mm256_zeroupper();
+
+	getBatchPackKernelsSse().packUnorm3x10_1x2(in + i, count - i, out + i);
+}
+
+AVX2_KERNEL static void unpackUnorm3x10_1x2Avx2(const uint32_t *in, size_t count, glm::vec4 *out)
+{
+	__m256 scale = _mm256_set1_ps(1.0f / 1023.0f);
+	__m256i mask = _mm256_set1_epi32(0x3FF);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+		__m256 x = _mm256_cvtepi32_ps(_mm256_and_si256(packed, mask));
+		__m256 y = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(packed, 10), mask));
+		__m256 z = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(packed, 20), mask));
+		__m256 w = _mm256_cvtepi32_ps(_mm256_srli_epi32(packed, 30));
+		storeVec4(out + i, vec4x8(_mm256_mul_ps(x, scale), _mm256_mul_ps(y, scale), _mm256_mul_ps(z, scale),
+			_mm256_mul_ps(w, _mm256_set1_ps(1.0f / 3.0f))));
+	}
+	_mm256_zeroupper();
+
+	getBatchPackKernelsSse().unpackUnorm3x10_1x2(in + i, count - i, out + i);
+}
+
+const BatchPackKernels &getBatchPackKernelsAvx2()
+{
+	static const BatchPackKernels kernels = {
+		packHalfAvx2, unpackHalfAvx2, packSnorm16Avx2, unpackSnorm16Avx2, packUnorm8Avx2, unpackUnorm8Avx2,
+		packSnorm3x10_1x2Avx2, unpackSnorm3x10_1x2Avx2, packUnorm3x10_1x2Avx2, unpackUnorm3x10_1x2Avx2 };
+	return kernels;
+}
+#endif
@@ -0,0 +1,151 @@
+#include "BatchQuat.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/dual_quaternion.hpp>
+
+#include "SimdPacket.h"
+#include "BatchQuatKernels.h"
+
+
+static const BatchQuatKernels &getKernels()
+{
+#ifdef SIMD_X86
+	static const BatchQuatKernels &kernels = getCpuSimdLevel() >= SimdLevel::AVX2 ? getBatchQuatKernelsAvx2() : getBatchQuatKernelsSse();
+	return kernels;
+#else
+	return getBatchQuatKernelsSse();
+#endif
+}
+
+static glm::quat getQuat(const QuatBlock &block, int lane)
+{
+	return glm::quat(block.w[lane], block.x[lane], block.y[lane], block.z[lane]);
+}
+
+static void setQuat(QuatBlock &block, int lane, const glm::quat &q)
+{
+	block.x[lane] = q.x;
+	block.y[lane] = q.y;
+	block.z[lane] = q.z;
+	block.w[lane] = q.w;
+}
+
+void packQuats(const glm::quat *in, size_t count, QuatBlock *out)
+{
+	for (size_t i = 0; i < getQuatBlockCount(count) * 8; i++)
+	{
+		setQuat(out[i / 8], i % 8, i < count ? in[i] : glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	}
+}
+
+void unpackQuats(const QuatBlock *in, size_t count, glm::quat *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = getQuat(in[i / 8], i % 8);
+	}
+}
+
+void packDualQuats(const glm::quat *rotations, const glm::vec3 *translations, size_t count, DualQuatBlock *out)
+{
+	for (size_t i = 0; i < getQuatBlockCount(count) * 8; i++)
+	{
+		glm::dualquat dq = i < count ? glm::dualquat(rotations[i], translations[i]) : glm::dualquat();
+		setQuat(out[i / 8].real, i % 8, dq.real);
+		setQuat(out[i / 8].dual, i % 8, dq.dual);
+	}
+}
+
+void slerpQuats(const QuatBlock *a, const QuatBlock *b, const float *t, QuatBlock *out, size_t blockCount)
+{
+	getKernels().slerpQuats(a, b, t, out, blockCount);
+}
+
+void nlerpQuats(const QuatBlock *a, const QuatBlock *b, const float *t, QuatBlock *out, size_t blockCount)
+{
+	getKernels().nlerpQuats(a, b, t, out, blockCount);
+}
+
+void blendDualQuats(const DualQuatBlock *a, const DualQuatBlock *b, const float *t, DualQuatBlock *out, size_t blockCount)
+{
+	getKernels().blendDualQuats(a, b, t, out, blockCount);
+}
+
+void quatsToMatrices(const QuatBlock *q, size_t count, glm::mat4 *out)
+{
+	getKernels().quatsToMatrices(q, count, out);
+}
+
+void dualQuatsToMatrices(const DualQuatBlock *dq, size_t count, glm::mat4 *out)
+{
+	getKernels().dualQuatsToMatrices(dq, count, out);
+}
+
+
+/** -- SCALAR: plain GLM -- **/
+
+static void slerpQuatsScalar(const QuatBlock *a, const QuatBlock *b, const float *t, QuatBlock *out, size_t blockCount)
+{
+	for (size_t i = 0; i < blockCount * 8; i++)
+	{
+		setQuat(out[i / 8], i % 8, glm::slerp(getQuat(a[i / 8], i % 8), getQuat(b[i / 8], i % 8), t[i]));
+	}
+}
+
+static void nlerpQuatsScalar(const QuatBlock *a, const QuatBlock *b, const float *t, QuatBlock *out, size_t blockCount)
+{
+	for (size_t i = 0; i < blockCount * 8; i++)
+	{
+		glm::quat qa = getQuat(a[i / 8], i % 8);
+		glm::quat qb = getQuat(b[i / 8], i % 8);
+		if (glm::dot(qa, qb) < 0.0f)
+		{
+			qb = -qb;
+		}
+		setQuat(out[i / 8], i % 8, glm::normalize(glm::lerp(qa, qb, t[i])));
+	}
+}
+
+static void blendDualQuatsScalar(const DualQuatBlock *a, const DualQuatBlock *b, const float *t, DualQuatBlock *out, size_t blockCount)
+{
+	for (size_t i = 0; i < blockCount * 8; i++)
+	{
+		glm::dualquat dqa(getQuat(a[i / 8].real, i % 8), getQuat(a[i / 8].dual, i % 8));
+		glm::dualquat dqb(getQuat(b[i / 8].real, i % 8), getQuat(b[i / 8].dual, i % 8));
+		glm::dualquat blended = glm::normalize(glm::lerp(dqa, dqb, t[i]));
+		setQuat(out[i / 8].real, i % 8, blended.real);
+		setQuat(out[i / 8].dual, i % 8, blended.dual);
+	}
+}
+
+static void quatsToMatricesScalar(const QuatBlock *q, size_t count, glm::mat4 *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = glm::mat4_cast(getQuat(q[i / 8], i % 8));
+	}
+}
+
+static void dualQuatsToMatricesScalar(const DualQuatBlock *dq, size_t count, glm::mat4 *out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		glm::quat real = getQuat(dq[i / 8].real, i % 8);
+		glm::quat dual = getQuat(dq[i / 8].dual, i % 8);
+		glm::quat translation = dual * glm::conjugate(real) * 2.0f;
+		out[i] = glm::mat4_cast(real);
+		out[i][3] = glm::vec4(translation.x, translation.y, translation.z, 1.0f);
+	}
+}
+
+const BatchQuatKernels &getBatchQuatKernelsScalar()
+{
+	static const BatchQuatKernels kernels = { slerpQuatsScalar, nlerpQuatsScalar, blendDualQuatsScalar, quatsToMatricesScalar, dualQuatsToMatricesScalar };
+	return kernels;
+}
+
+const BatchQuatKernels &getBatchQuatKernelsSse()
+{
+	static const BatchQuatKernels kernels = { slerpQuatsKernel, nlerpQuatsKernel, blendDualQuatsKernel, quatsToMatricesKernel, dualQuatsToMatricesKernel };
+	return kernels;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "CpuFeatures.h"
+
+// Quaternion and dual quaternion kernels for whole skeletons / crowds: 8 quaternions per packet, AVX2 or 2x SSE
+// (whichever the CPU supports, picked at run time). Data is kept as blocks of 8, component by component, so a block
+// loads straight into packets; pack / unpack convert from and to glm arrays (padding lanes are identity).
+// Results match glm::slerp / nlerp / mat4_cast / dual quaternion blending to about 1e-6.
+
+struct QuatBlock
+{
+	float x[8], y[8], z[8], w[8];
+};
+
+// Rotation (real) and translation (dual) of 8 rigid transforms
+struct DualQuatBlock
+{
+	QuatBlock real, dual;
+};
+
+inline size_t getQuatBlockCount(size_t count)
+{
+	return (count + 7) / 8;
+}
+
+void packQuats(const glm::quat *in, size_t count, QuatBlock *out);
+void unpackQuats(const QuatBlock *in, size_t count, glm::quat *out);
+
+// From rotation + translation, as glm::dualquat(rotation, translation) does
+void packDualQuats(const glm::quat *rotations, const glm::vec3 *translations, size_t count, DualQuatBlock *out);
+
+// t: one weight in [0, 1] per quaternion (getQuatBlockCount(count) * 8 of them), a at 0, b at 1. out may be a or b
+
+// out = glm::slerp(a, b, t): shortest path, constant angular speed
+void slerpQuats(const QuatBlock *a, const QuatBlock *b, const float *t, QuatBlock *out, size_t blockCount);
+
+// out = normalize(glm::lerp(a, b', t)), b' = b or -b, whichever is closer to a: cheaper, speed not constant
+void nlerpQuats(const QuatBlock *a, const QuatBlock *b, const float *t, QuatBlock *out, size_t blockCount);
+
+// Dual quaternion linear blend: glm::normalize(glm::lerp(a, b, t)) (blends rotation and translation together)
+void blendDualQuats(const DualQuatBlock *a, const DualQuatBlock *b, const float *t, DualQuatBlock *out, size_t blockCount);
+
+// out[i] = glm::mat4_cast(q[i]) (unit quaternions)
+void quatsToMatrices(const QuatBlock *q, size_t count, glm::mat4 *out);
+
+// out[i] = rotation and translation of dq[i] (unit dual quaternions), e.g. skinning matrices
+void dualQuatsToMatrices(const DualQuatBlock *dq, size_t count, glm::mat4 *out);
+
+
+// -- Kernels of one instruction set (scalar: the glm functions, one quaternion at a time)
+struct BatchQuatKernels
+{
+	void (*slerpQuats)(const QuatBlock *a, const QuatBlock *b, const float *t, QuatBlock *out, size_t blockCount);
+	void (*nlerpQuats)(const QuatBlock *a, const QuatBlock *b, const float *t, QuatBlock *out, size_t blockCount);
+	void (*blendDualQuats)(const DualQuatBlock *a, const DualQuatBlock *b, const float *t, DualQuatBlock *out, size_t blockCount);
+	void (*quatsToMatrices)(const QuatBlock *q, size_t count, glm::mat4 *out);
+	void (*dualQuatsToMatrices)(const DualQuatBlock *dq, size_t count, glm::mat4 *out);
+};
+
+const BatchQuatKernels &getBatchQuatKernelsScalar();
+const BatchQuatKernels &getBatchQuatKernelsSse();		// 2x SSE per packet (plain C++ off x86)
+#ifdef SIMD_X86
+const BatchQuatKernels &getBatchQuatKernelsAvx2();
+#endif
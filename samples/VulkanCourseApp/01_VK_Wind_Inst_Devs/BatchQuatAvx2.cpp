@@ -0,0 +1,15 @@
+#include "BatchQuat.h"
+
+#ifdef SIMD_X86
+// Only used after CPUID said AVX2 + FMA are there
+#define SIMD_PACKET_AVX2
+#include "SimdPacket.h"
+#include "BatchQuatKernels.h"
+
+
+const BatchQuatKernels &getBatchQuatKernelsAvx2()
+{
+	static const BatchQuatKernels kernels = { slerpQuatsKernel, nlerpQuatsKernel, blendDualQuatsKernel, quatsToMatricesKernel, dualQuatsToMatricesKernel };
+	return kernels;
+}
+#endif
@@ -0,0 +1,180 @@
+#pragma once
+
+// Quaternion kernels, compiled once per instruction set: BatchQuat.cpp (floatx8 == 2x SSE) and BatchQuatAvx2.cpp
+// (floatx8 == AVX). Include after SimdPacket.h; everything in here is private to the including translation unit.
+
+#include <algorithm>
+
+#include <glm/gtc/constants.hpp>
+
+#include "BatchQuat.h"
+
+namespace
+{
+
+SIMD_PACKET_FUNCTION static inline vec4x8 loadQuatBlock(const QuatBlock &block)
+{
+	return vec4x8(floatx8::load(block.x), floatx8::load(block.y), floatx8::load(block.z), floatx8::load(block.w));
+}
+
+SIMD_PACKET_FUNCTION static inline void storeQuatBlock(QuatBlock &block, const vec4x8 &q)
+{
+	q.x.store(block.x);
+	q.y.store(block.y);
+	q.z.store(block.z);
+	q.w.store(block.w);
+}
+
+// Flip the sign of the lanes where the mask is set
+SIMD_PACKET_FUNCTION static inline vec4x8 negateWhere(floatx8 mask, const vec4x8 &q)
+{
+	floatx8 sign = mask & floatx8(-0.0f);
+	return vec4x8(q.x ^ sign, q.y ^ sign, q.z ^ sign, q.w ^ sign);
+}
+
+// sin(x) for 0 <= x <= pi / 2: Taylor series to x^11 (error < 1e-7 over the range)
+SIMD_PACKET_FUNCTION static inline floatx8 sinQuarterTurn(floatx8 x)
+{
+	floatx8 x2 = x * x;
+	floatx8 p = fmadd(x2, floatx8(-1.0f / 39916800.0f), floatx8(1.0f / 362880.0f));
+	p = fmadd(x2, p, floatx8(-1.0f / 5040.0f));
+	p = fmadd(x2, p, floatx8(1.0f / 120.0f));
+	p = fmadd(x2, p, floatx8(-1.0f / 6.0f));
+	p = fmadd(x2, p, floatx8(1.0f));
+	return x * p;
+}
+
+// acos(x) for 0 <= x <= 1: Abramowitz & Stegun 4.4.46 (error < 2e-8 before float rounding)
+SIMD_PACKET_FUNCTION static inline floatx8 acosPositive(floatx8 x)
+{
+	floatx8 p = fmadd(x, floatx8(-0.0012624911f), floatx8(0.0066700901f));
+	p = fmadd(x, p, floatx8(-0.0170881256f));
+	p = fmadd(x, p, floatx8(0.0308918810f));
+	p = fmadd(x, p, floatx8(-0.0501743046f));
+	p = fmadd(x, p, floatx8(0.0889789874f));
+	p = fmadd(x, p, floatx8(-0.2145988016f));
+	p = fmadd(x, p, floatx8(1.5707963050f));
+	return sqrt(max(floatx8(1.0f) - x, floatx8(0.0f))) * p;
+}
+
+// Rotation part of glm::mat4_cast
+SIMD_PACKET_FUNCTION static inline void quatToMatrix(const vec4x8 &q, mat4x8 &m)
+{
+	floatx8 one(1.0f), two(2.0f), zero(0.0f);
+	floatx8 xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	floatx8 xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	floatx8 wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	m.m[0][0] = one - two * (yy + zz);	m.m[0][1] = two * (xy + wz);		m.m[0][2] = two * (xz - wy);		m.m[0][3] = zero;
+	m.m[1][0] = two * (xy - wz);		m.m[1][1] = one - two * (xx + zz);	m.m[1][2] = two * (yz + wx);		m.m[1][3] = zero;
+	m.m[2][0] = two * (xz + wy);		m.m[2][1] = two * (yz - wx);		m.m[2][2] = one - two * (xx + yy);	m.m[2][3] = zero;
+	m.m[3][0] = zero;					m.m[3][1] = zero;					m.m[3][2] = zero;					m.m[3][3] = one;
+}
+
+// Whole blocks straight to out, the last partial one through a temporary
+SIMD_PACKET_FUNCTION static inline void storeMatrixBlock(const mat4x8 &m, size_t first, size_t count, glm::mat4 *out)
+{
+	if (first + 8 <= count)
+	{
+		storeMat4(out + first, m);
+		return;
+	}
+	glm::mat4 tail[8];
+	storeMat4(tail, m);
+	std::copy(tail, tail + (count - first), out + first);
+}
+
+SIMD_PACKET_FUNCTION static void slerpQuatsKernel(const QuatBlock *a, const QuatBlock *b, const float *t, QuatBlock *out, size_t blockCount)
+{
+	floatx8 one(1.0f), zero(0.0f);
+	for (size_t i = 0; i < blockCount; i++)
+	{
+		vec4x8 qa = loadQuatBlock(a[i]);
+		vec4x8 qb = loadQuatBlock(b[i]);
+		floatx8 weight = floatx8::load(t + i * 8);
+
+		// Shortest path: go to -b if that is closer
+		floatx8 cosTheta = dot(qa, qb);
+		floatx8 negative = cosTheta < zero;
+		qb = negateWhere(negative, qb);
+		cosTheta = abs(cosTheta);
+
+		floatx8 angle = acosPositive(min(cosTheta, one));
+		floatx8 inverseSin = one / sinQuarterTurn(angle);
+		floatx8 weightA = sinQuarterTurn((one - weight) * angle) * inverseSin;
+		floatx8 weightB = sinQuarterTurn(weight * angle) * inverseSin;
+
+		// Nearly the same rotation: sin(angle) ~ 0, so blend linearly (like glm::slerp)
+		floatx8 linear = cosTheta > floatx8(1.0f - glm::epsilon<float>());
+		weightA = select(linear, one - weight, weightA);
+		weightB = select(linear, weight, weightB);
+
+		storeQuatBlock(out[i], qa * weightA + qb * weightB);
+	}
+}
+
+SIMD_PACKET_FUNCTION static void nlerpQuatsKernel(const QuatBlock *a, const QuatBlock *b, const float *t, QuatBlock *out, size_t blockCount)
+{
+	floatx8 one(1.0f), zero(0.0f);
+	for (size_t i = 0; i < blockCount; i++)
+	{
+		vec4x8 qa = loadQuatBlock(a[i]);
+		vec4x8 qb = loadQuatBlock(b[i]);
+		floatx8 weight = floatx8::load(t + i * 8);
+
+		qb = negateWhere(dot(qa, qb) < zero, qb);
+		storeQuatBlock(out[i], normalize(qa * (one - weight) + qb * weight));
+	}
+}
+
+SIMD_PACKET_FUNCTION static void blendDualQuatsKernel(const DualQuatBlock *a, const DualQuatBlock *b, const float *t, DualQuatBlock *out,
+	size_t blockCount)
+{
+	floatx8 one(1.0f), zero(0.0f);
+	for (size_t i = 0; i < blockCount; i++)
+	{
+		vec4x8 realA = loadQuatBlock(a[i].real), dualA = loadQuatBlock(a[i].dual);
+		vec4x8 realB = loadQuatBlock(b[i].real), dualB = loadQuatBlock(b[i].dual);
+		floatx8 weight = floatx8::load(t + i * 8);
+
+		// Same hemisphere for both rotations, then normalize by the length of the rotation part
+		floatx8 weightB = select(dot(realA, realB) < zero, -weight, weight);
+		vec4x8 real = realA * (one - weight) + realB * weightB;
+		vec4x8 dual = dualA * (one - weight) + dualB * weightB;
+		floatx8 inverseLength = one / length(real);
+
+		storeQuatBlock(out[i].real, real * inverseLength);
+		storeQuatBlock(out[i].dual, dual * inverseLength);
+	}
+}
+
+SIMD_PACKET_FUNCTION static void quatsToMatricesKernel(const QuatBlock *q, size_t count, glm::mat4 *out)
+{
+	for (size_t i = 0; i * 8 < count; i++)
+	{
+		mat4x8 m;
+		quatToMatrix(loadQuatBlock(q[i]), m);
+		storeMatrixBlock(m, i * 8, count, out);
+	}
+}
+
+SIMD_PACKET_FUNCTION static void dualQuatsToMatricesKernel(const DualQuatBlock *dq, size_t count, glm::mat4 *out)
+{
+	floatx8 two(2.0f);
+	for (size_t i = 0; i * 8 < count; i++)
+	{
+		vec4x8 real = loadQuatBlock(dq[i].real), dual = loadQuatBlock(dq[i].dual);
+		mat4x8 m;
+		quatToMatrix(real, m);
+
+		// Translation: 2 * dual * conjugate(real)
+		vec3x8 realVector = real.xyz(), dualVector = dual.xyz();
+		vec3x8 translation = (dualVector * real.w - realVector * dual.w + cross(realVector, dualVector)) * two;
+		m.m[3][0] = translation.x;
+		m.m[3][1] = translation.y;
+		m.m[3][2] = translation.z;
+		storeMatrixBlock(m, i * 8, count, out);
+	}
+}
+
+}
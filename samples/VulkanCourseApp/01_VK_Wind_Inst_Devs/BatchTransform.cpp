@@ -0,0 +1,170 @@
+#include "BatchTransform.h"
+
+#include "SimdPacket.h"
+
+
+// Below the CPU's level only when capped for benchmarking
+static SimdLevel s_batchLevel = getCpuSimdLevel();
+
+static const BatchTransformKernels &getKernels()
+{
+	switch (s_batchLevel)
+	{
+#ifdef SIMD_X86
+	case SimdLevel::AVX512: return getBatchTransformKernelsAvx512();
+	case SimdLevel::AVX2:	return getBatchTransformKernelsAvx2();
+	case SimdLevel::SSE:	return getBatchTransformKernelsSse();
+#endif
+	default:				return getBatchTransformKernelsScalar();
+	}
+}
+
+void transformPoints(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count)
+{
+	getKernels().transformPoints(m, in, out, count);
+}
+
+void transformVectors(const glm::mat4 &m, const glm::vec4 *in, glm::vec4 *out, size_t count)
+{
+	getKernels().transformVectors(m, in, out, count);
+}
+
+void multiplyMatrices(const glm::mat4 *a, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+	getKernels().multiplyMatrices(a, 1, b, out, count);
+}
+
+void multiplyMatrices(const glm::mat4 &a, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+	getKernels().multiplyMatrices(&a, 0, b, out, count);
+}
+
+void setBatchTransformLevel(SimdLevel level)
+{
+	s_batchLevel = level < getCpuSimdLevel() ? level : getCpuSimdLevel();
+}
+
+SimdLevel getBatchTransformLevel()
+{
+	return s_batchLevel;
+}
+
+
+/** -- SCALAR: plain GLM -- **/
+
+static void transformPointsScalar(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = glm::vec3(m * glm::vec4(in[i], 1.0f));
+	}
+}
+
+static void transformVectorsScalar(const glm::mat4 &m, const glm::vec4 *in, glm::vec4 *out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = m * in[i];
+	}
+}
+
+static void multiplyMatricesScalar(const glm::mat4 *a, size_t aStride, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		out[i] = a[i * aStride] * b[i];
+	}
+}
+
+const BatchTransformKernels &getBatchTransformKernelsScalar()
+{
+	static const BatchTransformKernels kernels = { transformPointsScalar, transformVectorsScalar, multiplyMatricesScalar };
+	return kernels;
+}
+
+
+#ifdef SIMD_X86
+/** -- SSE: one vec4 or matrix column per instruction -- **/
+
+static void transformPointsSse(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count)
+{
+	// 4 points at a time, transposed so every lane does useful work
+	mat4x4p matrix(m);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		vec3x4 points;
+		loadVec3(in + i, points);
+		storeVec3(out + i, transformPoint(matrix, points));
+	}
+
+	__m128 c0 = _mm_loadu_ps(&m[0][0]);
+	__m128 c1 = _mm_loadu_ps(&m[1][0]);
+	__m128 c2 = _mm_loadu_ps(&m[2][0]);
+	__m128 c3 = _mm_loadu_ps(&m[3][0]);
+
+	for (; i < count; i++)
+	{
+		// vec3 is only 12 bytes: load and store the components one by one, never past the end of the array
+		__m128 result = _mm_add_ps(c3, _mm_mul_ps(c0, _mm_set1_ps(in[i].x)));
+		result = _mm_add_ps(result, _mm_mul_ps(c1, _mm_set1_ps(in[i].y)));
+		result = _mm_add_ps(result, _mm_mul_ps(c2, _mm_set1_ps(in[i].z)));
+		_mm_storel_pi(reinterpret_cast<__m64 *>(&out[i].x), result);
+		_mm_store_ss(&out[i].z, _mm_movehl_ps(result, result));
+	}
+}
+
+static void transformVectorsSse(const glm::mat4 &m, const glm::vec4 *in, glm::vec4 *out, size_t count)
+{
+	__m128 c0 = _mm_loadu_ps(&m[0][0]);
+	__m128 c1 = _mm_loadu_ps(&m[1][0]);
+	__m128 c2 = _mm_loadu_ps(&m[2][0]);
+	__m128 c3 = _mm_loadu_ps(&m[3][0]);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		__m128 v = _mm_loadu_ps(&in[i].x);
+		__m128 result = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+		result = _mm_add_ps(result, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+		result = _mm_add_ps(result, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+		result = _mm_add_ps(result, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+		_mm_storeu_ps(&out[i].x, result);
+	}
+}
+
+static void multiplyMatricesSse(const glm::mat4 *a, size_t aStride, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const glm::mat4 &left = a[i * aStride];
+		__m128 a0 = _mm_loadu_ps(&left[0][0]);
+		__m128 a1 = _mm_loadu_ps(&left[1][0]);
+		__m128 a2 = _mm_loadu_ps(&left[2][0]);
+		__m128 a3 = _mm_loadu_ps(&left[3][0]);
+
+		// Load all of b first, so out may be b
+		__m128 b_columns[4];
+		for (int column = 0; column < 4; column++)
+		{
+			b_columns[column] = _mm_loadu_ps(&b[i][column][0]);
+		}
+
+		// Each column of the result is a's columns weighted by one column of b
+		for (int column = 0; column < 4; column++)
+		{
+			__m128 bc = b_columns[column];
+			__m128 result = _mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(0, 0, 0, 0)));
+			result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(1, 1, 1, 1))));
+			result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(2, 2, 2, 2))));
+			result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(3, 3, 3, 3))));
+			_mm_storeu_ps(&out[i][column][0], result);
+		}
+	}
+}
+
+const BatchTransformKernels &getBatchTransformKernelsSse()
+{
+	static const BatchTransformKernels kernels = { transformPointsSse, transformVectorsSse, multiplyMatricesSse };
+	return kernels;
+}
+#endif
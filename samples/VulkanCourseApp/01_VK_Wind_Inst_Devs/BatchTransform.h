@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "CpuFeatures.h"
+
+// Transforms whole arrays by GLM matrices, many elements per instruction: AVX-512 (16 points / 4 vec4 / 1 mat4 at once),
+// AVX2 (8 points / 2 vec4 / 2 columns), SSE (1 vec4 / 1 column) or plain GLM, whichever the CPU supports best
+// (picked at run time). Same results as the scalar glm expressions up to FMA rounding.
+// NOTE: input and output arrays may be the same array, but must not partially overlap
+
+// out[i] = (m * vec4(in[i], 1)).xyz		(points, no perspective divide)
+void transformPoints(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count);
+
+// out[i] = m * in[i]
+void transformVectors(const glm::mat4 &m, const glm::vec4 *in, glm::vec4 *out, size_t count);
+
+// out[i] = a[i] * b[i]
+void multiplyMatrices(const glm::mat4 *a, const glm::mat4 *b, glm::mat4 *out, size_t count);
+
+// out[i] = a * b[i]
+void multiplyMatrices(const glm::mat4 &a, const glm::mat4 *b, glm::mat4 *out, size_t count);
+
+// Cap the level the batch functions use (benchmarks / testing); never goes above getCpuSimdLevel()
+void setBatchTransformLevel(SimdLevel level);
+SimdLevel getBatchTransformLevel();
+
+
+// -- Kernels of one instruction set (aStride: 1 = a is an array, 0 = one matrix for all)
+struct BatchTransformKernels
+{
+	void (*transformPoints)(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count);
+	void (*transformVectors)(const glm::mat4 &m, const glm::vec4 *in, glm::vec4 *out, size_t count);
+	void (*multiplyMatrices)(const glm::mat4 *a, size_t aStride, const glm::mat4 *b, glm::mat4 *out, size_t count);
+};
+
+const BatchTransformKernels &getBatchTransformKernelsScalar();
+#ifdef SIMD_X86
+const BatchTransformKernels &getBatchTransformKernelsSse();
+const BatchTransformKernels &getBatchTransformKernelsAvx2();
+const BatchTransformKernels &getBatchTransformKernelsAvx512();
+#endif
@@ -0,0 +1,89 @@
+#include "BatchTransform.h"
+
+#ifdef SIMD_X86
+#define SIMD_PACKET_AVX2
+#include "SimdPacket.h"
+
+// Only ever called after CPUID said AVX2 + FMA are there; GCC/Clang need to be allowed to emit them here
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX2_KERNEL __attribute__((target("avx2,fma")))
+#else
+#define AVX2_KERNEL
+#endif
+
+
+AVX2_KERNEL static void transformPointsAvx2(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count)
+{
+	mat4x8 matrix(m);		// Every matrix element in all 8 lanes
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		vec3x8 points;
+		loadVec3(in + i, points);
+		storeVec3(out + i, transformPoint(matrix, points));
+	}
+	_mm256_zeroupper();
+
+	getBatchTransformKernelsSse().transformPoints(m, in + i, out + i, count - i);
+}
+
+AVX2_KERNEL static void transformVectorsAvx2(const glm::mat4 &m, const glm::vec4 *in, glm::vec4 *out, size_t count)
+{
+	// Each column in both 128 bit lanes: one vec4 per lane
+	__m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&m[0][0]));
+	__m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&m[1][0]));
+	__m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&m[2][0]));
+	__m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&m[3][0]));
+
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2)
+	{
+		__m256 v = _mm256_loadu_ps(&in[i].x);
+		__m256 result = _mm256_mul_ps(c0, _mm256_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)));
+		result = _mm256_fmadd_ps(c1, _mm256_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), result);
+		result = _mm256_fmadd_ps(c2, _mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), result);
+		result = _mm256_fmadd_ps(c3, _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3)), result);
+		_mm256_storeu_ps(&out[i].x, result);
+	}
+	_mm256_zeroupper();
+
+	getBatchTransformKernelsSse().transformVectors(m, in + i, out + i, count - i);
+}
+
+AVX2_KERNEL static void multiplyMatricesAvx2(const glm::mat4 *a, size_t aStride, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const glm::mat4 &left = a[i * aStride];
+		__m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&left[0][0]));
+		__m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&left[1][0]));
+		__m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&left[2][0]));
+		__m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&left[3][0]));
+
+		// Two columns of b (and of the result) per register; both loaded before storing, so out may be b
+		__m256 b01 = _mm256_loadu_ps(&b[i][0][0]);
+		__m256 b23 = _mm256_loadu_ps(&b[i][2][0]);
+
+		__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, _MM_SHUFFLE(0, 0, 0, 0)));
+		r01 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b01, _MM_SHUFFLE(1, 1, 1, 1)), r01);
+		r01 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b01, _MM_SHUFFLE(2, 2, 2, 2)), r01);
+		r01 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b01, _MM_SHUFFLE(3, 3, 3, 3)), r01);
+
+		__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, _MM_SHUFFLE(0, 0, 0, 0)));
+		r23 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b23, _MM_SHUFFLE(1, 1, 1, 1)), r23);
+		r23 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b23, _MM_SHUFFLE(2, 2, 2, 2)), r23);
+		r23 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b23, _MM_SHUFFLE(3, 3, 3, 3)), r23);
+
+		_mm256_storeu_ps(&out[i][0][0], r01);
+		_mm256_storeu_ps(&out[i][2][0], r23);
+	}
+	_mm256_zeroupper();
+}
+
+const BatchTransformKernels &getBatchTransformKernelsAvx2()
+{
+	static const BatchTransformKernels kernels = { transformPointsAvx2, transformVectorsAvx2, multiplyMatricesAvx2 };
+	return kernels;
+}
+#endif
@@ -0,0 +1,127 @@
+#include "BatchTransform.h"
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+
+// Only ever called after CPUID said AVX-512F is there; GCC/Clang need to be allowed to emit it here
+#if defined(__GNUC__) || defined(__clang__)
+#define AVX512_KERNEL __attribute__((target("avx512f,avx2,fma")))
+#else
+#define AVX512_KERNEL
+#endif
+
+
+// Lanes picked by two-source permutes to (de)interleave 16 packed vec3: first from the first two
+// registers of 16 floats, then the rest from the third (16+ == second source)
+static const int k_deinterleave[3][2][16] = {
+	{ { 0, 3, 6, 9, 12, 15, 18, 21, 24, 27, 30, 0, 0, 0, 0, 0 }, { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 17, 20, 23, 26, 29 } },		// x
+	{ { 1, 4, 7, 10, 13, 16, 19, 22, 25, 28, 31, 0, 0, 0, 0, 0 }, { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 18, 21, 24, 27, 30 } },	// y
+	{ { 2, 5, 8, 11, 14, 17, 20, 23, 26, 29, 0, 0, 0, 0, 0, 0 }, { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 16, 19, 22, 25, 28, 31 } },		// z
+};
+static const int k_interleave[3][2][16] = {
+	{ { 0, 16, 0, 1, 17, 0, 2, 18, 0, 3, 19, 0, 4, 20, 0, 5 }, { 0, 1, 16, 3, 4, 17, 6, 7, 18, 9, 10, 19, 12, 13, 20, 15 } },		// floats 0-15 from x, y / z
+	{ { 21, 0, 6, 22, 0, 7, 23, 0, 8, 24, 0, 9, 25, 0, 10, 26 }, { 0, 21, 2, 3, 22, 5, 6, 23, 8, 9, 24, 11, 12, 25, 14, 15 } },	// floats 16-31
+	{ { 0, 11, 27, 0, 12, 28, 0, 13, 29, 0, 14, 30, 0, 15, 31, 0 }, { 26, 1, 2, 27, 4, 5, 28, 7, 8, 29, 10, 11, 30, 13, 14, 31 } },	// floats 32-47
+};
+
+AVX512_KERNEL static void transformPointsAvx512(const glm::mat4 &m, const glm::vec3 *in, glm::vec3 *out, size_t count)
+{
+	__m512 e[4][3];
+	for (int column = 0; column < 4; column++)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			e[column][row] = _mm512_set1_ps(m[column][row]);
+		}
+	}
+
+	__m512i deinterleave[3][2];
+	__m512i interleave[3][2];
+	for (int j = 0; j < 3; j++)
+	{
+		for (int k = 0; k < 2; k++)
+		{
+			deinterleave[j][k] = _mm512_loadu_si512(k_deinterleave[j][k]);
+			interleave[j][k] = _mm512_loadu_si512(k_interleave[j][k]);
+		}
+	}
+
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		const float *p = &in[i].x;
+		__m512 a = _mm512_loadu_ps(p);
+		__m512 b = _mm512_loadu_ps(p + 16);
+		__m512 c = _mm512_loadu_ps(p + 32);
+
+		__m512 xyz[3];
+		for (int j = 0; j < 3; j++)
+		{
+			xyz[j] = _mm512_permutex2var_ps(_mm512_permutex2var_ps(a, deinterleave[j][0], b), deinterleave[j][1], c);
+		}
+
+		__m512 x = _mm512_fmadd_ps(e[0][0], xyz[0], _mm512_fmadd_ps(e[1][0], xyz[1], _mm512_fmadd_ps(e[2][0], xyz[2], e[3][0])));
+		__m512 y = _mm512_fmadd_ps(e[0][1], xyz[0], _mm512_fmadd_ps(e[1][1], xyz[1], _mm512_fmadd_ps(e[2][1], xyz[2], e[3][1])));
+		__m512 z = _mm512_fmadd_ps(e[0][2], xyz[0], _mm512_fmadd_ps(e[1][2], xyz[1], _mm512_fmadd_ps(e[2][2], xyz[2], e[3][2])));
+
+		float *o = &out[i].x;
+		for (int j = 0; j < 3; j++)
+		{
+			_mm512_storeu_ps(o + 16 * j, _mm512_permutex2var_ps(_mm512_permutex2var_ps(x, interleave[j][0], y), interleave[j][1], z));
+		}
+	}
+	_mm256_zeroupper();
+
+	getBatchTransformKernelsAvx2().transformPoints(m, in + i, out + i, count - i);
+}
+
+AVX512_KERNEL static void transformVectorsAvx512(const glm::mat4 &m, const glm::vec4 *in, glm::vec4 *out, size_t count)
+{
+	// Each column in all four 128 bit lanes: one vec4 per lane
+	__m512 c0 = _mm512_broadcast_f32x4(_mm_loadu_ps(&m[0][0]));
+	__m512 c1 = _mm512_broadcast_f32x4(_mm_loadu_ps(&m[1][0]));
+	__m512 c2 = _mm512_broadcast_f32x4(_mm_loadu_ps(&m[2][0]));
+	__m512 c3 = _mm512_broadcast_f32x4(_mm_loadu_ps(&m[3][0]));
+
+	for (size_t i = 0; i < count; i += 4)
+	{
+		// Last few vectors: masked load/store, so nothing past the end is touched
+		__mmask16 mask = count - i >= 4 ? 0xFFFF : static_cast<__mmask16>((1u << ((count - i) * 4)) - 1);
+
+		__m512 v = _mm512_maskz_loadu_ps(mask, &in[i].x);
+		__m512 result = _mm512_mul_ps(c0, _mm512_permute_ps(v, _MM_SHUFFLE(0, 0, 0, 0)));
+		result = _mm512_fmadd_ps(c1, _mm512_permute_ps(v, _MM_SHUFFLE(1, 1, 1, 1)), result);
+		result = _mm512_fmadd_ps(c2, _mm512_permute_ps(v, _MM_SHUFFLE(2, 2, 2, 2)), result);
+		result = _mm512_fmadd_ps(c3, _mm512_permute_ps(v, _MM_SHUFFLE(3, 3, 3, 3)), result);
+		_mm512_mask_storeu_ps(&out[i].x, mask, result);
+	}
+	_mm256_zeroupper();
+}
+
+AVX512_KERNEL static void multiplyMatricesAvx512(const glm::mat4 *a, size_t aStride, const glm::mat4 *b, glm::mat4 *out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const glm::mat4 &left = a[i * aStride];
+		__m512 a0 = _mm512_broadcast_f32x4(_mm_loadu_ps(&left[0][0]));
+		__m512 a1 = _mm512_broadcast_f32x4(_mm_loadu_ps(&left[1][0]));
+		__m512 a2 = _mm512_broadcast_f32x4(_mm_loadu_ps(&left[2][0]));
+		__m512 a3 = _mm512_broadcast_f32x4(_mm_loadu_ps(&left[3][0]));
+
+		// Whole of b in one register, one column per lane: the full product in 4 multiply-adds
+		__m512 bm = _mm512_loadu_ps(&b[i][0][0]);
+		__m512 result = _mm512_mul_ps(a0, _mm512_permute_ps(bm, _MM_SHUFFLE(0, 0, 0, 0)));
+		result = _mm512_fmadd_ps(a1, _mm512_permute_ps(bm, _MM_SHUFFLE(1, 1, 1, 1)), result);
+		result = _mm512_fmadd_ps(a2, _mm512_permute_ps(bm, _MM_SHUFFLE(2, 2, 2, 2)), result);
+		result = _mm512_fmadd_ps(a3, _mm512_permute_ps(bm, _MM_SHUFFLE(3, 3, 3, 3)), result);
+		_mm512_storeu_ps(&out[i][0][0], result);
+	}
+	_mm256_zeroupper();
+}
+
+const BatchTransformKernels &getBatchTransformKernelsAvx512()
+{
+	static const BatchTransformKernels kernels = { transformPointsAvx512, transformVectorsAvx512, multiplyMatricesAvx512 };
+	return kernels;
+}
+#endif
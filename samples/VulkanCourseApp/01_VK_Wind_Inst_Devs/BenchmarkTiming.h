@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+// Timing shared by the benchmark programs (CpuBenchmark, GlmBenchmark)
+using BenchmarkClock = std::chrono::high_resolution_clock;
+
+// Milliseconds from start to now, for one-off timings
+inline double millisecondsSince(BenchmarkClock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+}
+
+// Shortest of runs calls of kernel, in seconds: the run least disturbed by other threads, interrupts and cold caches.
+// A template rather than std::function, so the call inlines and isn't part of what is measured
+template <typename Kernel>
+double bestTime(int runs, Kernel &&kernel)
+{
+	double best = std::numeric_limits<double>::max();
+	for (int run = 0; run < runs; run++)
+	{
+		auto start = BenchmarkClock::now();
+		kernel();
+		best = std::min(best, std::chrono::duration<double>(BenchmarkClock::now() - start).count());
+	}
+	return best;
+}
@@ -0,0 +1,257 @@
+#include "BindlessDescriptors.h"
+
+#include <algorithm>
+
+
+BindlessDescriptors::BindlessDescriptors()
+{
+}
+
+bool BindlessDescriptors::getDeviceFeatures(VkPhysicalDevice physicalDevice, VkPhysicalDeviceVulkan12Features &enabledFeatures)
+{
+	enabledFeatures = {};
+	enabledFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	// VkPhysicalDeviceVulkan12Features only exists on VK 1.2 devices
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	if (deviceProperties.apiVersion < VK_API_VERSION_1_2)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceVulkan12Features supported = {};
+	supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &supported;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+	if (!supported.descriptorIndexing || !supported.runtimeDescriptorArray ||
+		!supported.descriptorBindingPartiallyBound || !supported.descriptorBindingVariableDescriptorCount ||
+		!supported.descriptorBindingStorageBufferUpdateAfterBind || !supported.descriptorBindingSampledImageUpdateAfterBind ||
+		!supported.shaderStorageBufferArrayNonUniformIndexing || !supported.shaderSampledImageArrayNonUniformIndexing)
+	{
+		return false;
+	}
+
+	enabledFeatures.descriptorIndexing = VK_TRUE;
+	enabledFeatures.runtimeDescriptorArray = VK_TRUE;								// buffers[], textures[] in shaders
+	enabledFeatures.descriptorBindingPartiallyBound = VK_TRUE;						// Unused slots may stay unwritten
+	enabledFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;				// Size of the last array picked at allocation
+	enabledFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;		// Add resources while the set is bound
+	enabledFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	enabledFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;			// Index may differ within a draw (nonuniformEXT)
+	enabledFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	return true;
+}
+
+void BindlessDescriptors::init(VkPhysicalDevice physicalDevice, VkDevice newDevice, uint32_t maxStorageBuffers, uint32_t maxSampledImages)
+{
+	m_device = newDevice;
+
+	// Arrays can't be larger than the device allows for update-after-bind sets
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+	VkPhysicalDeviceProperties2 deviceProperties = {};
+	deviceProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	deviceProperties.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties);
+
+	m_storageBuffers.capacity = std::min({ maxStorageBuffers,
+		indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+	m_sampledImages.capacity = std::min({ maxSampledImages,
+		indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages });
+
+	/** -- SET LAYOUT -- **/
+	std::vector<VkDescriptorSetLayoutBinding> &bindings = m_bindings;
+	bindings.assign(2, VkDescriptorSetLayoutBinding{});
+	bindings[0].binding = k_storageBufferBinding;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[0].descriptorCount = m_storageBuffers.capacity;
+	bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+
+	bindings[1].binding = k_sampledImageBinding;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[1].descriptorCount = m_sampledImages.capacity;					// Upper bound, actual count given at allocation
+	bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+	VkDescriptorBindingFlags bindingFlags[2] = {
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
+	};
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo = {};
+	bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	bindingFlagsCreateInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+	layoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	VkResult result = vkCreateDescriptorSetLayout(m_device, &layoutCreateInfo, nullptr, &m_setLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the BINDLESS DESCRIPTOR SET LAYOUT!");
+	}
+
+	/** -- POOL -- **/
+	// Just enough for the one global set
+	VkDescriptorPoolSize poolSizes[2] = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[0].descriptorCount = m_storageBuffers.capacity;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[1].descriptorCount = m_sampledImages.capacity;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = 2;
+	poolCreateInfo.pPoolSizes = poolSizes;
+
+	result = vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_descriptorPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the BINDLESS DESCRIPTOR POOL!");
+	}
+
+	/** -- SET -- **/
+	VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo = {};
+	variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+	variableCountInfo.descriptorSetCount = 1;
+	variableCountInfo.pDescriptorCounts = &m_sampledImages.capacity;
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.pNext = &variableCountInfo;
+	setAllocInfo.descriptorPool = m_descriptorPool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &m_setLayout;
+
+	result = vkAllocateDescriptorSets(m_device, &setAllocInfo, &m_set);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate the BINDLESS DESCRIPTOR SET!");
+	}
+}
+
+uint32_t BindlessDescriptors::addStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint32_t index = m_storageBuffers.allocate();
+
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_set;
+	write.dstBinding = k_storageBufferBinding;
+	write.dstArrayElement = index;								// Slot in the array
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.descriptorCount = 1;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+	return index;
+}
+
+uint32_t BindlessDescriptors::addSampledImage(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	uint32_t index = m_sampledImages.allocate();
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = imageView;
+	imageInfo.imageLayout = imageLayout;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_set;
+	write.dstBinding = k_sampledImageBinding;
+	write.dstArrayElement = index;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.descriptorCount = 1;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+
+	return index;
+}
+
+void BindlessDescriptors::removeStorageBuffer(uint32_t index)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_storageBuffers.release(index);
+}
+
+void BindlessDescriptors::removeSampledImage(uint32_t index)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_sampledImages.release(index);
+}
+
+VkDescriptorSetLayout BindlessDescriptors::getSetLayout() const
+{
+	return m_setLayout;
+}
+
+VkDescriptorSet BindlessDescriptors::getSet() const
+{
+	return m_set;
+}
+
+const std::vector<VkDescriptorSetLayoutBinding> &BindlessDescriptors::getSetBindings() const
+{
+	return m_bindings;
+}
+
+void BindlessDescriptors::destroy()
+{
+	// Destroying the pool frees the set
+	if (m_descriptorPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+		m_descriptorPool = VK_NULL_HANDLE;
+		m_set = VK_NULL_HANDLE;
+	}
+	if (m_setLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+		m_setLayout = VK_NULL_HANDLE;
+	}
+}
+
+BindlessDescriptors::~BindlessDescriptors()
+{
+}
+
+
+uint32_t BindlessDescriptors::SlotAllocator::allocate()
+{
+	// Reuse removed slots first, so indices stay small
+	if (!freeIndices.empty())
+	{
+		uint32_t index = freeIndices.back();
+		freeIndices.pop_back();
+		return index;
+	}
+	if (nextIndex >= capacity)
+	{
+		throw std::runtime_error("Failed to add a BINDLESS DESCRIPTOR: array is full!");
+	}
+	return nextIndex++;
+}
+
+void BindlessDescriptors::SlotAllocator::release(uint32_t index)
+{
+	freeIndices.push_back(index);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+#include <mutex>
+
+// One global descriptor set for bindless rendering (VK 1.2 descriptor indexing): a large array of storage buffers
+// and one of sampled images. A resource is written into the set once when it is added, and shaders reach it by
+// its index (passed per draw, e.g. in push constants), so a frame binds this single set once.
+// Arrays are partially bound and update-after-bind: adding a resource never invalidates recorded cmd buffers.
+//
+// Matching GLSL (GL_EXT_nonuniform_qualifier):
+//	layout(set = 1, binding = 0) readonly buffer Buffers { ... } buffers[];
+//	layout(set = 1, binding = 1) uniform sampler2D textures[];
+class BindlessDescriptors
+{
+public:
+	static const uint32_t k_storageBufferBinding = 0;
+	static const uint32_t k_sampledImageBinding = 1;		// Last binding, so its array size can be variable
+
+	BindlessDescriptors();
+
+	// Fill the descriptor indexing features to chain into VkDeviceCreateInfo; false if the device can't do bindless
+	static bool getDeviceFeatures(VkPhysicalDevice physicalDevice, VkPhysicalDeviceVulkan12Features &enabledFeatures);
+
+	// Array sizes are clamped to the device's update-after-bind limits
+	void init(VkPhysicalDevice physicalDevice, VkDevice newDevice, uint32_t maxStorageBuffers, uint32_t maxSampledImages);
+
+	// Write the resource into a free slot and return its index
+	uint32_t addStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	uint32_t addSampledImage(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	// Free a slot for reuse
+	// NOTE: no cmd buffer still in flight may use the index (the descriptor is only overwritten by the next add)
+	void removeStorageBuffer(uint32_t index);
+	void removeSampledImage(uint32_t index);
+
+	VkDescriptorSetLayout getSetLayout() const;
+	VkDescriptorSet		  getSet() const;
+
+	// Bindings the set layout was created with (array sizes as clamped by init)
+	const std::vector<VkDescriptorSetLayoutBinding> &getSetBindings() const;
+
+	void destroy();
+
+	~BindlessDescriptors();
+
+private:
+	VkDevice			  m_device = VK_NULL_HANDLE;
+	VkDescriptorPool	  m_descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+	VkDescriptorSet		  m_set = VK_NULL_HANDLE;
+
+	std::vector<VkDescriptorSetLayoutBinding> m_bindings;
+
+	// -- Slots of one array: never used ones from m_nextIndex up, removed ones in m_freeIndices
+	struct SlotAllocator
+	{
+		uint32_t			  capacity = 0;
+		uint32_t			  nextIndex = 0;
+		std::vector<uint32_t> freeIndices;
+
+		uint32_t allocate();
+		void	 release(uint32_t index);
+	};
+
+	SlotAllocator m_storageBuffers;
+	SlotAllocator m_sampledImages;
+	std::mutex	  m_mutex;				// Writes to the set must not race each other
+};
@@ -0,0 +1,101 @@
+#include "CpuFeatures.h"
+
+#ifdef SIMD_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+
+#ifdef SIMD_X86
+static void cpuid(int leaf, int subLeaf, int registers[4])
+{
+#if defined(_MSC_VER)
+	__cpuidex(registers, leaf, subLeaf);
+#else
+	unsigned int eax, ebx, ecx, edx;
+	__cpuid_count(leaf, subLeaf, eax, ebx, ecx, edx);
+	registers[0] = static_cast<int>(eax);
+	registers[1] = static_cast<int>(ebx);
+	registers[2] = static_cast<int>(ecx);
+	registers[3] = static_cast<int>(edx);
+#endif
+}
+
+// Register state the OS saves on context switch (XCR0)
+static unsigned long long xgetbv()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+static SimdLevel detectSimdLevel()
+{
+	int registers[4];
+	cpuid(0, 0, registers);
+	int maxLeaf = registers[0];
+
+	cpuid(1, 0, registers);
+	bool sse2 = (registers[3] & (1 << 26)) != 0;
+	bool fma = (registers[2] & (1 << 12)) != 0;
+	bool osxsave = (registers[2] & (1 << 27)) != 0;
+	bool avx = (registers[2] & (1 << 28)) != 0;
+	bool f16c = (registers[2] & (1 << 29)) != 0;
+	if (!sse2)
+	{
+		return SimdLevel::Scalar;
+	}
+
+	// CPU support alone isn't enough: the OS must also save the wider registers (YMM, and ZMM + mask registers)
+	unsigned long long enabledState = osxsave ? xgetbv() : 0;
+	bool osYmm = (enabledState & 0x06) == 0x06;
+	bool osZmm = (enabledState & 0xE6) == 0xE6;
+
+	bool avx2 = false;
+	bool avx512 = false;
+	if (maxLeaf >= 7)
+	{
+		cpuid(7, 0, registers);
+		avx2 = (registers[1] & (1 << 5)) != 0;
+		avx512 = (registers[1] & (1 << 16)) != 0;
+	}
+
+	if (avx512 && avx2 && fma && f16c && osZmm)
+	{
+		return SimdLevel::AVX512;
+	}
+	if (avx2 && avx && fma && f16c && osYmm)
+	{
+		return SimdLevel::AVX2;
+	}
+	return SimdLevel::SSE;
+}
+#endif
+
+SimdLevel getCpuSimdLevel()
+{
+#ifdef SIMD_X86
+	static const SimdLevel level = detectSimdLevel();
+	return level;
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+const char *getSimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::SSE:	return "SSE";
+	case SimdLevel::AVX2:	return "AVX2";
+	case SimdLevel::AVX512: return "AVX-512";
+	default:				return "scalar";
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// x86 builds get the SSE / AVX2 / AVX-512 kernels; anything else only the scalar ones
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#endif
+
+// Widest instruction set a batch kernel may use, in increasing order
+enum class SimdLevel
+{
+	Scalar,
+	SSE,			// SSE2: every x86-64 CPU
+	AVX2,			// AVX2 + FMA + F16C (half float conversion)
+	AVX512			// AVX-512F
+};
+
+// Best level this CPU and OS support (detected once, with CPUID and XGETBV)
+SimdLevel getCpuSimdLevel();
+
+const char *getSimdLevelName(SimdLevel level);
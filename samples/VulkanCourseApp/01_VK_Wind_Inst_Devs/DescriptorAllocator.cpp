@@ -0,0 +1,123 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+
+
+const uint32_t DescriptorAllocator::k_maxSetsPerPool;
+
+DescriptorAllocator::DescriptorAllocator()
+{
+}
+
+void DescriptorAllocator::init(VkDevice newDevice, uint32_t initialSets, const std::vector<DescriptorPoolRatio> &ratios)
+{
+	m_device = newDevice;
+	m_ratios = ratios;
+	m_setsPerPool = std::max(initialSets, 1u);
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout setLayout)
+{
+	if (m_currentPool == VK_NULL_HANDLE)
+	{
+		m_currentPool = takePool();
+	}
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = m_currentPool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &setLayout;
+
+	VkDescriptorSet descriptorSet;
+	VkResult result = vkAllocateDescriptorSets(m_device, &setAllocInfo, &descriptorSet);
+
+	// Current pool is full: retire it and try once more with a fresh one
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		m_fullPools.push_back(m_currentPool);
+		m_currentPool = takePool();
+		setAllocInfo.descriptorPool = m_currentPool;
+		result = vkAllocateDescriptorSets(m_device, &setAllocInfo, &descriptorSet);
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to Allocate a DESCRIPTOR SET!");
+	}
+
+	return descriptorSet;
+}
+
+void DescriptorAllocator::reset()
+{
+	// One call per pool frees all of its sets
+	if (m_currentPool != VK_NULL_HANDLE)
+	{
+		m_fullPools.push_back(m_currentPool);
+		m_currentPool = VK_NULL_HANDLE;
+	}
+	for (VkDescriptorPool pool : m_fullPools)
+	{
+		vkResetDescriptorPool(m_device, pool, 0);
+		m_freePools.push_back(pool);
+	}
+	m_fullPools.clear();
+}
+
+void DescriptorAllocator::destroy()
+{
+	reset();
+	for (VkDescriptorPool pool : m_freePools)
+	{
+		vkDestroyDescriptorPool(m_device, pool, nullptr);
+	}
+	m_freePools.clear();
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+}
+
+VkDescriptorPool DescriptorAllocator::takePool()
+{
+	if (!m_freePools.empty())
+	{
+		VkDescriptorPool pool = m_freePools.back();
+		m_freePools.pop_back();
+		return pool;
+	}
+
+	// Need more sets than ever before: grow, so a busy allocator ends up with few large pools
+	VkDescriptorPool pool = createPool(m_setsPerPool);
+	m_setsPerPool = std::min(m_setsPerPool * 2, k_maxSetsPerPool);
+	return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount)
+{
+	// Type of descriptors + how many descriptors and not DESCRIPTOR SETS (combined makes the pool size)
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const auto &ratio : m_ratios)
+	{
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = ratio.type;
+		poolSize.descriptorCount = std::max(static_cast<uint32_t>(ratio.ratio * setCount), 1u);
+		poolSizes.push_back(poolSize);
+	}
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = setCount;												// Max number of DesSets that can be created from pool
+	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());			// Amt of pool sizes being passed
+	poolCreateInfo.pPoolSizes = poolSizes.data();									// Pool sizes to create pool with
+
+	VkDescriptorPool pool;
+	VkResult result = vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &pool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a DESCRIPTOR POOL!");
+	}
+
+	return pool;
+}
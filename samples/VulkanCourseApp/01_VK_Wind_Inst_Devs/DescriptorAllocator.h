@@ -0,0 +1,51 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+
+// How many descriptors of a type a pool holds per set it can allocate
+struct DescriptorPoolRatio
+{
+	VkDescriptorType type;
+	float			 ratio;
+};
+
+// Allocates descriptor sets from a growing list of pools: when the current pool runs out
+// (VK_ERROR_OUT_OF_POOL_MEMORY / VK_ERROR_FRAGMENTED_POOL) the set comes from a new, larger pool instead of failing.
+// Sets are never freed one by one; reset() returns every set at once with vkResetDescriptorPool, which makes
+// an allocator per frame (or per cmd buffer) a cheap home for transient sets.
+class DescriptorAllocator
+{
+public:
+	DescriptorAllocator();
+
+	// Pools start with room for initialSets sets, each new pool doubles that (up to k_maxSetsPerPool)
+	void init(VkDevice newDevice, uint32_t initialSets, const std::vector<DescriptorPoolRatio> &ratios);
+
+	VkDescriptorSet allocate(VkDescriptorSetLayout setLayout);
+
+	// Free every set allocated so far; pools are kept for reuse
+	// NOTE: no cmd buffer still in flight may use the sets
+	void reset();
+
+	void destroy();
+
+	~DescriptorAllocator();
+
+private:
+	static const uint32_t k_maxSetsPerPool = 4096;
+
+	VkDevice						 m_device = VK_NULL_HANDLE;
+	std::vector<DescriptorPoolRatio> m_ratios;
+	uint32_t						 m_setsPerPool = 0;		// Size of the next pool created
+
+	VkDescriptorPool			  m_currentPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorPool> m_fullPools;				// Ran out of space since the last reset
+	std::vector<VkDescriptorPool> m_freePools;				// Reset and ready to reuse
+
+	VkDescriptorPool takePool();
+	VkDescriptorPool createPool(uint32_t setCount);
+};
@@ -0,0 +1,188 @@
+#include "DescriptorLayoutCache.h"
+
+#include <algorithm>
+
+
+DescriptorLayoutCache::DescriptorLayoutCache()
+{
+}
+
+void DescriptorLayoutCache::init(VkDevice newDevice)
+{
+	m_device = newDevice;
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::getSetLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings)
+{
+	// Sort so the same bindings listed in a different order share a layout
+	SetLayoutKey key;
+	key.bindings = bindings;
+	std::sort(key.bindings.begin(), key.bindings.end(),
+		[](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b) { return a.binding < b.binding; });
+
+	std::lock_guard<std::mutex> lock(m_layoutMutex);
+
+	auto existing = m_setLayouts.find(key);
+	if (existing != m_setLayouts.end())
+	{
+		return existing->second;
+	}
+
+	VkDescriptorSetLayout setLayout = createSetLayout(key.bindings);
+	m_setLayouts.emplace(key, setLayout);
+
+	return setLayout;
+}
+
+VkPipelineLayout DescriptorLayoutCache::getPipelineLayout(const ShaderReflection &reflection)
+{
+	// One set layout for every set number up to the highest one used
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	uint32_t setCount = reflection.descriptorSets.empty() ? 0 : reflection.descriptorSets.back().set + 1;
+	for (uint32_t set = 0; set < setCount; set++)
+	{
+		setLayouts.push_back(getSetLayout(reflection.getSetBindings(set)));
+	}
+
+	return getPipelineLayout(setLayouts, reflection.pushConstantRanges);
+}
+
+VkPipelineLayout DescriptorLayoutCache::getPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayouts,
+														  const std::vector<VkPushConstantRange> &pushConstantRanges)
+{
+	PipelineLayoutKey key;
+	key.setLayouts = setLayouts;
+	key.pushConstantRanges = pushConstantRanges;
+
+	std::lock_guard<std::mutex> lock(m_layoutMutex);
+
+	auto existing = m_pipelineLayouts.find(key);
+	if (existing != m_pipelineLayouts.end())
+	{
+		return existing->second;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(key.setLayouts.size());
+	pipelineLayoutCreateInfo.pSetLayouts = key.setLayouts.data();
+	pipelineLayoutCreateInfo.pushConstantRangeCount = static_cast<uint32_t>(key.pushConstantRanges.size());
+	pipelineLayoutCreateInfo.pPushConstantRanges = key.pushConstantRanges.data();
+
+	VkPipelineLayout pipelineLayout;
+	VkResult result = vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a PIPELINE LAYOUT!");
+	}
+	m_pipelineLayouts.emplace(key, pipelineLayout);
+
+	return pipelineLayout;
+}
+
+void DescriptorLayoutCache::destroy()
+{
+	std::lock_guard<std::mutex> lock(m_layoutMutex);
+
+	// Pipeline layouts first: they reference the set layouts
+	for (auto &entry : m_pipelineLayouts)
+	{
+		vkDestroyPipelineLayout(m_device, entry.second, nullptr);
+	}
+	m_pipelineLayouts.clear();
+
+	for (auto &entry : m_setLayouts)
+	{
+		vkDestroyDescriptorSetLayout(m_device, entry.second, nullptr);
+	}
+	m_setLayouts.clear();
+}
+
+DescriptorLayoutCache::~DescriptorLayoutCache()
+{
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::createSetLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings)
+{
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());	// Number of binding infos
+	layoutCreateInfo.pBindings = bindings.data();								// Array of binding info
+
+	VkDescriptorSetLayout setLayout;
+	VkResult result = vkCreateDescriptorSetLayout(m_device, &layoutCreateInfo, nullptr, &setLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to Create a DESCRIPTOR SET LAYOUT!");
+	}
+
+	return setLayout;
+}
+
+
+bool DescriptorLayoutCache::SetLayoutKey::operator==(const SetLayoutKey &other) const
+{
+	if (bindings.size() != other.bindings.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		const VkDescriptorSetLayoutBinding &a = bindings[i];
+		const VkDescriptorSetLayoutBinding &b = other.bindings[i];
+		if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+			a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags ||
+			a.pImmutableSamplers != b.pImmutableSamplers)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t DescriptorLayoutCache::SetLayoutKey::hash() const
+{
+	size_t seed = 0;
+	for (const auto &binding : bindings)
+	{
+		hashCombine(seed, binding.binding);
+		hashCombine(seed, static_cast<uint32_t>(binding.descriptorType));
+		hashCombine(seed, binding.descriptorCount);
+		hashCombine(seed, static_cast<uint32_t>(binding.stageFlags));
+	}
+	return seed;
+}
+
+bool DescriptorLayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey &other) const
+{
+	if (setLayouts != other.setLayouts || pushConstantRanges.size() != other.pushConstantRanges.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < pushConstantRanges.size(); i++)
+	{
+		const VkPushConstantRange &a = pushConstantRanges[i];
+		const VkPushConstantRange &b = other.pushConstantRanges[i];
+		if (a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t DescriptorLayoutCache::PipelineLayoutKey::hash() const
+{
+	size_t seed = 0;
+	for (VkDescriptorSetLayout setLayout : setLayouts)
+	{
+		hashCombine(seed, setLayout);
+	}
+	for (const auto &range : pushConstantRanges)
+	{
+		hashCombine(seed, static_cast<uint32_t>(range.stageFlags));
+		hashCombine(seed, range.offset);
+		hashCombine(seed, range.size);
+	}
+	return seed;
+}
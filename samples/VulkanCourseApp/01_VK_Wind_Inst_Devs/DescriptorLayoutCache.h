@@ -0,0 +1,71 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+#include "ShaderReflection.h"
+
+// Owns descriptor set layouts and pipeline layouts, shared by everything that declares the same bindings.
+// Shaders reflecting to identical sets (e.g. the same MVP block) end up with the same VkDescriptorSetLayout,
+// so their descriptor sets and pipeline layouts stay compatible.
+class DescriptorLayoutCache
+{
+public:
+	DescriptorLayoutCache();
+
+	void init(VkDevice newDevice);
+
+	// Layout for the given bindings (order doesn't matter); created the first time it is asked for
+	// NOTE: cache owns the layout, callers must NOT destroy it
+	VkDescriptorSetLayout getSetLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings);
+
+	// Pipeline layout with one set layout per reflected set (gaps get empty sets) and the push constants
+	VkPipelineLayout getPipelineLayout(const ShaderReflection &reflection);
+
+	// Pipeline layout from set layouts made elsewhere (e.g. a bindless set with binding flags)
+	VkPipelineLayout getPipelineLayout(const std::vector<VkDescriptorSetLayout> &setLayouts,
+									   const std::vector<VkPushConstantRange> &pushConstantRanges);
+
+	void destroy();
+
+	~DescriptorLayoutCache();
+
+private:
+	VkDevice m_device = VK_NULL_HANDLE;
+
+	// -- Set layouts, keyed by their (sorted) bindings
+	struct SetLayoutKey
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+		bool operator==(const SetLayoutKey &other) const;
+		size_t hash() const;
+	};
+
+	// -- Pipeline layouts, keyed by their set layouts and push constant ranges
+	struct PipelineLayoutKey
+	{
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		std::vector<VkPushConstantRange>   pushConstantRanges;
+
+		bool operator==(const PipelineLayoutKey &other) const;
+		size_t hash() const;
+	};
+
+	template <typename Key>
+	struct KeyHash
+	{
+		size_t operator()(const Key &key) const { return key.hash(); }
+	};
+
+	std::unordered_map<SetLayoutKey, VkDescriptorSetLayout, KeyHash<SetLayoutKey>>	  m_setLayouts;
+	std::unordered_map<PipelineLayoutKey, VkPipelineLayout, KeyHash<PipelineLayoutKey>> m_pipelineLayouts;
+	std::mutex m_layoutMutex;
+
+	VkDescriptorSetLayout createSetLayout(const std::vector<VkDescriptorSetLayoutBinding> &bindings);
+};
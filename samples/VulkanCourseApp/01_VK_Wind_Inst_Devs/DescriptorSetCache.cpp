@@ -0,0 +1,251 @@
+#include "DescriptorSetCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+#include "PipelineDesc.h"
+
+
+DescriptorBinding::DescriptorBinding()
+{
+	// Zero the whole union, so the slot never hands the template uninitialised bytes
+	memset(&imageInfo, 0, std::max(sizeof(bufferInfo), sizeof(imageInfo)));
+}
+
+DescriptorBinding DescriptorBinding::buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	DescriptorBinding descriptorBinding;
+	descriptorBinding.binding = binding;
+	descriptorBinding.type = type;
+	descriptorBinding.bufferInfo.buffer = buffer;
+	descriptorBinding.bufferInfo.offset = offset;
+	descriptorBinding.bufferInfo.range = range;
+	return descriptorBinding;
+}
+
+DescriptorBinding DescriptorBinding::image(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout)
+{
+	DescriptorBinding descriptorBinding;
+	descriptorBinding.binding = binding;
+	descriptorBinding.type = type;
+	descriptorBinding.imageInfo.sampler = sampler;
+	descriptorBinding.imageInfo.imageView = imageView;
+	descriptorBinding.imageInfo.imageLayout = imageLayout;
+	return descriptorBinding;
+}
+
+bool DescriptorBinding::isImage() const
+{
+	return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+		type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+		type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+
+
+DescriptorSetCache::DescriptorSetCache()
+{
+}
+
+void DescriptorSetCache::init(VkDevice newDevice, DescriptorAllocator *allocator)
+{
+	m_device = newDevice;
+	m_allocator = allocator;
+}
+
+VkDescriptorSet DescriptorSetCache::getSet(VkDescriptorSetLayout setLayout, const std::vector<DescriptorBinding> &bindings)
+{
+	// Sort so the same resources listed in a different order share a set
+	SetKey key;
+	key.setLayout = setLayout;
+	key.bindings = bindings;
+	std::sort(key.bindings.begin(), key.bindings.end(),
+		[](const DescriptorBinding &a, const DescriptorBinding &b) { return a.binding < b.binding; });
+
+	std::lock_guard<std::mutex> lock(m_cacheMutex);
+
+	auto existing = m_sets.find(key);
+	if (existing != m_sets.end())
+	{
+		return existing->second;
+	}
+
+	// Template only depends on which binding/type sits at each slot, not on the resources
+	TemplateKey templateKey;
+	templateKey.setLayout = setLayout;
+	for (const auto &binding : key.bindings)
+	{
+		templateKey.slots.push_back({ binding.binding, binding.type });
+	}
+
+	// Bindings are already packed the way the template reads them (one DescriptorBinding per slot)
+	VkDescriptorSet descriptorSet = m_allocator->allocate(setLayout);
+	vkUpdateDescriptorSetWithTemplate(m_device, descriptorSet, getTemplate(templateKey), key.bindings.data());
+
+	m_sets.emplace(key, descriptorSet);
+	return descriptorSet;
+}
+
+template <typename Predicate>
+void DescriptorSetCache::invalidateIf(Predicate bindsResource)
+{
+	std::lock_guard<std::mutex> lock(m_cacheMutex);
+	for (auto it = m_sets.begin(); it != m_sets.end();)
+	{
+		const std::vector<DescriptorBinding> &bindings = it->first.bindings;
+		if (std::any_of(bindings.begin(), bindings.end(), bindsResource))
+		{
+			it = m_sets.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void DescriptorSetCache::invalidateBuffer(VkBuffer buffer)
+{
+	invalidateIf([buffer](const DescriptorBinding &binding) { return !binding.isImage() && binding.bufferInfo.buffer == buffer; });
+}
+
+void DescriptorSetCache::invalidateImageView(VkImageView imageView)
+{
+	invalidateIf([imageView](const DescriptorBinding &binding) { return binding.isImage() && binding.imageInfo.imageView == imageView; });
+}
+
+void DescriptorSetCache::invalidateSampler(VkSampler sampler)
+{
+	invalidateIf([sampler](const DescriptorBinding &binding) { return binding.isImage() && binding.imageInfo.sampler == sampler; });
+}
+
+void DescriptorSetCache::clear()
+{
+	std::lock_guard<std::mutex> lock(m_cacheMutex);
+	m_sets.clear();
+}
+
+void DescriptorSetCache::destroy()
+{
+	std::lock_guard<std::mutex> lock(m_cacheMutex);
+	m_sets.clear();
+
+	for (auto &entry : m_templates)
+	{
+		vkDestroyDescriptorUpdateTemplate(m_device, entry.second, nullptr);
+	}
+	m_templates.clear();
+}
+
+DescriptorSetCache::~DescriptorSetCache()
+{
+}
+
+VkDescriptorUpdateTemplate DescriptorSetCache::getTemplate(const TemplateKey &key)
+{
+	auto existing = m_templates.find(key);
+	if (existing != m_templates.end())
+	{
+		return existing->second;
+	}
+
+	// One entry per slot, pointing at the buffer or image info inside the slot's DescriptorBinding
+	std::vector<VkDescriptorUpdateTemplateEntry> entries(key.slots.size());
+	for (size_t i = 0; i < key.slots.size(); i++)
+	{
+		DescriptorBinding slot;
+		slot.type = key.slots[i].second;
+
+		entries[i].dstBinding = key.slots[i].first;
+		entries[i].dstArrayElement = 0;
+		entries[i].descriptorCount = 1;
+		entries[i].descriptorType = key.slots[i].second;
+		entries[i].offset = i * sizeof(DescriptorBinding) +
+			(slot.isImage() ? offsetof(DescriptorBinding, imageInfo) : offsetof(DescriptorBinding, bufferInfo));
+		entries[i].stride = sizeof(DescriptorBinding);
+	}
+
+	VkDescriptorUpdateTemplateCreateInfo templateCreateInfo = {};
+	templateCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	templateCreateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	templateCreateInfo.pDescriptorUpdateEntries = entries.data();
+	templateCreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	templateCreateInfo.descriptorSetLayout = key.setLayout;
+
+	VkDescriptorUpdateTemplate updateTemplate;
+	VkResult result = vkCreateDescriptorUpdateTemplate(m_device, &templateCreateInfo, nullptr, &updateTemplate);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a DESCRIPTOR UPDATE TEMPLATE!");
+	}
+	m_templates.emplace(key, updateTemplate);
+
+	return updateTemplate;
+}
+
+
+bool DescriptorSetCache::SetKey::operator==(const SetKey &other) const
+{
+	if (setLayout != other.setLayout || bindings.size() != other.bindings.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		const DescriptorBinding &a = bindings[i];
+		const DescriptorBinding &b = other.bindings[i];
+		if (a.binding != b.binding || a.type != b.type)
+		{
+			return false;
+		}
+		bool sameResource = a.isImage()
+			? a.imageInfo.sampler == b.imageInfo.sampler && a.imageInfo.imageView == b.imageInfo.imageView && a.imageInfo.imageLayout == b.imageInfo.imageLayout
+			: a.bufferInfo.buffer == b.bufferInfo.buffer && a.bufferInfo.offset == b.bufferInfo.offset && a.bufferInfo.range == b.bufferInfo.range;
+		if (!sameResource)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t DescriptorSetCache::SetKey::hash() const
+{
+	size_t seed = 0;
+	hashCombine(seed, setLayout);
+	for (const auto &binding : bindings)
+	{
+		hashCombine(seed, binding.binding);
+		hashCombine(seed, static_cast<uint32_t>(binding.type));
+		if (binding.isImage())
+		{
+			hashCombine(seed, binding.imageInfo.sampler);
+			hashCombine(seed, binding.imageInfo.imageView);
+			hashCombine(seed, static_cast<uint32_t>(binding.imageInfo.imageLayout));
+		}
+		else
+		{
+			hashCombine(seed, binding.bufferInfo.buffer);
+			hashCombine(seed, binding.bufferInfo.offset);
+			hashCombine(seed, binding.bufferInfo.range);
+		}
+	}
+	return seed;
+}
+
+bool DescriptorSetCache::TemplateKey::operator==(const TemplateKey &other) const
+{
+	return setLayout == other.setLayout && slots == other.slots;
+}
+
+size_t DescriptorSetCache::TemplateKey::hash() const
+{
+	size_t seed = 0;
+	hashCombine(seed, setLayout);
+	for (const auto &slot : slots)
+	{
+		hashCombine(seed, slot.first);
+		hashCombine(seed, static_cast<uint32_t>(slot.second));
+	}
+	return seed;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+#include "DescriptorAllocator.h"
+
+// One resource bound to one binding of a set
+struct DescriptorBinding
+{
+	uint32_t		 binding = 0;
+	VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+	// Packed as written by the update template: buffer or image info, whichever the type uses
+	union
+	{
+		VkDescriptorBufferInfo bufferInfo;
+		VkDescriptorImageInfo  imageInfo;
+	};
+
+	DescriptorBinding();
+
+	static DescriptorBinding buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+	static DescriptorBinding image(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout);
+
+	bool isImage() const;
+};
+
+// Descriptor sets keyed by their layout and the resources bound to them: asking again for the same
+// combination hands back the set written the first time, without allocating or writing anything.
+// New sets are written with one vkUpdateDescriptorSetWithTemplate call from the packed bindings
+// (one VkDescriptorUpdateTemplate per layout and binding list) instead of a VkWriteDescriptorSet per binding.
+// NOTE: sets come from the given long lived allocator; clear() before resetting it
+class DescriptorSetCache
+{
+public:
+	DescriptorSetCache();
+
+	void init(VkDevice newDevice, DescriptorAllocator *allocator);
+
+	// Set of setLayout with the given resources, created and written the first time it is asked for
+	VkDescriptorSet getSet(VkDescriptorSetLayout setLayout, const std::vector<DescriptorBinding> &bindings);
+
+	// Forget every set binding the resource; call before destroying or recreating it, since a new resource
+	// can get the same handle value and would otherwise be handed a set still pointing at the old one
+	// (the sets stay allocated until their allocator is reset or destroyed)
+	void invalidateBuffer(VkBuffer buffer);
+	void invalidateImageView(VkImageView imageView);
+	void invalidateSampler(VkSampler sampler);
+
+	// Forget all sets (they stay allocated until their allocator is reset or destroyed)
+	void clear();
+
+	void destroy();
+
+	~DescriptorSetCache();
+
+private:
+	VkDevice			 m_device = VK_NULL_HANDLE;
+	DescriptorAllocator *m_allocator = nullptr;
+
+	// -- Sets, keyed by layout and bound resources
+	struct SetKey
+	{
+		VkDescriptorSetLayout		   setLayout;
+		std::vector<DescriptorBinding> bindings;		// Sorted by binding number
+
+		bool operator==(const SetKey &other) const;
+		size_t hash() const;
+	};
+
+	// -- Update templates, keyed by layout and which binding/type sits at each packed slot
+	struct TemplateKey
+	{
+		VkDescriptorSetLayout setLayout;
+		std::vector<std::pair<uint32_t, VkDescriptorType>> slots;
+
+		bool operator==(const TemplateKey &other) const;
+		size_t hash() const;
+	};
+
+	template <typename Key>
+	struct KeyHash
+	{
+		size_t operator()(const Key &key) const { return key.hash(); }
+	};
+
+	std::unordered_map<SetKey, VkDescriptorSet, KeyHash<SetKey>>						   m_sets;
+	std::unordered_map<TemplateKey, VkDescriptorUpdateTemplate, KeyHash<TemplateKey>> m_templates;
+	std::mutex m_cacheMutex;
+
+	VkDescriptorUpdateTemplate getTemplate(const TemplateKey &key);
+
+	// Erase the sets with any binding matching the predicate
+	template <typename Predicate>
+	void invalidateIf(Predicate bindsResource);
+};
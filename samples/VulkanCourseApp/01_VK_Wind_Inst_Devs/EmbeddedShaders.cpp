@@ -0,0 +1,88 @@
+#include "EmbeddedShaders.h"
+
+#include <cstring>
+
+#include "Utilities.h"
+
+
+// -- SPIR-V as 32 bit words, aligned so vkCreateShaderModule can read it in place
+alignas(16) static constexpr uint32_t k_vertSpv[] = {
+#include "Shaders/vert.spv.inc"
+};
+
+alignas(16) static constexpr uint32_t k_vertBindlessSpv[] = {
+#include "Shaders/vert_bindless.spv.inc"
+};
+
+alignas(16) static constexpr uint32_t k_fragSpv[] = {
+#include "Shaders/frag.spv.inc"
+};
+
+// Meshlet culling stages: compute for indirect draws, task + mesh (SPIR-V 1.4) for mesh shaders
+alignas(16) static constexpr uint32_t k_meshletCullSpv[] = {
+#include "Shaders/meshlet_cull.spv.inc"
+};
+
+alignas(16) static constexpr uint32_t k_meshletTaskSpv[] = {
+#include "Shaders/meshlet_task.spv.inc"
+};
+
+alignas(16) static constexpr uint32_t k_meshletMeshSpv[] = {
+#include "Shaders/meshlet_mesh.spv.inc"
+};
+
+static const EmbeddedShader k_embeddedShaders[] = {
+	{ "Shaders/vert.spv", k_vertSpv, sizeof(k_vertSpv) },
+	{ "Shaders/vert_bindless.spv", k_vertBindlessSpv, sizeof(k_vertBindlessSpv) },
+	{ "Shaders/frag.spv", k_fragSpv, sizeof(k_fragSpv) },
+	{ "Shaders/meshlet_cull.spv", k_meshletCullSpv, sizeof(k_meshletCullSpv) },
+	{ "Shaders/meshlet_task.spv", k_meshletTaskSpv, sizeof(k_meshletTaskSpv) },
+	{ "Shaders/meshlet_mesh.spv", k_meshletMeshSpv, sizeof(k_meshletMeshSpv) },
+};
+
+
+// "./Shaders/vert.spv" and "Shaders/vert.spv" name the same shader
+static std::string normalisePath(const std::string &path)
+{
+	return path.compare(0, 2, "./") == 0 ? path.substr(2) : path;
+}
+
+ShaderStageDesc embeddedShaderStage(VkShaderStageFlagBits stage, const std::string &path)
+{
+	std::string name = normalisePath(path);
+	for (const auto &shader : k_embeddedShaders)
+	{
+		if (name == shader.path)
+		{
+			ShaderStageDesc shaderStage;
+			shaderStage.stage = stage;
+			shaderStage.code = shader.code;
+			shaderStage.codeSize = shader.codeSize;
+			shaderStage.path = path;
+			return shaderStage;
+		}
+	}
+
+	throw std::runtime_error("Failed to find an EMBEDDED SHADER: " + path);
+}
+
+ShaderStageDesc loadShaderStage(VkShaderStageFlagBits stage, const std::string &path)
+{
+	std::vector<char> fileBuffer = readFile(path);
+	if (fileBuffer.size() % sizeof(uint32_t) != 0)
+	{
+		throw std::runtime_error("Failed to load a SHADER: size is not a multiple of 4!");
+	}
+
+	// Copy into words so the code is properly aligned for vkCreateShaderModule
+	auto words = std::make_shared<std::vector<uint32_t>>(fileBuffer.size() / sizeof(uint32_t));
+	memcpy(words->data(), fileBuffer.data(), fileBuffer.size());
+
+	ShaderStageDesc shaderStage;
+	shaderStage.stage = stage;
+	shaderStage.code = words->data();
+	shaderStage.codeSize = fileBuffer.size();
+	shaderStage.codeStorage = words;
+	shaderStage.path = path;
+	return shaderStage;
+}
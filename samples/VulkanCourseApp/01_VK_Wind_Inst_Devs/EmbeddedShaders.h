@@ -0,0 +1,25 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "PipelineDesc.h"
+
+// SPIR-V compiled into the executable (the *.spv.inc files are rebuilt from the GLSL by the project's
+// shader build step, or by Shaders/compile_shader.sh / .bat)
+struct EmbeddedShader
+{
+	const char*		path;			// .spv file it was built from, e.g. "Shaders/vert.spv"
+	const uint32_t* code;
+	size_t			codeSize;		// Size of code in bytes
+};
+
+// Stage using the embedded copy of the given .spv file: no file I/O, no copy
+// path is kept in the stage so it can be reloaded from disk later
+ShaderStageDesc embeddedShaderStage(VkShaderStageFlagBits stage, const std::string &path);
+
+// Stage read from the .spv file at runtime (e.g. after it was recompiled)
+ShaderStageDesc loadShaderStage(VkShaderStageFlagBits stage, const std::string &path);
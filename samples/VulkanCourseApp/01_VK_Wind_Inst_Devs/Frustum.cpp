@@ -0,0 +1,66 @@
+#include "Frustum.h"
+
+#include "SimdPacket.h"
+#include "FrustumKernels.h"
+
+
+Frustum makeFrustum(const glm::mat4 &viewProjection)
+{
+	// Rows of the matrix: clip = (dot(row0, p), dot(row1, p), dot(row2, p), dot(row3, p)) for p = (x, y, z, 1)
+	glm::vec4 rows[4];
+	for (int row = 0; row < 4; row++)
+	{
+		rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+	}
+
+	// Each plane is one clip inequality, e.g. -w <= x  ->  row3 + row0 >= 0
+	Frustum frustum;
+	frustum.planes[Frustum::Left]	= rows[3] + rows[0];
+	frustum.planes[Frustum::Right]	= rows[3] - rows[0];
+	frustum.planes[Frustum::Bottom] = rows[3] + rows[1];
+	frustum.planes[Frustum::Top]	= rows[3] - rows[1];
+	frustum.planes[Frustum::Near]	= rows[2];
+	frustum.planes[Frustum::Far]	= rows[3] - rows[2];
+	for (auto &plane : frustum.planes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+
+	// Corners: clip space cube corners back through the inverse
+	glm::mat4 inverse = glm::inverse(viewProjection);
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec4 clip((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : 0.0f, 1.0f);
+		glm::vec4 world = inverse * clip;
+		frustum.corners[corner] = glm::vec3(world) / world.w;
+	}
+
+	return frustum;
+}
+
+static const FrustumKernels &getKernels()
+{
+#ifdef SIMD_X86
+	static const FrustumKernels &kernels = getCpuSimdLevel() >= SimdLevel::AVX2 ? getFrustumKernelsAvx2() : getFrustumKernelsSse();
+	return kernels;
+#else
+	return getFrustumKernelsSse();
+#endif
+}
+
+size_t cullSpheres(const Frustum &frustum, const glm::vec4 *spheres, size_t count, uint32_t *visible, CullPrecision precision)
+{
+	return getKernels().cullSpheres(frustum, spheres, count, visible, precision);
+}
+
+size_t cullAabbs(const Frustum &frustum, const glm::vec3 *centers, const glm::vec3 *extents, size_t count, uint32_t *visible,
+	CullPrecision precision)
+{
+	return getKernels().cullAabbs(frustum, centers, extents, count, visible, precision);
+}
+
+const FrustumKernels &getFrustumKernelsSse()
+{
+	static const FrustumKernels kernels = { cullSpheresKernel, cullAabbsKernel };
+	return kernels;
+}
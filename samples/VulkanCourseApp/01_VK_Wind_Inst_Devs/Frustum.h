@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "CpuFeatures.h"
+
+// View frustum of a (finite) view-projection matrix, as Vulkan clips: -w <= x, y <= w and 0 <= z <= w.
+// Planes point inside: dot(plane.xyz, p) + plane.w >= 0 for points in the frustum, xyz is unit length
+struct Frustum
+{
+	enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+	glm::vec4 planes[PlaneCount];
+	glm::vec3 corners[8];			// Bit 0: +x, bit 1: +y, bit 2: far (clip space)
+};
+
+Frustum makeFrustum(const glm::mat4 &viewProjection);
+
+enum class CullPrecision
+{
+	Conservative,	// Frustum planes only: never drops a visible object, may keep some just outside an edge or corner
+	Exact			// Also every other separating axis: kept == really intersects the frustum
+};
+
+// Batch visibility tests, 8 objects at a time. visible: one bit per object, bit i % 32 of visible[i / 32]
+// ((count + 31) / 32 words, unused bits of the last one cleared), set == visible. Returns the number of visible objects
+
+// spheres: xyz center, w radius
+size_t cullSpheres(const Frustum &frustum, const glm::vec4 *spheres, size_t count, uint32_t *visible,
+	CullPrecision precision = CullPrecision::Conservative);
+
+// Axis aligned boxes as center and half size
+size_t cullAabbs(const Frustum &frustum, const glm::vec3 *centers, const glm::vec3 *extents, size_t count, uint32_t *visible,
+	CullPrecision precision = CullPrecision::Conservative);
+
+inline bool isVisible(const uint32_t *visible, size_t index)
+{
+	return (visible[index / 32] >> (index % 32)) & 1;
+}
+
+
+// -- Kernels of one instruction set (the functions above use the best one the CPU has)
+struct FrustumKernels
+{
+	size_t (*cullSpheres)(const Frustum &frustum, const glm::vec4 *spheres, size_t count, uint32_t *visible, CullPrecision precision);
+	size_t (*cullAabbs)(const Frustum &frustum, const glm::vec3 *centers, const glm::vec3 *extents, size_t count, uint32_t *visible,
+		CullPrecision precision);
+};
+
+const FrustumKernels &getFrustumKernelsSse();		// 2x SSE per packet (plain C++ off x86)
+#ifdef SIMD_X86
+const FrustumKernels &getFrustumKernelsAvx2();
+#endif
@@ -0,0 +1,15 @@
+#include "Frustum.h"
+
+#ifdef SIMD_X86
+// Only used after CPUID said AVX2 + FMA are there
+#define SIMD_PACKET_AVX2
+#include "SimdPacket.h"
+#include "FrustumKernels.h"
+
+
+const FrustumKernels &getFrustumKernelsAvx2()
+{
+	static const FrustumKernels kernels = { cullSpheresKernel, cullAabbsKernel };
+	return kernels;
+}
+#endif
@@ -0,0 +1,282 @@
+#pragma once
+
+// Culling kernels, compiled once per instruction set: Frustum.cpp (floatx8 == 2x SSE) and FrustumAvx2.cpp (floatx8 == AVX).
+// Include after SimdPacket.h; everything in here is private to the including translation unit.
+//
+// Conservative: an object is culled when it is completely behind one frustum plane.
+// Exact: objects that cross a plane but weren't culled also go through the rest of the separating axis test, with axes
+//	- sphere: center - corner, and the center's offset from each edge line (the closest feature is a face, edge or corner)
+//	- box:	  the box's x, y and z axes, and each of them crossed with every frustum edge
+// Only packets with such an object in them pay for it, which is few of them in a real scene.
+
+#include <algorithm>
+#include <cmath>
+
+#include "Frustum.h"
+
+namespace
+{
+
+struct FrustumPackets
+{
+	floatx8 planes[Frustum::PlaneCount][4];
+	floatx8 absNormals[Frustum::PlaneCount][3];
+	floatx8 corners[8][3];
+
+	// -- Exact spheres: edge start, direction and 1 / squared length
+	floatx8 edgeStart[12][3];
+	floatx8 edgeDirection[12][3];
+	floatx8 edgeInvLengthSq[12];
+
+	// -- Exact boxes: fixed axes, with the frustum's extent along each worked out up front
+	struct Axis
+	{
+		floatx8 axis[3];
+		floatx8 absAxis[3];
+		floatx8 low, high;
+	};
+	Axis	boxAxes[3 + 3 * 12];
+	int		boxAxisCount;
+};
+
+SIMD_PACKET_FUNCTION static void setupFrustumPackets(const Frustum &frustum, bool exactBoxes, FrustumPackets &packets)
+{
+	for (int plane = 0; plane < Frustum::PlaneCount; plane++)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			packets.planes[plane][i] = floatx8(frustum.planes[plane][i]);
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			packets.absNormals[plane][i] = floatx8(std::fabs(frustum.planes[plane][i]));
+		}
+	}
+	for (int corner = 0; corner < 8; corner++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			packets.corners[corner][i] = floatx8(frustum.corners[corner][i]);
+		}
+	}
+
+	// Edges join corners that differ in one bit
+	glm::vec3 edgeStarts[12], edgeDirections[12];
+	int edge = 0;
+	for (int bit = 1; bit < 8; bit <<= 1)
+	{
+		for (int corner = 0; corner < 8; corner++)
+		{
+			if ((corner & bit) == 0)
+			{
+				edgeStarts[edge] = frustum.corners[corner];
+				edgeDirections[edge] = frustum.corners[corner | bit] - frustum.corners[corner];
+				edge++;
+			}
+		}
+	}
+	for (edge = 0; edge < 12; edge++)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			packets.edgeStart[edge][i] = floatx8(edgeStarts[edge][i]);
+			packets.edgeDirection[edge][i] = floatx8(edgeDirections[edge][i]);
+		}
+		packets.edgeInvLengthSq[edge] = floatx8(1.0f / glm::dot(edgeDirections[edge], edgeDirections[edge]));
+	}
+
+	packets.boxAxisCount = 0;
+	if (!exactBoxes)
+	{
+		return;
+	}
+	for (int boxAxis = 0; boxAxis < 3; boxAxis++)
+	{
+		glm::vec3 unit(0.0f);
+		unit[boxAxis] = 1.0f;
+		for (edge = -1; edge < 12; edge++)
+		{
+			// The box axis itself, then crossed with each edge (parallel ones give nothing)
+			glm::vec3 axis = edge < 0 ? unit : glm::cross(unit, edgeDirections[edge]);
+			if (edge >= 0 && glm::dot(axis, axis) <= 1e-12f * glm::dot(edgeDirections[edge], edgeDirections[edge]))
+			{
+				continue;
+			}
+
+			float low = glm::dot(frustum.corners[0], axis);
+			float high = low;
+			for (int corner = 1; corner < 8; corner++)
+			{
+				float projected = glm::dot(frustum.corners[corner], axis);
+				low = std::min(low, projected);
+				high = std::max(high, projected);
+			}
+
+			FrustumPackets::Axis &packet = packets.boxAxes[packets.boxAxisCount++];
+			for (int i = 0; i < 3; i++)
+			{
+				packet.axis[i] = floatx8(axis[i]);
+				packet.absAxis[i] = floatx8(std::fabs(axis[i]));
+			}
+			packet.low = floatx8(low);
+			packet.high = floatx8(high);
+		}
+	}
+}
+
+SIMD_PACKET_FUNCTION static inline floatx8 dot3(const floatx8 *a, const vec3x8 &b)
+{
+	return fmadd(a[0], b.x, fmadd(a[1], b.y, a[2] * b.z));
+}
+
+// Lanes where [center - radius, center + radius] on axis misses the frustum's corners on it
+SIMD_PACKET_FUNCTION static inline floatx8 separatedOnAxis(const FrustumPackets &packets, const vec3x8 &axis, floatx8 center, floatx8 radius)
+{
+	floatx8 low = dot3(packets.corners[0], axis);
+	floatx8 high = low;
+	for (int corner = 1; corner < 8; corner++)
+	{
+		floatx8 projected = dot3(packets.corners[corner], axis);
+		low = min(low, projected);
+		high = max(high, projected);
+	}
+	return (center - radius > high) | (center + radius < low);
+}
+
+// Bit per lane, set == visible
+SIMD_PACKET_FUNCTION static int sphereVisibleBits(const FrustumPackets &packets, const vec4x8 &sphere, bool exact)
+{
+	vec3x8 center = sphere.xyz();
+	floatx8 zero(0.0f);
+	floatx8 outside = zero, crossing = zero;
+	for (int plane = 0; plane < Frustum::PlaneCount; plane++)
+	{
+		floatx8 distance = dot3(packets.planes[plane], center) + packets.planes[plane][3];
+		outside = outside | (distance < -sphere.w);
+		crossing = crossing | (distance < sphere.w);
+	}
+
+	if (!exact || movemask(andNot(outside, crossing)) == 0)
+	{
+		return ~movemask(outside) & 0xFF;
+	}
+
+	for (int corner = 0; corner < 8; corner++)
+	{
+		vec3x8 axis = center - vec3x8(packets.corners[corner][0], packets.corners[corner][1], packets.corners[corner][2]);
+		outside = outside | separatedOnAxis(packets, axis, dot(center, axis), sphere.w * length(axis));
+	}
+	for (int edge = 0; edge < 12; edge++)
+	{
+		vec3x8 direction(packets.edgeDirection[edge][0], packets.edgeDirection[edge][1], packets.edgeDirection[edge][2]);
+		vec3x8 offset = center - vec3x8(packets.edgeStart[edge][0], packets.edgeStart[edge][1], packets.edgeStart[edge][2]);
+		vec3x8 axis = offset - direction * (dot(offset, direction) * packets.edgeInvLengthSq[edge]);
+		outside = outside | separatedOnAxis(packets, axis, dot(center, axis), sphere.w * length(axis));
+	}
+	return ~movemask(outside) & 0xFF;
+}
+
+SIMD_PACKET_FUNCTION static int aabbVisibleBits(const FrustumPackets &packets, const vec3x8 &center, const vec3x8 &extent)
+{
+	floatx8 zero(0.0f);
+	floatx8 outside = zero, crossing = zero;
+	for (int plane = 0; plane < Frustum::PlaneCount; plane++)
+	{
+		floatx8 distance = dot3(packets.planes[plane], center) + packets.planes[plane][3];
+		floatx8 radius = dot3(packets.absNormals[plane], extent);
+		outside = outside | (distance < -radius);
+		crossing = crossing | (distance < radius);
+	}
+
+	if (packets.boxAxisCount == 0 || movemask(andNot(outside, crossing)) == 0)
+	{
+		return ~movemask(outside) & 0xFF;
+	}
+
+	for (int i = 0; i < packets.boxAxisCount && movemask(outside) != 0xFF; i++)
+	{
+		const FrustumPackets::Axis &axis = packets.boxAxes[i];
+		floatx8 projected = dot3(axis.axis, center);
+		floatx8 radius = dot3(axis.absAxis, extent);
+		outside = outside | (projected - radius > axis.high) | (projected + radius < axis.low);
+	}
+	return ~movemask(outside) & 0xFF;
+}
+
+static inline size_t storeVisibleBits(uint32_t *visible, size_t index, int bits)
+{
+	if (index % 32 == 0)
+	{
+		visible[index / 32] = static_cast<uint32_t>(bits);
+	}
+	else
+	{
+		visible[index / 32] |= static_cast<uint32_t>(bits) << (index % 32);
+	}
+
+	size_t count = 0;
+	for (; bits != 0; bits &= bits - 1)
+	{
+		count++;
+	}
+	return count;
+}
+
+SIMD_PACKET_FUNCTION static size_t cullSpheresKernel(const Frustum &frustum, const glm::vec4 *spheres, size_t count, uint32_t *visible,
+	CullPrecision precision)
+{
+	FrustumPackets packets;
+	setupFrustumPackets(frustum, false, packets);
+	bool exact = precision == CullPrecision::Exact;
+
+	size_t visibleCount = 0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		vec4x8 sphere;
+		loadVec4(spheres + i, sphere);
+		visibleCount += storeVisibleBits(visible, i, sphereVisibleBits(packets, sphere, exact));
+	}
+	if (i < count)
+	{
+		// Last few: padded to a whole packet, padding lanes dropped from the result
+		glm::vec4 tail[8] = {};
+		std::copy(spheres + i, spheres + count, tail);
+		vec4x8 sphere;
+		loadVec4(tail, sphere);
+		int lanes = (1 << (count - i)) - 1;
+		visibleCount += storeVisibleBits(visible, i, sphereVisibleBits(packets, sphere, exact) & lanes);
+	}
+	return visibleCount;
+}
+
+SIMD_PACKET_FUNCTION static size_t cullAabbsKernel(const Frustum &frustum, const glm::vec3 *centers, const glm::vec3 *extents, size_t count,
+	uint32_t *visible, CullPrecision precision)
+{
+	FrustumPackets packets;
+	setupFrustumPackets(frustum, precision == CullPrecision::Exact, packets);
+
+	size_t visibleCount = 0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		vec3x8 center, extent;
+		loadVec3(centers + i, center);
+		loadVec3(extents + i, extent);
+		visibleCount += storeVisibleBits(visible, i, aabbVisibleBits(packets, center, extent));
+	}
+	if (i < count)
+	{
+		glm::vec3 tailCenters[8] = {}, tailExtents[8] = {};
+		std::copy(centers + i, centers + count, tailCenters);
+		std::copy(extents + i, extents + count, tailExtents);
+		vec3x8 center, extent;
+		loadVec3(tailCenters, center);
+		loadVec3(tailExtents, extent);
+		int lanes = (1 << (count - i)) - 1;
+		visibleCount += storeVisibleBits(visible, i, aabbVisibleBits(packets, center, extent) & lanes);
+	}
+	return visibleCount;
+}
+
+}
@@ -0,0 +1,290 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+
+// Queue of the calling thread (threads the job system didn't start use the main thread's queue)
+static thread_local const JobSystem *t_jobSystem = nullptr;
+static thread_local uint32_t		  t_queueIndex = 0;
+
+JobCounter::JobCounter() : m_pending(0)
+{
+}
+
+bool JobCounter::isDone() const
+{
+	return m_pending.load() == 0;
+}
+
+JobCounter::~JobCounter()
+{
+}
+
+
+JobSystem::JobSystem() : m_queuedJobs(0), m_stopping(false), m_sleepingWorkers(0)
+{
+}
+
+void JobSystem::init(uint32_t workerCount)
+{
+	m_mainThreadId = std::this_thread::get_id();
+	m_stopping = false;
+	t_jobSystem = this;
+	t_queueIndex = 0;
+
+	// Leave a core for the main (render) thread, which also runs jobs while it waits
+	if (workerCount == 0)
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+	}
+
+	m_queues.clear();
+	for (uint32_t i = 0; i <= workerCount; i++)
+	{
+		m_queues.emplace_back(new WorkerQueue());
+	}
+
+	for (uint32_t i = 1; i <= workerCount; i++)
+	{
+		m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+void JobSystem::run(JobFunction function, JobCounter *counter, JobCounter *dependency)
+{
+	if (counter != nullptr)
+	{
+		counter->m_pending++;
+	}
+
+	// Park the job on its dependency; whoever finishes the dependency's last job queues it
+	if (dependency != nullptr && !dependency->isDone())
+	{
+		std::lock_guard<std::mutex> lock(dependency->m_waitingMutex);
+		if (!dependency->isDone())
+		{
+			dependency->m_waiting.push_back({ std::move(function), counter });
+			return;
+		}
+	}
+
+	schedule({ std::move(function), counter });
+}
+
+void JobSystem::runOnMainThread(JobFunction function, JobCounter *counter)
+{
+	if (counter != nullptr)
+	{
+		counter->m_pending++;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+	m_mainThreadJobs.push_back({ std::move(function), counter });
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)> &function,
+	JobCounter &counter)
+{
+	// One shared copy of the function for all chunks
+	auto sharedFunction = std::make_shared<std::function<void(uint32_t, uint32_t)>>(function);
+	chunkSize = std::max(chunkSize, 1u);
+
+	for (uint32_t begin = 0; begin < count; begin += chunkSize)
+	{
+		uint32_t end = std::min(count, begin + chunkSize);
+		run([sharedFunction, begin, end]() { (*sharedFunction)(begin, end); }, &counter);
+	}
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+	uint32_t queueIndex = t_jobSystem == this ? t_queueIndex : 0;
+
+	// Help out instead of blocking: the jobs being waited on may be sitting in this thread's own queue
+	while (!counter.isDone())
+	{
+		Job job;
+		if (findJob(queueIndex, job))
+		{
+			execute(job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// Whoever finished the last job may still hold the counter's lock; once we get it, the counter is ours to destroy
+	std::lock_guard<std::mutex> lock(counter.m_waitingMutex);
+}
+
+void JobSystem::pumpMainThread()
+{
+	std::vector<Job> jobs;
+	{
+		std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+		jobs.swap(m_mainThreadJobs);
+	}
+
+	for (auto &job : jobs)
+	{
+		execute(job);
+	}
+}
+
+bool JobSystem::isMainThread() const
+{
+	return std::this_thread::get_id() == m_mainThreadId;
+}
+
+uint32_t JobSystem::getWorkerCount() const
+{
+	return static_cast<uint32_t>(m_workers.size());
+}
+
+void JobSystem::destroy()
+{
+	stopWorkers();
+	m_queues.clear();
+	m_mainThreadJobs.clear();
+}
+
+JobSystem::~JobSystem()
+{
+	// Threads must be joined before they destruct
+	stopWorkers();
+}
+
+void JobSystem::workerLoop(uint32_t queueIndex)
+{
+	t_jobSystem = this;
+	t_queueIndex = queueIndex;
+
+	while (!m_stopping)
+	{
+		Job job;
+		if (findJob(queueIndex, job))
+		{
+			execute(job);
+			continue;
+		}
+
+		// Nothing to do or steal: sleep until something is queued.
+		// Sleeping count goes up before the queued count is checked, and schedule() does the opposite,
+		// so at least one of the two sees the other and no wake up is lost
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleepingWorkers++;
+		m_sleepCondition.wait(lock, [this]() { return m_stopping || m_queuedJobs.load() > 0; });
+		m_sleepingWorkers--;
+	}
+}
+
+void JobSystem::schedule(Job job)
+{
+	uint32_t queueIndex = t_jobSystem == this ? t_queueIndex : 0;
+	{
+		std::lock_guard<std::mutex> lock(m_queues[queueIndex]->mutex);
+		m_queues[queueIndex]->jobs.push_back(std::move(job));
+	}
+	m_queuedJobs++;
+
+	if (m_sleepingWorkers.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_sleepCondition.notify_one();
+	}
+}
+
+bool JobSystem::findJob(uint32_t queueIndex, Job &job)
+{
+	// Main thread only jobs first, so GLFW work isn't starved by a long wait()
+	if (isMainThread())
+	{
+		std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+		if (!m_mainThreadJobs.empty())
+		{
+			job = std::move(m_mainThreadJobs.back());
+			m_mainThreadJobs.pop_back();
+			return true;
+		}
+	}
+
+	if (m_queuedJobs.load() == 0)
+	{
+		return false;
+	}
+
+	// Own queue: newest job first
+	{
+		WorkerQueue &queue = *m_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty())
+		{
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			m_queuedJobs--;
+			return true;
+		}
+	}
+
+	// Steal the oldest job of the next queue that has one
+	size_t queueCount = m_queues.size();
+	for (size_t offset = 1; offset < queueCount; offset++)
+	{
+		WorkerQueue &victim = *m_queues[(queueIndex + offset) % queueCount];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			m_queuedJobs--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::execute(Job &job)
+{
+	job.function();
+
+	if (job.counter == nullptr)
+	{
+		return;
+	}
+
+	// Last job of the counter: start everything that was waiting on it.
+	// Counter only hits zero under its lock and isn't touched after, see wait()
+	std::vector<JobCounter::WaitingJob> waiting;
+	{
+		std::lock_guard<std::mutex> lock(job.counter->m_waitingMutex);
+		if (--job.counter->m_pending == 0)
+		{
+			waiting.swap(job.counter->m_waiting);
+		}
+	}
+	for (auto &waitingJob : waiting)
+	{
+		schedule({ std::move(waitingJob.function), waitingJob.counter });
+	}
+}
+
+void JobSystem::stopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stopping = true;
+	}
+	m_sleepCondition.notify_all();
+
+	for (auto &worker : m_workers)
+	{
+		if (worker.joinable())
+		{
+			worker.join();
+		}
+	}
+	m_workers.clear();
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class JobSystem;
+
+// Number of jobs still to finish. Jobs run with a counter add 1 to it and take 1 off when done;
+// wait() on it, or pass it as another job's dependency to start that job only once it hits zero.
+// NOTE: must outlive every job that uses it (counting or depending on it); wait() on it before destroying it
+class JobCounter
+{
+public:
+	JobCounter();
+
+	bool isDone() const;
+
+	~JobCounter();
+
+private:
+	friend class JobSystem;
+
+	struct WaitingJob
+	{
+		std::function<void()> function;
+		JobCounter			 *counter;
+	};
+
+	std::atomic<uint32_t>	m_pending;
+	std::mutex				m_waitingMutex;
+	std::vector<WaitingJob> m_waiting;			// Jobs depending on this counter, started when it hits zero
+
+	JobCounter(const JobCounter &) = delete;
+	JobCounter &operator=(const JobCounter &) = delete;
+};
+
+// Work stealing job scheduler. Each worker thread (and the main thread) has its own deque: it pushes and pops
+// its own jobs at the back (newest first, still warm in cache) while idle workers steal the oldest from the front
+// of someone else's. Idle workers sleep until new work is queued.
+// The thread that calls init() is the main thread: jobs queued with runOnMainThread() only ever run there
+// (GLFW calls, anything else tied to the window), when it calls pumpMainThread() or wait().
+class JobSystem
+{
+public:
+	typedef std::function<void()> JobFunction;
+
+	JobSystem();
+
+	void init(uint32_t workerCount = 0);		// 0 == one less than the number of hardware threads
+
+	// Queue a job. It counts against counter (if any) and only starts once dependency (if any) is done
+	void run(JobFunction function, JobCounter *counter = nullptr, JobCounter *dependency = nullptr);
+
+	// Queue a job that must run on the main thread
+	void runOnMainThread(JobFunction function, JobCounter *counter = nullptr);
+
+	// Run function(begin, end) over [0, count) in chunks of at most chunkSize, as separate jobs counting against counter
+	void parallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)> &function,
+		JobCounter &counter);
+
+	// Run other jobs (main thread: also main thread jobs) until counter hits zero
+	void wait(JobCounter &counter);
+
+	// Run every queued main thread job; call once per frame from the main thread
+	void pumpMainThread();
+
+	bool isMainThread() const;
+	uint32_t getWorkerCount() const;			// Worker threads, not counting the main thread
+
+	void destroy();
+
+	~JobSystem();
+
+private:
+	struct Job
+	{
+		JobFunction function;
+		JobCounter *counter;
+	};
+
+	struct WorkerQueue
+	{
+		std::mutex		mutex;
+		std::deque<Job> jobs;
+	};
+
+	// -- Queues: [0] belongs to the main thread, [i] to worker thread i
+	std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+	std::atomic<uint32_t>					  m_queuedJobs;	// Jobs sitting in any of m_queues
+	std::mutex								  m_mainThreadMutex;
+	std::vector<Job>						  m_mainThreadJobs;
+
+	// -- Workers
+	std::vector<std::thread> m_workers;
+	std::thread::id			 m_mainThreadId;
+	std::atomic<bool>		 m_stopping;
+	std::atomic<uint32_t>	 m_sleepingWorkers;
+	std::mutex				 m_sleepMutex;
+	std::condition_variable	 m_sleepCondition;
+
+	void workerLoop(uint32_t queueIndex);
+	void schedule(Job job);
+	bool findJob(uint32_t queueIndex, Job &job);
+	void execute(Job &job);
+	void stopWorkers();
+};
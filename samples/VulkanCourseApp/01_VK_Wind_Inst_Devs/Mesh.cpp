@@ -1,7 +1,65 @@
 #include "Mesh.h"
 
+#include <cstring>
 #include <iostream>
+#include <limits>
 
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "BatchPack.h"
+
+
+// Cut the triangles (in order) into sub meshes of at most k_maxIndex16Vertices vertices each, every sub mesh with its
+// own copy of the vertices it uses, in order of first use
+static void splitFor16BitIndices(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+	std::vector<Vertex> &splitVertices, std::vector<uint16_t> &splitIndices, std::vector<SubMesh> &subMeshes)
+{
+	const uint32_t noSubMesh = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> vertexSubMesh(vertices.size(), noSubMesh);	// Last sub mesh that used each vertex
+	std::vector<uint16_t> localIndex(vertices.size());					// Its index in that sub mesh
+
+	splitVertices.clear();
+	splitIndices.clear();
+	subMeshes.clear();
+	SubMesh subMesh;
+	uint32_t subMeshVertexCount = 0;
+	for (size_t triangle = 0; triangle < indices.size() / 3; triangle++)
+	{
+		const uint32_t *corners = &indices[triangle * 3];
+		uint32_t subMeshIndex = static_cast<uint32_t>(subMeshes.size());
+
+		// Start the next sub mesh if this triangle's new vertices don't fit anymore
+		uint32_t newVertices = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			bool repeated = (corner > 0 && corners[corner] == corners[0]) || (corner > 1 && corners[corner] == corners[1]);
+			newVertices += (vertexSubMesh[corners[corner]] != subMeshIndex && !repeated) ? 1 : 0;
+		}
+		if (subMeshVertexCount + newVertices > k_maxIndex16Vertices)
+		{
+			subMeshes.push_back(subMesh);
+			subMesh.firstIndex = static_cast<uint32_t>(splitIndices.size());
+			subMesh.indexCount = 0;
+			subMesh.vertexOffset = static_cast<int32_t>(splitVertices.size());
+			subMeshVertexCount = 0;
+			subMeshIndex++;
+		}
+
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t v = corners[corner];
+			if (vertexSubMesh[v] != subMeshIndex)
+			{
+				vertexSubMesh[v] = subMeshIndex;
+				localIndex[v] = static_cast<uint16_t>(subMeshVertexCount++);
+				splitVertices.push_back(vertices[v]);
+			}
+			splitIndices.push_back(localIndex[v]);
+		}
+		subMesh.indexCount += 3;
+	}
+	subMeshes.push_back(subMesh);
+}
 
 Mesh::Mesh()
 {
@@ -9,14 +67,134 @@ Mesh::Mesh()
 
 Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, 
 			VkQueue transferQueue, VkCommandPool transferCommandPool, 
-			std::vector<Vertex>* vertices, std::vector<uint32_t>* indices)
+			std::vector<Vertex>* vertices, std::vector<uint32_t>* indices, const MeshSettings &settings, JobSystem *jobSystem)
 {
+	// Triangle and vertex order optimized before anything is uploaded (on copies: the caller's data stays as it was)
+	std::vector<Vertex> optimizedVertices = *vertices;
+	std::vector<uint32_t> optimizedIndices = *indices;
+	m_optimizeStats = optimizeMesh(optimizedVertices, optimizedIndices, jobSystem);
+	vertices = &optimizedVertices;
+	indices = &optimizedIndices;
+
+	// 16 bit indices when every index fits (half the index memory and bandwidth), else 32 bit or split in sub meshes
+	std::vector<uint16_t> indices16;
+	if (vertices->size() <= k_maxIndex16Vertices)
+	{
+		indices16.assign(indices->begin(), indices->end());
+		m_indexType = VK_INDEX_TYPE_UINT16;
+		m_subMeshes.resize(1);
+		m_subMeshes[0].indexCount = static_cast<uint32_t>(indices->size());
+	}
+	else if (settings.split16BitIndices)
+	{
+		std::vector<Vertex> splitVertices;
+		splitFor16BitIndices(*vertices, *indices, splitVertices, indices16, m_subMeshes);
+		optimizedVertices.swap(splitVertices);
+		m_indexType = VK_INDEX_TYPE_UINT16;
+	}
+	else
+	{
+		m_indexType = VK_INDEX_TYPE_UINT32;
+		m_subMeshes.resize(1);
+		m_subMeshes[0].indexCount = static_cast<uint32_t>(indices->size());
+	}
+
 	m_vertexCount		= vertices->size();
 	m_indexCount		= indices->size();
 	m_physicalDevice	= newPhysicalDevice;
 	m_device			= newDevice;
-	createVertexBuffer(transferQueue, transferCommandPool, vertices);
-	createIndexBuffer(transferQueue, transferCommandPool, indices);
+
+	glm::vec3 boundsMin(std::numeric_limits<float>::max());
+	glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+	for (const auto &vertex : *vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.a_position);
+		boundsMax = glm::max(boundsMax, vertex.a_position);
+	}
+	m_center = vertices->empty() ? glm::vec3(0.0f) : (boundsMin + boundsMax) * 0.5f;
+	m_extents = vertices->empty() ? glm::vec3(0.0f) : (boundsMax - boundsMin) * 0.5f;
+
+	// Meshlets of each sub mesh, from the final (optimized, split) indices and the float positions
+	VkBufferUsageFlags vertexUsage = 0;
+	if (settings.buildMeshlets)
+	{
+		std::vector<uint32_t> indices32;
+		const uint32_t *meshletIndices = indices->data();
+		if (m_indexType == VK_INDEX_TYPE_UINT16)
+		{
+			indices32.assign(indices16.begin(), indices16.end());
+			meshletIndices = indices32.data();
+		}
+
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> meshletData;
+		for (const auto &subMesh : m_subMeshes)
+		{
+			buildMeshlets(vertices->data() + subMesh.vertexOffset, meshletIndices, subMesh.firstIndex, subMesh.indexCount,
+				subMesh.vertexOffset, meshlets, meshletData);
+		}
+
+		m_meshletCount = static_cast<uint32_t>(meshlets.size());
+		if (!meshlets.empty())
+		{
+			createStorageBuffer(transferQueue, transferCommandPool, meshlets.data(), sizeof(Meshlet) * meshlets.size(),
+				&m_meshletBuffer, &m_meshletBufferMemory);
+			createStorageBuffer(transferQueue, transferCommandPool, meshletData.data(), sizeof(uint32_t) * meshletData.size(),
+				&m_meshletDataBuffer, &m_meshletDataBufferMemory);
+		}
+		vertexUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	}
+
+	if (!settings.compactVertices)
+	{
+		createVertexBuffer(transferQueue, transferCommandPool, vertices->data(), sizeof(Vertex) * vertices->size(), vertexUsage);
+	}
+	else
+	{
+		// Positions relative to the bounds, so the 16 bits only cover the mesh; flat axes keep a scale of 1 (all 0 anyway)
+		glm::vec3 scale = m_extents;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (scale[axis] <= 0.0f)
+			{
+				scale[axis] = 1.0f;
+			}
+		}
+		m_dequantize = glm::translate(glm::mat4(1.0f), m_center) * glm::scale(glm::mat4(1.0f), scale);
+
+		std::vector<float> positions(vertices->size() * 4);
+		std::vector<float> colors(vertices->size() * 4);
+		for (size_t i = 0; i < vertices->size(); i++)
+		{
+			glm::vec3 position = ((*vertices)[i].a_position - m_center) / scale;
+			const glm::vec3 &color = (*vertices)[i].a_color;
+			memcpy(&positions[i * 4], &position, sizeof(glm::vec3));
+			memcpy(&colors[i * 4], &color, sizeof(glm::vec3));
+			positions[i * 4 + 3] = 0.0f;
+			colors[i * 4 + 3] = 1.0f;
+		}
+
+		std::vector<int16_t> packedPositions(positions.size());
+		std::vector<uint8_t> packedColors(colors.size());
+		packSnorm16Array(positions.data(), positions.size(), packedPositions.data());
+		packUnorm8Array(colors.data(), colors.size(), packedColors.data());
+
+		std::vector<CompactVertex> compact(vertices->size());
+		for (size_t i = 0; i < compact.size(); i++)
+		{
+			memcpy(compact[i].a_position, &packedPositions[i * 4], sizeof(compact[i].a_position));
+			memcpy(compact[i].a_color, &packedColors[i * 4], sizeof(compact[i].a_color));
+		}
+		createVertexBuffer(transferQueue, transferCommandPool, compact.data(), sizeof(CompactVertex) * compact.size(), vertexUsage);
+	}
+	if (m_indexType == VK_INDEX_TYPE_UINT16)
+	{
+		createIndexBuffer(transferQueue, transferCommandPool, indices16.data(), sizeof(uint16_t) * indices16.size());
+	}
+	else
+	{
+		createIndexBuffer(transferQueue, transferCommandPool, indices->data(), sizeof(uint32_t) * indices->size());
+	}
 }
 
 int Mesh::getVertexCount()
@@ -39,6 +217,66 @@ VkBuffer Mesh::getIndexBuffer()
 	return m_indexBuffer;
 }
 
+VkIndexType Mesh::getIndexType()
+{
+	return m_indexType;
+}
+
+const std::vector<SubMesh> &Mesh::getSubMeshes()
+{
+	return m_subMeshes;
+}
+
+void Mesh::setOpacity(float opacity)
+{
+	m_opacity = opacity;
+}
+
+float Mesh::getOpacity()
+{
+	return m_opacity;
+}
+
+bool Mesh::isTransparent()
+{
+	return m_opacity < 1.0f;
+}
+
+glm::vec3 Mesh::getCenter()
+{
+	return m_center;
+}
+
+glm::vec3 Mesh::getExtents()
+{
+	return m_extents;
+}
+
+glm::mat4 Mesh::getDequantizeMatrix()
+{
+	return m_dequantize;
+}
+
+MeshOptimizeStats Mesh::getOptimizeStats()
+{
+	return m_optimizeStats;
+}
+
+uint32_t Mesh::getMeshletCount()
+{
+	return m_meshletCount;
+}
+
+VkBuffer Mesh::getMeshletBuffer()
+{
+	return m_meshletBuffer;
+}
+
+VkBuffer Mesh::getMeshletDataBuffer()
+{
+	return m_meshletDataBuffer;
+}
+
 void Mesh::destroyBuffers()
 {
 	vkDestroyBuffer(m_device, m_vertexBuffer, nullptr);
@@ -46,6 +284,14 @@ void Mesh::destroyBuffers()
 
 	vkDestroyBuffer(m_device, m_indexBuffer, nullptr);
 	vkFreeMemory(m_device, m_indexBufferMemory, nullptr);
+
+	if (m_meshletBuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(m_device, m_meshletBuffer, nullptr);
+		vkFreeMemory(m_device, m_meshletBufferMemory, nullptr);
+		vkDestroyBuffer(m_device, m_meshletDataBuffer, nullptr);
+		vkFreeMemory(m_device, m_meshletDataBufferMemory, nullptr);
+	}
 }
 
 
@@ -53,11 +299,9 @@ Mesh::~Mesh()
 {
 }
 
-void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex>* vertices)
+void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, const void *vertexData, VkDeviceSize bufferSize,
+							  VkBufferUsageFlags extraUsage)
 {
-	// Get size of buffer needed for vertices
-	VkDeviceSize  bufferSize = sizeof(Vertex) * vertices->size();
-
 	//TEMP: Buffers to "stage" vertex data before transferring it to GPU
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
@@ -70,12 +314,12 @@ void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
 	/*-- MAP MEMORY TO STAGING BUFFER --*/
 	void* data;																		// 1. Create pointer to point in normal memory
 	vkMapMemory(m_device, stagingBufferMemory, 0, bufferSize, 0, &data);	// 2. "Map" the vertex buffer mem to that point
-	memcpy(data, vertices->data(), (size_t)bufferSize);							// 3. Copy mem from vertices vector to that point
+	memcpy(data, vertexData, (size_t)bufferSize);									// 3. Copy mem from the vertex data to that point
 	vkUnmapMemory(m_device, stagingBufferMemory);									// 4. UnMap the vertex buffer memory
 
 	// CREATE BUFFER w/ TRANSFER_DST_BIT to mark as a recipient of transfer data (also vertex buffer)
 	// Buffer memory is to be DEVICE_LOCAL_BIT ==> m/o is on GPU and only accessible by it and not CPU (HOST)
-	createBuffer(m_physicalDevice, m_device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
+	createBuffer(m_physicalDevice, m_device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | extraUsage, 
 				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_vertexBuffer, &m_vertexBufferMemory);
 
 	// Copying staging buffer to vertex buffer on GPU
@@ -86,11 +330,8 @@ void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
 	vkFreeMemory(m_device, stagingBufferMemory, nullptr);
 }
 
-void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t>* indices)
+void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, const void *indexData, VkDeviceSize bufferSize)
 {
-	// Get size of buffer needed for indices
-	VkDeviceSize bufferSize = sizeof(uint32_t) * indices->size();
-
 	//TEMP: Buffers to "stage" index data before transferring it to GPU
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
@@ -101,7 +342,7 @@ void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferComman
 	/*-- MAP MEMORY TO STAGING BUFFER --*/
 	void* data;																		
 	vkMapMemory(m_device, stagingBufferMemory, 0, bufferSize, 0, &data);	
-	memcpy(data, indices->data(), (size_t)bufferSize);							
+	memcpy(data, indexData, (size_t)bufferSize);							
 	vkUnmapMemory(m_device, stagingBufferMemory);									
 
 	//Create Buffer for index data on GPU access only area
@@ -116,3 +357,26 @@ void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferComman
 	vkFreeMemory(m_device, stagingBufferMemory, nullptr);
 }
 
+void Mesh::createStorageBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, const void *data, VkDeviceSize bufferSize,
+							   VkBuffer *buffer, VkDeviceMemory *bufferMemory)
+{
+	// Same staging upload as the vertex and index buffers, into a buffer shaders read
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(m_physicalDevice, m_device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&stagingBuffer, &stagingBufferMemory);
+
+	void* mapped;
+	vkMapMemory(m_device, stagingBufferMemory, 0, bufferSize, 0, &mapped);
+	memcpy(mapped, data, (size_t)bufferSize);
+	vkUnmapMemory(m_device, stagingBufferMemory);
+
+	createBuffer(m_physicalDevice, m_device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, bufferMemory);
+
+	copyBuffer(m_device, transferQueue, transferCommandPool, stagingBuffer, *buffer, bufferSize);
+
+	vkDestroyBuffer(m_device, stagingBuffer, nullptr);
+	vkFreeMemory(m_device, stagingBufferMemory, nullptr);
+}
@@ -5,6 +5,28 @@
 
 #include <vector>
 #include "Utilities.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+
+// Options picked when a mesh is created
+struct MeshSettings
+{
+	bool compactVertices = false;		// CompactVertex buffer instead of Vertex (see Utilities.h)
+	bool split16BitIndices = false;		// More vertices than 16 bit indices can reach: split in sub meshes that fit instead of
+										// using 32 bit indices (vertices shared between sub meshes are duplicated)
+	bool buildMeshlets = false;			// Also cut it into meshlets for GPU culling (storage buffers, see Meshlets.h)
+};
+
+// Range of a mesh's index buffer drawn with one vkCmdDrawIndexed
+struct SubMesh
+{
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	int32_t	 vertexOffset = 0;			// Added to each index: where the sub mesh's vertices start in the vertex buffer
+};
+
+// Most vertices a mesh (or sub mesh) can have for 16 bit indices; index 0xFFFF stays free for primitive restart
+const size_t k_maxIndex16Vertices = 0xFFFF;
 
 class Mesh
 {
@@ -13,13 +35,41 @@ public:
 
 	Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice,
 		 VkQueue transferQueue, VkCommandPool transferCommandPool, 
-		 std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+		 std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
+		 const MeshSettings &settings = MeshSettings(), JobSystem *jobSystem = nullptr);
 
 	int getVertexCount();
 	VkBuffer getVertexBuffer();
 
 	int getIndexCount();
 	VkBuffer getIndexBuffer();
+	VkIndexType getIndexType();				// VK_INDEX_TYPE_UINT16 whenever the vertices (or sub meshes) allow it
+
+	// Draws making up the mesh: just one, unless it was split for 16 bit indices
+	const std::vector<SubMesh> &getSubMeshes();
+
+	// Opacity < 1 makes the mesh transparent: drawn blended, back to front, after all opaque meshes
+	void setOpacity(float opacity);
+	float getOpacity();
+	bool isTransparent();
+
+	// Center of the vertex bounds in model space (sort key for transparent meshes)
+	glm::vec3 getCenter();
+
+	// Half size of the vertex bounds in model space
+	glm::vec3 getExtents();
+
+	// Model space position from the one in the vertex buffer: identity, or back from the bounds for CompactVertex
+	glm::mat4 getDequantizeMatrix();
+
+	// Vertex cache efficiency of the indices as passed in and as uploaded (see optimizeMesh)
+	MeshOptimizeStats getOptimizeStats();
+
+	// Only with MeshSettings::buildMeshlets: Meshlet array and meshlet data (vertex lists, packed triangles) on the GPU.
+	// The vertex buffer is then also a storage buffer, for mesh shaders to read
+	uint32_t getMeshletCount();
+	VkBuffer getMeshletBuffer();
+	VkBuffer getMeshletDataBuffer();
 
 	void destroyBuffers();
 
@@ -33,12 +83,29 @@ private:
 	int				 m_indexCount;
 	VkBuffer		 m_indexBuffer;
 	VkDeviceMemory   m_indexBufferMemory;
+	VkIndexType		 m_indexType = VK_INDEX_TYPE_UINT32;
+	std::vector<SubMesh> m_subMeshes;
+
+	float			 m_opacity = 1.0f;
+	glm::vec3		 m_center = glm::vec3(0.0f);
+	glm::vec3		 m_extents = glm::vec3(0.0f);
+	glm::mat4		 m_dequantize = glm::mat4(1.0f);
+	MeshOptimizeStats m_optimizeStats;
+
+	uint32_t		 m_meshletCount = 0;
+	VkBuffer		 m_meshletBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory	 m_meshletBufferMemory = VK_NULL_HANDLE;
+	VkBuffer		 m_meshletDataBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory	 m_meshletDataBufferMemory = VK_NULL_HANDLE;
 
 	VkPhysicalDevice m_physicalDevice;
 	VkDevice		 m_device;
 
-	void createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex>* vertices);
-	void createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t>* indices);
+	void createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, const void *vertexData, VkDeviceSize bufferSize,
+							VkBufferUsageFlags extraUsage);
+	void createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, const void *indexData, VkDeviceSize bufferSize);
+	void createStorageBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, const void *data, VkDeviceSize bufferSize,
+							 VkBuffer *buffer, VkDeviceMemory *bufferMemory);
 	
 
 };
@@ -0,0 +1,459 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+
+static const uint32_t k_noVertex = std::numeric_limits<uint32_t>::max();
+
+// FIFO post-transform cache: a vertex stays cached until cacheSize other vertices were loaded after it
+// Load times instead of an actual queue, so a lookup is one subtraction and a reset is free
+class FifoCache
+{
+public:
+	FifoCache(size_t vertexCount, uint32_t cacheSize)
+		: m_loadTime(vertexCount, 0), m_time(cacheSize + 1), m_cacheSize(cacheSize)
+	{
+	}
+
+	// Misses loaded since v (> cacheSize: not cached)
+	uint32_t getAge(uint32_t v) const
+	{
+		return m_time - m_loadTime[v];
+	}
+
+	bool isCached(uint32_t v) const
+	{
+		return getAge(v) <= m_cacheSize;
+	}
+
+	// True on a miss (the vertex shader runs)
+	bool access(uint32_t v)
+	{
+		if (isCached(v))
+		{
+			return false;
+		}
+		m_loadTime[v] = m_time++;
+		return true;
+	}
+
+	// Empty the cache
+	void reset()
+	{
+		m_time += m_cacheSize + 1;
+	}
+
+private:
+	std::vector<uint32_t> m_loadTime;
+	uint32_t			  m_time;
+	uint32_t			  m_cacheSize;
+};
+
+
+VertexCacheStats analyzeVertexCache(const uint32_t *indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats;
+	if (indexCount < 3)
+	{
+		return stats;
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<uint8_t> used(vertexCount, 0);
+	size_t misses = 0;
+	size_t usedVertices = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		misses += cache.access(indices[i]) ? 1 : 0;
+		if (!used[indices[i]])
+		{
+			used[indices[i]] = 1;
+			usedVertices++;
+		}
+	}
+
+	stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(usedVertices);
+	return stats;
+}
+
+void optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t> &clusters, uint32_t cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	clusters.clear();
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles using each vertex: triangles of v are adjacency[adjacencyOffsets[v] .. adjacencyOffsets[v + 1])
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacencyOffsets[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	// Triangles of each vertex not emitted yet
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<uint8_t>  emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEndStack;					// Recently emitted vertices, tried first when fanning runs into a dead end
+	std::vector<uint32_t> candidates;					// Vertices of the triangles just emitted
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	uint32_t scanVertex = 0;							// Vertices before this have no live triangles left
+
+	// Next vertex to fan around after a dead end: a recent one with triangles left, else the next one in order
+	auto skipDeadEnd = [&]() {
+		while (!deadEndStack.empty())
+		{
+			uint32_t v = deadEndStack.back();
+			deadEndStack.pop_back();
+			if (liveTriangles[v] > 0)
+			{
+				return v;
+			}
+		}
+		while (scanVertex < vertexCount)
+		{
+			if (liveTriangles[scanVertex] > 0)
+			{
+				return scanVertex;
+			}
+			scanVertex++;
+		}
+		return k_noVertex;
+	};
+
+	clusters.push_back(0);
+	uint32_t fanningVertex = skipDeadEnd();
+	while (fanningVertex != k_noVertex)
+	{
+		// Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; a++)
+		{
+			uint32_t triangle = adjacency[a];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			emitted[triangle] = 1;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				uint32_t v = indices[triangle * 3 + corner];
+				output.push_back(v);
+				deadEndStack.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				cache.access(v);
+			}
+		}
+
+		// Fan around the candidate that entered the cache earliest and is still cached once its own triangles are out
+		// (each of them loads at most 2 new vertices); any candidate with triangles left beats none
+		uint32_t nextVertex = k_noVertex;
+		int64_t bestPriority = -1;
+		for (uint32_t v : candidates)
+		{
+			if (liveTriangles[v] == 0)
+			{
+				continue;
+			}
+			int64_t priority = 0;
+			if (cache.getAge(v) + 2 * liveTriangles[v] <= cacheSize)
+			{
+				priority = cache.getAge(v);
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				nextVertex = v;
+			}
+		}
+
+		// Dead end: the cache order is broken here, which makes it a cluster boundary
+		if (nextVertex == k_noVertex)
+		{
+			nextVertex = skipDeadEnd();
+			if (nextVertex != k_noVertex)
+			{
+				clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+			}
+		}
+		fanningVertex = nextVertex;
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeOverdraw(uint32_t *indices, size_t indexCount, const glm::vec3 *positions, size_t vertexCount,
+	const std::vector<uint32_t> &clusters, float threshold, uint32_t cacheSize)
+{
+	uint32_t triangleCount = static_cast<uint32_t>(indexCount / 3);
+	if (triangleCount == 0 || clusters.empty())
+	{
+		return;
+	}
+
+	// Soft boundaries: cut each cluster as soon as the triangles since the last cut have an ACMR at most threshold
+	// times the whole cluster's, so the finer order costs little cache efficiency
+	std::vector<uint32_t> boundaries;
+	FifoCache cache(vertexCount, cacheSize);
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		uint32_t begin = clusters[c];
+		uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+		cache.reset();
+		uint32_t clusterMisses = 0;
+		for (uint32_t i = begin * 3; i < end * 3; i++)
+		{
+			clusterMisses += cache.access(indices[i]) ? 1 : 0;
+		}
+		float maxAcmr = threshold * clusterMisses / (end - begin);
+
+		cache.reset();
+		uint32_t start = begin;
+		uint32_t misses = 0;
+		boundaries.push_back(begin);
+		for (uint32_t triangle = begin; triangle < end; triangle++)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				misses += cache.access(indices[triangle * 3 + corner]) ? 1 : 0;
+			}
+			if (triangle + 1 < end && misses <= maxAcmr * (triangle + 1 - start))
+			{
+				boundaries.push_back(triangle + 1);
+				start = triangle + 1;
+				misses = 0;
+				cache.reset();
+			}
+		}
+	}
+	boundaries.push_back(triangleCount);
+
+	// Area weighted center and normal of each cluster, and of the whole mesh
+	size_t clusterCount = boundaries.size() - 1;
+	std::vector<glm::vec3> clusterCenters(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float clusterArea = 0.0f;
+		for (uint32_t triangle = boundaries[c]; triangle < boundaries[c + 1]; triangle++)
+		{
+			const glm::vec3 &p0 = positions[indices[triangle * 3 + 0]];
+			const glm::vec3 &p1 = positions[indices[triangle * 3 + 1]];
+			const glm::vec3 &p2 = positions[indices[triangle * 3 + 2]];
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);		// length: twice the area
+			float area = glm::length(normal);
+			clusterCenters[c] += (p0 + p1 + p2) * (area / 3.0f);
+			clusterNormals[c] += normal;
+			clusterArea += area;
+		}
+		meshCenter += clusterCenters[c];
+		meshArea += clusterArea;
+		clusterCenters[c] = clusterArea > 0.0f ? clusterCenters[c] / clusterArea : positions[indices[boundaries[c] * 3]];
+	}
+	meshCenter = meshArea > 0.0f ? meshCenter / meshArea : glm::vec3(0.0f);
+
+	// Clusters facing away from the center occlude the rest of the mesh more often than they are occluded: draw them first.
+	// Equal keys keep Tipsify's order
+	std::vector<std::pair<float, uint32_t>> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float length = glm::length(clusterNormals[c]);
+		glm::vec3 normal = length > 0.0f ? clusterNormals[c] / length : glm::vec3(0.0f);
+		order[c] = { glm::dot(clusterCenters[c] - meshCenter, normal), static_cast<uint32_t>(c) };
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[](const std::pair<float, uint32_t> &a, const std::pair<float, uint32_t> &b) { return a.first > b.first; });
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	for (const auto &cluster : order)
+	{
+		output.insert(output.end(), indices + boundaries[cluster.second] * 3, indices + boundaries[cluster.second + 1] * 3);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), k_noVertex);
+	std::vector<Vertex> ordered;
+	ordered.reserve(vertices.size());
+	for (auto &index : indices)
+	{
+		if (remap[index] == k_noVertex)
+		{
+			remap[index] = static_cast<uint32_t>(ordered.size());
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(ordered);
+}
+
+// Vertex cache then overdraw order of one chunk of triangles
+static void optimizeTriangles(uint32_t *indices, size_t indexCount, const glm::vec3 *positions, size_t vertexCount)
+{
+	std::vector<uint32_t> clusters;
+	optimizeVertexCache(indices, indexCount, vertexCount, clusters);
+	optimizeOverdraw(indices, indexCount, positions, vertexCount, clusters);
+}
+
+// Chunk of a big mesh: renumbered to just the vertices it uses, so the per vertex arrays stay chunk sized
+static void optimizeChunk(uint32_t *indices, size_t indexCount, const std::vector<glm::vec3> &positions)
+{
+	std::vector<uint32_t> localVertex(positions.size(), k_noVertex);
+	std::vector<uint32_t> chunkVertices;						// Global index of each local vertex
+	std::vector<uint32_t> localIndices(indexCount);
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		if (localVertex[indices[i]] == k_noVertex)
+		{
+			localVertex[indices[i]] = static_cast<uint32_t>(chunkVertices.size());
+			chunkVertices.push_back(indices[i]);
+		}
+		localIndices[i] = localVertex[indices[i]];
+	}
+	std::vector<glm::vec3> localPositions(chunkVertices.size());
+	for (size_t v = 0; v < chunkVertices.size(); v++)
+	{
+		localPositions[v] = positions[chunkVertices[v]];
+	}
+
+	optimizeTriangles(localIndices.data(), indexCount, localPositions.data(), chunkVertices.size());
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		indices[i] = chunkVertices[localIndices[i]];
+	}
+}
+
+// 10 bits of x, y and z interleaved: nearby points get nearby codes
+static uint32_t mortonCode(glm::vec3 p)
+{
+	auto spread = [](uint32_t x) {
+		x = (x | (x << 16)) & 0x030000FF;
+		x = (x | (x << 8)) & 0x0300F00F;
+		x = (x | (x << 4)) & 0x030C30C3;
+		x = (x | (x << 2)) & 0x09249249;
+		return x;
+	};
+	glm::uvec3 q(glm::clamp(p, 0.0f, 1.0f) * 1023.0f);
+	return spread(q.x) | (spread(q.y) << 1) | (spread(q.z) << 2);
+}
+
+// function(begin, end) over [0, count): split over the job system's workers, or all at once without one
+static void runChunks(JobSystem *jobSystem, uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)> &function)
+{
+	if (jobSystem == nullptr)
+	{
+		function(0, count);
+		return;
+	}
+	JobCounter done;
+	jobSystem->parallelFor(count, chunkSize, function, done);
+	jobSystem->wait(done);
+}
+
+MeshOptimizeStats optimizeMesh(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices, JobSystem *jobSystem)
+{
+	if (indices.size() % 3 != 0)
+	{
+		throw std::runtime_error("Failed to optimize a MESH: index count is not a multiple of 3!");
+	}
+	for (uint32_t index : indices)
+	{
+		if (index >= vertices.size())
+		{
+			throw std::runtime_error("Failed to optimize a MESH: index past the last vertex!");
+		}
+	}
+
+	MeshOptimizeStats stats;
+	stats.before = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+
+	std::vector<glm::vec3> positions(vertices.size());
+	for (size_t v = 0; v < vertices.size(); v++)
+	{
+		positions[v] = vertices[v].a_position;
+	}
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount <= k_meshOptimizeChunkTriangles)
+	{
+		optimizeTriangles(indices.data(), indices.size(), positions.data(), positions.size());
+	}
+	else
+	{
+		// Triangles along a Morton curve through the bounds, so each chunk is one compact patch sharing few vertices
+		glm::vec3 boundsMin(std::numeric_limits<float>::max());
+		glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+		for (const auto &position : positions)
+		{
+			boundsMin = glm::min(boundsMin, position);
+			boundsMax = glm::max(boundsMax, position);
+		}
+		glm::vec3 scale = 1.0f / glm::max(boundsMax - boundsMin, glm::vec3(std::numeric_limits<float>::min()));
+
+		std::vector<uint64_t> keys(triangleCount);					// Morton code << 32 | triangle
+		auto computeKeys = [&keys, &indices, &positions, boundsMin, scale](uint32_t begin, uint32_t end) {
+			for (uint32_t t = begin; t < end; t++)
+			{
+				glm::vec3 center = (positions[indices[t * 3]] + positions[indices[t * 3 + 1]] + positions[indices[t * 3 + 2]]) / 3.0f;
+				keys[t] = (static_cast<uint64_t>(mortonCode((center - boundsMin) * scale)) << 32) | t;
+			}
+		};
+		runChunks(jobSystem, static_cast<uint32_t>(triangleCount), static_cast<uint32_t>(k_meshOptimizeChunkTriangles), computeKeys);
+		std::sort(keys.begin(), keys.end());
+
+		std::vector<uint32_t> sorted(indices.size());
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			uint32_t triangle = static_cast<uint32_t>(keys[t]);
+			std::copy(&indices[triangle * 3], &indices[triangle * 3] + 3, &sorted[t * 3]);
+		}
+		indices.swap(sorted);
+
+		// Chunks touch disjoint index ranges: optimize them on any thread
+		uint32_t chunkCount = static_cast<uint32_t>((triangleCount + k_meshOptimizeChunkTriangles - 1) / k_meshOptimizeChunkTriangles);
+		auto optimizeChunks = [&indices, &positions, triangleCount](uint32_t begin, uint32_t end) {
+			for (uint32_t chunk = begin; chunk < end; chunk++)
+			{
+				size_t first = chunk * k_meshOptimizeChunkTriangles;
+				size_t count = std::min(k_meshOptimizeChunkTriangles, triangleCount - first);
+				optimizeChunk(indices.data() + first * 3, count * 3, positions);
+			}
+		};
+		runChunks(jobSystem, chunkCount, 1, optimizeChunks);
+	}
+
+	optimizeVertexFetch(vertices, indices);
+
+	stats.after = analyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	return stats;
+}
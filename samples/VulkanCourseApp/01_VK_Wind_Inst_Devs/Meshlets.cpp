@@ -0,0 +1,185 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+// Cones whose triangles face further apart than this (min dot with the axis) cull too rarely to be worth testing
+static const float k_minConeDot = 0.1f;
+
+// Bounding sphere and normal cone of the meshlet's vertices and triangles (already in meshletData)
+static void computeMeshletBounds(const Vertex *vertices, const std::vector<uint32_t> &meshletData, Meshlet &meshlet)
+{
+	const uint32_t *meshletVertices = &meshletData[meshlet.dataOffset];
+	const uint32_t *triangles = meshletVertices + meshlet.vertexCount;
+	int32_t firstVertex = meshlet.vertexOffset;
+	auto position = [&](uint32_t localVertex) {
+		return vertices[meshletVertices[localVertex] - firstVertex].a_position;
+	};
+
+	// Sphere around the center of the box: not the tightest, but cheap and never far off for a compact cluster
+	glm::vec3 boundsMin(std::numeric_limits<float>::max());
+	glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+	for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+	{
+		boundsMin = glm::min(boundsMin, position(v));
+		boundsMax = glm::max(boundsMax, position(v));
+	}
+	meshlet.center = (boundsMin + boundsMax) * 0.5f;
+	meshlet.radius = 0.0f;
+	for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+	{
+		meshlet.radius = std::max(meshlet.radius, glm::length(position(v) - meshlet.center));
+	}
+
+	// Cone: axis is the average facing, half angle reaches the triangle furthest from it (degenerate triangles face nowhere)
+	uint32_t triangleCount = meshlet.indexCount / 3;
+	std::vector<glm::vec3> normals;
+	normals.reserve(triangleCount);
+	glm::vec3 normalSum(0.0f);
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		glm::vec3 a = position(triangles[t] & 0xFF);
+		glm::vec3 b = position((triangles[t] >> 8) & 0xFF);
+		glm::vec3 c = position((triangles[t] >> 16) & 0xFF);
+		glm::vec3 normal = glm::cross(b - a, c - a);		// Counter clockwise is front facing
+		float length = glm::length(normal);
+		if (length > 0.0f)
+		{
+			normals.push_back(normal / length);
+			normalSum += normals.back();
+		}
+	}
+
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+	float sumLength = glm::length(normalSum);
+	if (normals.empty() || sumLength <= 0.0f)
+	{
+		return;
+	}
+	glm::vec3 axis = normalSum / sumLength;
+	float minDot = 1.0f;
+	for (const auto &normal : normals)
+	{
+		minDot = std::min(minDot, glm::dot(axis, normal));
+	}
+	meshlet.coneAxis = axis;
+	if (minDot > k_minConeDot)
+	{
+		meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);		// sin of the half angle: cos is minDot
+	}
+}
+
+void buildMeshlets(const Vertex *vertices, const uint32_t *indices, uint32_t firstIndex, uint32_t indexCount, int32_t vertexOffset,
+	std::vector<Meshlet> &meshlets, std::vector<uint32_t> &meshletData)
+{
+	if (indexCount < 3)
+	{
+		return;
+	}
+	const uint32_t *rangeIndices = indices + firstIndex;
+	uint32_t vertexCount = *std::max_element(rangeIndices, rangeIndices + indexCount) + 1;
+
+	// Meshlet each vertex was last added to, and its number there: stamps instead of clearing per meshlet
+	const uint32_t noMeshlet = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> vertexMeshlet(vertexCount, noMeshlet);
+	std::vector<uint8_t> localIndex(vertexCount);
+
+	Meshlet meshlet = {};
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint32_t> triangles;
+	uint32_t meshletId = static_cast<uint32_t>(meshlets.size());
+
+	auto flush = [&]() {
+		meshlet.vertexOffset = vertexOffset;
+		meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+		meshlet.indexCount = static_cast<uint32_t>(triangles.size() * 3);
+		meshlet.dataOffset = static_cast<uint32_t>(meshletData.size());
+		meshletData.insert(meshletData.end(), meshletVertices.begin(), meshletVertices.end());
+		meshletData.insert(meshletData.end(), triangles.begin(), triangles.end());
+		computeMeshletBounds(vertices, meshletData, meshlet);
+		meshlets.push_back(meshlet);
+
+		meshlet = {};
+		meshlet.firstIndex = meshlets.back().firstIndex + meshlets.back().indexCount;
+		meshletVertices.clear();
+		triangles.clear();
+		meshletId++;
+	};
+
+	meshlet.firstIndex = firstIndex;
+	for (uint32_t triangle = 0; triangle < indexCount / 3; triangle++)
+	{
+		const uint32_t *corners = &rangeIndices[triangle * 3];
+
+		// Close the meshlet if this triangle's new vertices (or the triangle itself) don't fit anymore
+		uint32_t newVertices = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			bool repeated = (corner > 0 && corners[corner] == corners[0]) || (corner > 1 && corners[corner] == corners[1]);
+			newVertices += (vertexMeshlet[corners[corner]] != meshletId && !repeated) ? 1 : 0;
+		}
+		if (meshletVertices.size() + newVertices > k_meshletMaxVertices || triangles.size() + 1 > k_meshletMaxTriangles)
+		{
+			flush();
+		}
+
+		uint32_t packed = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t v = corners[corner];
+			if (vertexMeshlet[v] != meshletId)
+			{
+				vertexMeshlet[v] = meshletId;
+				localIndex[v] = static_cast<uint8_t>(meshletVertices.size());
+				meshletVertices.push_back(static_cast<uint32_t>(vertexOffset) + v);
+			}
+			packed |= static_cast<uint32_t>(localIndex[v]) << (corner * 8);
+		}
+		triangles.push_back(packed);
+	}
+	if (!triangles.empty())
+	{
+		flush();
+	}
+}
+
+bool canConeCull(const glm::mat4 &world)
+{
+	// Rotation, translation and uniform scale only: anything else changes the angles between the normals (or mirrors them)
+	glm::mat3 linear(world);
+	float minScale = std::min(glm::length(linear[0]), std::min(glm::length(linear[1]), glm::length(linear[2])));
+	float maxScale = std::max(glm::length(linear[0]), std::max(glm::length(linear[1]), glm::length(linear[2])));
+	return glm::determinant(linear) > 0.0f && maxScale <= minScale * 1.001f;
+}
+
+bool isMeshletVisible(const Meshlet &meshlet, const glm::mat4 &world, const glm::vec4 *frustumPlanes, const glm::vec3 &cameraPosition,
+	bool coneCulling)
+{
+	glm::mat3 linear(world);
+	float scale = std::max(glm::length(linear[0]), std::max(glm::length(linear[1]), glm::length(linear[2])));
+	glm::vec3 center = glm::vec3(world * glm::vec4(meshlet.center, 1.0f));
+	float radius = meshlet.radius * scale;
+
+	for (int plane = 0; plane < Frustum::PlaneCount; plane++)
+	{
+		if (glm::dot(glm::vec3(frustumPlanes[plane]), center) + frustumPlanes[plane].w < -radius)
+		{
+			return false;
+		}
+	}
+
+	// Back facing: the camera is inside the cone opening behind every triangle of the meshlet (as seen from its sphere)
+	if (coneCulling && meshlet.coneCutoff < 1.0f && canConeCull(world))
+	{
+		glm::vec3 axis = linear * meshlet.coneAxis / scale;
+		glm::vec3 offset = center - cameraPosition;
+		if (glm::dot(offset, axis) >= meshlet.coneCutoff * glm::length(offset) + radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
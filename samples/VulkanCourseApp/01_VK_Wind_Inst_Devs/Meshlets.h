@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Utilities.h"
+#include "Frustum.h"
+
+// Meshlets: a mesh's triangles cut into small clusters, each with bounds the GPU can cull it by
+// (Shaders/meshlet_cull.comp for indirect draws, Shaders/meshlet.task with mesh shaders).
+// 64 vertices / 124 triangles is the usual mesh shader sweet spot, well inside VK_EXT_mesh_shader's guaranteed output limits
+const uint32_t k_meshletMaxVertices = 64;
+const uint32_t k_meshletMaxTriangles = 124;
+
+// One cluster, laid out as the shaders' std430 Meshlet struct (64 bytes)
+struct Meshlet
+{
+	glm::vec3 center;			// Bounding sphere, model space
+	float	  radius;
+	glm::vec3 coneAxis;			// Normal cone: average facing of the triangles (unit length)
+	float	  coneCutoff;		// Sine of the cone's half angle; 1: too wide to ever cull
+	uint32_t  firstIndex;		// Its triangles, consecutive in the mesh's index buffer (for vkCmdDrawIndexed)
+	uint32_t  indexCount;
+	int32_t	  vertexOffset;		// Of the sub mesh it is in
+	uint32_t  vertexCount;		// Distinct vertices the triangles use
+	uint32_t  dataOffset;		// Start in the meshlet data: vertexCount vertex buffer indices, then a word per triangle
+	uint32_t  padding[3];		//   (3 local vertex numbers, 8 bits each)
+};
+
+// Cut the triangles indices[firstIndex .. firstIndex + indexCount) of one (sub) mesh into meshlets, in index buffer order
+// (so keeping the vertex cache order the optimizer gave them). Appends to meshlets and meshletData
+// vertices: the ones the indices point to, i.e. starting at the sub mesh's vertexOffset
+void buildMeshlets(const Vertex *vertices, const uint32_t *indices, uint32_t firstIndex, uint32_t indexCount, int32_t vertexOffset,
+	std::vector<Meshlet> &meshlets, std::vector<uint32_t> &meshletData);
+
+// Cone culling needs the triangles' facing to survive the world transform: rotation, translation and uniform scale only
+bool canConeCull(const glm::mat4 &world);
+
+// Same test as the shaders, for one meshlet of a mesh with the given world transform
+// frustumPlanes: Frustum::PlaneCount world space planes, pointing inside (see Frustum); coneCulling: false if back faces are drawn
+bool isMeshletVisible(const Meshlet &meshlet, const glm::mat4 &world, const glm::vec4 *frustumPlanes, const glm::vec3 &cameraPosition,
+	bool coneCulling);
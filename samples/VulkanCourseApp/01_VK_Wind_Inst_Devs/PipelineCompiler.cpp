@@ -0,0 +1,342 @@
+#include "PipelineCompiler.h"
+
+#include <algorithm>
+
+
+PipelineCompiler::PipelineCompiler()
+{
+}
+
+void PipelineCompiler::init(VkDevice newDevice, uint32_t workerCount)
+{
+	m_device = newDevice;
+	m_stopping = false;
+
+	// Pipeline cache shared by all workers. Without EXTERNALLY_SYNCHRONIZED flag the driver
+	// guards it, so many threads can read/write it at once
+	VkPipelineCacheCreateInfo cacheCreateInfo = {};
+	cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheCreateInfo.initialDataSize = 0;				// Start empty
+	cacheCreateInfo.pInitialData = nullptr;
+
+	VkResult result = vkCreatePipelineCache(m_device, &cacheCreateInfo, nullptr, &m_pipelineCache);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a PIPELINE CACHE!");
+	}
+
+	// Leave a core for the main (render) thread
+	if (workerCount == 0)
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+	}
+
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		m_workers.emplace_back(&PipelineCompiler::workerLoop, this);
+	}
+}
+
+std::shared_future<VkPipeline> PipelineCompiler::compile(const PipelineDesc &desc)
+{
+	// Job owns a copy of the description, so caller's data can go out of scope
+	std::packaged_task<VkPipeline()> job([this, desc]() {
+		return buildGraphicsPipeline(desc);
+	});
+	std::shared_future<VkPipeline> pipeline = job.get_future().share();
+
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		if (m_stopping || m_workers.empty())
+		{
+			throw std::runtime_error("PIPELINE COMPILER is not running!");
+		}
+		m_jobs.push_back(std::move(job));
+	}
+	m_jobCondition.notify_one();
+
+	return pipeline;
+}
+
+VkPipelineCache PipelineCompiler::getPipelineCache()
+{
+	return m_pipelineCache;
+}
+
+void PipelineCompiler::destroy()
+{
+	stopWorkers();
+
+	vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+	m_pipelineCache = VK_NULL_HANDLE;
+}
+
+PipelineCompiler::~PipelineCompiler()
+{
+	// Threads must be joined before they destruct (e.g. renderer init failed before cleanUp)
+	stopWorkers();
+}
+
+void PipelineCompiler::stopWorkers()
+{
+	// Let workers finish whatever is queued, then join them
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_stopping = true;
+	}
+	m_jobCondition.notify_all();
+
+	for (auto &worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+void PipelineCompiler::workerLoop()
+{
+	while (true)
+	{
+		std::packaged_task<VkPipeline()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_jobMutex);
+			m_jobCondition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+
+			// Only stop once queue is drained, so no future is left without a value
+			if (m_jobs.empty())
+			{
+				return;
+			}
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		// Exceptions thrown by the build are stored in the future
+		job();
+	}
+}
+
+VkPipeline PipelineCompiler::buildGraphicsPipeline(const PipelineDesc &desc)
+{
+	/** -- SHADER STAGE CREATION INFORMATION -- **/
+	// Build a Shader Module for each stage; once pipeline is created we destroy them
+	std::vector<VkShaderModule> shaderModules;
+	std::vector<VkPipelineShaderStageCreateInfo> shaderStagesCreateInfos;
+
+	// Specialization info per stage; sized up front so the pointers into them stay valid
+	std::vector<std::vector<VkSpecializationMapEntry>> specializationMapEntries(desc.shaderStages.size());
+	std::vector<VkSpecializationInfo>				   specializationInfos(desc.shaderStages.size());
+
+	for (size_t i = 0; i < desc.shaderStages.size(); i++)
+	{
+		const ShaderStageDesc &shaderStage = desc.shaderStages[i];
+		VkShaderModule shaderModule;
+		try
+		{
+			shaderModule = createShaderModule(shaderStage.code, shaderStage.codeSize);
+		}
+		catch (const std::runtime_error &)
+		{
+			// Modules of the earlier stages would leak: nothing else destroys them
+			for (auto createdModule : shaderModules)
+			{
+				vkDestroyShaderModule(m_device, createdModule, nullptr);
+			}
+			throw;
+		}
+		shaderModules.push_back(shaderModule);
+
+		VkPipelineShaderStageCreateInfo shaderStageCreateInfo = {};
+		shaderStageCreateInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStageCreateInfo.stage  = shaderStage.stage;						// Shader stage name
+		shaderStageCreateInfo.module = shaderModule;							// shader module to be used by the stage
+		shaderStageCreateInfo.pName  = shaderStage.entryPoint;					// entry point into shader
+
+		// Specialization constants select the variant of the shader to compile
+		if (!shaderStage.specialization.empty())
+		{
+			specializationMapEntries[i] = shaderStage.specialization.getMapEntries();
+
+			VkSpecializationInfo &specializationInfo = specializationInfos[i];
+			specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationMapEntries[i].size());
+			specializationInfo.pMapEntries = specializationMapEntries[i].data();
+			specializationInfo.dataSize = shaderStage.specialization.data.size() * sizeof(uint32_t);
+			specializationInfo.pData = shaderStage.specialization.data.data();
+			shaderStageCreateInfo.pSpecializationInfo = &specializationInfo;
+		}
+		shaderStagesCreateInfos.push_back(shaderStageCreateInfo);
+	}
+
+	/** -- VERTEX INPUT -- **/
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(desc.vertexBindings.size());
+	vertexInputCreateInfo.pVertexBindingDescriptions = desc.vertexBindings.data();				// List of vertex binding description (data spacing, stride info, etc)
+	vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.vertexAttributes.size());
+	vertexInputCreateInfo.pVertexAttributeDescriptions = desc.vertexAttributes.data();			// List of vertex attribute description (data format and where to find to/from)
+
+	/** -- INPUT ASSEMBLY -- **/
+	VkPipelineInputAssemblyStateCreateInfo inputAssembleCreateInfo = {};
+	inputAssembleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembleCreateInfo.topology = desc.topology;							// Primitive Type to assemble vertices as
+	inputAssembleCreateInfo.primitiveRestartEnable = VK_FALSE;					// allow overriding of strip topology to start new primitive
+
+	/** -- VIEWPORT AND SCISSOR-- **/
+	// If dynamic, the values here are ignored and set with vkCmdSetViewport/vkCmdSetScissor
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(desc.viewportExtent.width);
+	viewport.height = static_cast<float>(desc.viewportExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = desc.viewportExtent;
+
+	VkPipelineViewportStateCreateInfo viewportCreateInfo = {};
+	viewportCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportCreateInfo.viewportCount = 1;
+	viewportCreateInfo.pViewports = desc.isDynamic(VK_DYNAMIC_STATE_VIEWPORT) ? nullptr : &viewport;
+	viewportCreateInfo.scissorCount = 1;
+	viewportCreateInfo.pScissors = desc.isDynamic(VK_DYNAMIC_STATE_SCISSOR) ? nullptr : &scissor;
+
+	/** -- DYNAMIC STATES -- **/
+	VkPipelineDynamicStateCreateInfo dynStateCreateInfo = {};
+	dynStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(desc.dynamicStates.size());
+	dynStateCreateInfo.pDynamicStates = desc.dynamicStates.data();
+
+	/** -- RASTERIZER -- **/
+	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
+	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizerCreateInfo.depthClampEnable = VK_FALSE;			// Change if frag beyond near/far plane are clipped (default) or clamped to plane
+	rasterizerCreateInfo.rasterizerDiscardEnable = VK_FALSE;	// Whether to skip rasterizer. Never creates fragments, only suitable for pipeline w/o a FB output
+	rasterizerCreateInfo.polygonMode = desc.polygonMode;		// How to handle filling frags between vertices
+	rasterizerCreateInfo.lineWidth = 1.0f;						// How thick a line should be when drawn, needs a gpu extension if value other than 1.0f
+	rasterizerCreateInfo.cullMode = desc.cullMode;				// Which side of a tri to cull
+	rasterizerCreateInfo.frontFace = desc.frontFace;			// Winding to determine which side is front
+	rasterizerCreateInfo.depthBiasEnable = VK_FALSE;			// Whether to add Depthbias to fragments
+
+	/** -- MULTISAMPLING (for anti-aliasing) -- **/
+	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo = {};
+	multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleCreateInfo.sampleShadingEnable = VK_FALSE;						// Enable multisampling shading or not
+	multisampleCreateInfo.rasterizationSamples = desc.rasterizationSamples;		// Num of samples to use per fragment
+
+	/** -- DEPTH STENCIL TESTING -- **/
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = desc.depthTestEnable;		// Compare fragment depth against depth buffer
+	depthStencilCreateInfo.depthWriteEnable = desc.depthWriteEnable;	// Write fragment depth into depth buffer
+	depthStencilCreateInfo.depthCompareOp = desc.depthCompareOp;		// Comparison that lets a fragment pass
+	depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;
+	depthStencilCreateInfo.stencilTestEnable = VK_FALSE;
+
+	/** -- BLENDING -- **/
+	VkPipelineColorBlendStateCreateInfo colorBlendingCreateInfo = {};
+	colorBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlendingCreateInfo.logicOpEnable = VK_FALSE;			// Alternative to calc is to use logical ops
+	colorBlendingCreateInfo.attachmentCount = desc.colorAttachmentCount;	// 0 for depth-only subpasses
+	colorBlendingCreateInfo.pAttachments = &desc.colorBlend;
+
+	/** --GRAPHICS PIPELINE CREATION -- **/
+	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
+	graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	graphicsPipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStagesCreateInfos.size());	// Number of shader stages
+	graphicsPipelineCreateInfo.pStages = shaderStagesCreateInfos.data();							// List of shader stages
+	graphicsPipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;		// All the fixed function pipeline states
+	graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssembleCreateInfo;
+	graphicsPipelineCreateInfo.pViewportState = &viewportCreateInfo;
+	graphicsPipelineCreateInfo.pDynamicState = desc.dynamicStates.empty() ? nullptr : &dynStateCreateInfo;
+	graphicsPipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
+	graphicsPipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
+	graphicsPipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;
+	graphicsPipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;	// Ignored if subpass has no depth attachment
+	graphicsPipelineCreateInfo.layout = desc.layout;							// Pipeline layout the pipeline should use
+	graphicsPipelineCreateInfo.renderPass = desc.renderPass;					// render pass description the pipeline is compatible with
+	graphicsPipelineCreateInfo.subpass = desc.subpass;							// subpass of render pass  to use with pipeline
+	graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	graphicsPipelineCreateInfo.basePipelineIndex = -1;
+
+	// Create Graphics pipeline through the shared cache
+	VkPipeline pipeline;
+	VkResult result = vkCreateGraphicsPipelines(m_device, m_pipelineCache, 1,
+												&graphicsPipelineCreateInfo, nullptr, &pipeline);
+
+	// DESTROY shader modules, no longer needed after pipeline
+	for (auto shaderModule : shaderModules)
+	{
+		vkDestroyShaderModule(m_device, shaderModule, nullptr);
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a GRAPHICS_PIPELINE");
+	}
+
+	return pipeline;
+}
+
+VkPipeline PipelineCompiler::buildComputePipeline(const ShaderStageDesc &shaderStage, VkPipelineLayout layout)
+{
+	VkShaderModule shaderModule = createShaderModule(shaderStage.code, shaderStage.codeSize);
+
+	VkPipelineShaderStageCreateInfo shaderStageCreateInfo = {};
+	shaderStageCreateInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStageCreateInfo.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+	shaderStageCreateInfo.module = shaderModule;
+	shaderStageCreateInfo.pName  = shaderStage.entryPoint;
+
+	std::vector<VkSpecializationMapEntry> specializationMapEntries;
+	VkSpecializationInfo specializationInfo = {};
+	if (!shaderStage.specialization.empty())
+	{
+		specializationMapEntries = shaderStage.specialization.getMapEntries();
+		specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationMapEntries.size());
+		specializationInfo.pMapEntries = specializationMapEntries.data();
+		specializationInfo.dataSize = shaderStage.specialization.data.size() * sizeof(uint32_t);
+		specializationInfo.pData = shaderStage.specialization.data.data();
+		shaderStageCreateInfo.pSpecializationInfo = &specializationInfo;
+	}
+
+	VkComputePipelineCreateInfo computePipelineCreateInfo = {};
+	computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineCreateInfo.stage = shaderStageCreateInfo;
+	computePipelineCreateInfo.layout = layout;
+	computePipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	computePipelineCreateInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline;
+	VkResult result = vkCreateComputePipelines(m_device, m_pipelineCache, 1, &computePipelineCreateInfo, nullptr, &pipeline);
+
+	vkDestroyShaderModule(m_device, shaderModule, nullptr);
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a COMPUTE_PIPELINE");
+	}
+
+	return pipeline;
+}
+
+VkShaderModule PipelineCompiler::createShaderModule(const uint32_t *code, size_t codeSize)
+{
+	// Shader module creation information
+	// NOTE: code is already 4 byte aligned words (embedded array or loaded into uint32_t), no copy or file read here
+	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+	shaderModuleCreateInfo.sType	= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleCreateInfo.codeSize = codeSize;											// Size of code in bytes
+	shaderModuleCreateInfo.pCode	= code;												// pointer to code
+
+	VkShaderModule shaderModule;
+	VkResult result = vkCreateShaderModule(m_device, &shaderModuleCreateInfo, nullptr, &shaderModule);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create Shader Module!");
+	}
+
+	return shaderModule;
+}
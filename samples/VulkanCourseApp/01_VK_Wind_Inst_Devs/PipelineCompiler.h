@@ -0,0 +1,56 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+
+#include "PipelineDesc.h"
+
+// Builds graphics pipelines on a pool of worker threads.
+// All workers share one VkPipelineCache (internally synchronized by the driver),
+// so pipelines with common shaders/state compile faster after the first one.
+class PipelineCompiler
+{
+public:
+	PipelineCompiler();
+
+	void init(VkDevice newDevice, uint32_t workerCount = 0);	// 0 == one less than the number of hardware threads
+
+	// Queue a pipeline to be built. Returned future holds the pipeline (or the build error)
+	// NOTE: caller owns the returned pipeline and must destroy it
+	std::shared_future<VkPipeline> compile(const PipelineDesc &desc);
+
+	// Build a compute pipeline right away, on the calling thread (same cache)
+	// NOTE: caller owns the returned pipeline and must destroy it
+	VkPipeline buildComputePipeline(const ShaderStageDesc &shaderStage, VkPipelineLayout layout);
+
+	VkPipelineCache getPipelineCache();
+
+	void destroy();
+
+	~PipelineCompiler();
+
+private:
+	VkDevice		m_device = VK_NULL_HANDLE;
+	VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+
+	// -- Worker pool
+	std::vector<std::thread>					 m_workers;
+	std::deque<std::packaged_task<VkPipeline()>> m_jobs;
+	std::mutex									 m_jobMutex;
+	std::condition_variable						 m_jobCondition;
+	bool										 m_stopping = false;
+
+	void workerLoop();
+	void stopWorkers();
+
+	VkPipeline		buildGraphicsPipeline(const PipelineDesc &desc);
+	VkShaderModule	createShaderModule(const uint32_t *code, size_t codeSize);
+};
@@ -0,0 +1,256 @@
+#include "PipelineDesc.h"
+
+#include <cstring>
+#include <algorithm>
+
+
+// -- Field-wise comparison of the plain Vulkan structs stored in the description
+static bool operator==(const VkVertexInputBindingDescription &a, const VkVertexInputBindingDescription &b)
+{
+	return a.binding == b.binding && a.stride == b.stride && a.inputRate == b.inputRate;
+}
+
+static bool operator==(const VkVertexInputAttributeDescription &a, const VkVertexInputAttributeDescription &b)
+{
+	return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset;
+}
+
+static bool operator==(const VkPipelineColorBlendAttachmentState &a, const VkPipelineColorBlendAttachmentState &b)
+{
+	// Blend factors/ops mean nothing when blending is off, so don't let them split pipelines
+	if (a.blendEnable != b.blendEnable || a.colorWriteMask != b.colorWriteMask)
+	{
+		return false;
+	}
+	return !a.blendEnable ||
+		(a.srcColorBlendFactor == b.srcColorBlendFactor && a.dstColorBlendFactor == b.dstColorBlendFactor &&
+		 a.colorBlendOp == b.colorBlendOp && a.srcAlphaBlendFactor == b.srcAlphaBlendFactor &&
+		 a.dstAlphaBlendFactor == b.dstAlphaBlendFactor && a.alphaBlendOp == b.alphaBlendOp);
+}
+
+static bool operator==(const ShaderStageDesc &a, const ShaderStageDesc &b)
+{
+	return a.stage == b.stage && strcmp(a.entryPoint, b.entryPoint) == 0 && a.specialization == b.specialization &&
+		a.codeSize == b.codeSize && (a.code == b.code || memcmp(a.code, b.code, a.codeSize) == 0);
+}
+
+// FNV-1a over raw bytes (shader code can be large, so avoid copying it into a std::string)
+static size_t hashBytes(const void *data, size_t size)
+{
+	const unsigned char *bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return static_cast<size_t>(hash);
+}
+
+// Topologies in the same class can be swapped with VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY
+static uint32_t topologyClass(VkPrimitiveTopology topology)
+{
+	switch (topology)
+	{
+	case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+		return 0;
+	case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+	case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+	case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+	case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+		return 1;
+	case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+		return 3;
+	default:
+		return 2;	// Triangles
+	}
+}
+
+// Dynamic states as a sorted list, so the order they were added in doesn't matter
+static std::vector<VkDynamicState> sortedDynamicStates(const std::vector<VkDynamicState> &dynamicStates)
+{
+	std::vector<VkDynamicState> sorted = dynamicStates;
+	std::sort(sorted.begin(), sorted.end());
+	sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+	return sorted;
+}
+
+
+void SpecializationConstants::set(uint32_t constantId, bool value)
+{
+	setWord(constantId, value ? VK_TRUE : VK_FALSE);
+}
+
+void SpecializationConstants::set(uint32_t constantId, int32_t value)
+{
+	setWord(constantId, static_cast<uint32_t>(value));
+}
+
+void SpecializationConstants::set(uint32_t constantId, uint32_t value)
+{
+	setWord(constantId, value);
+}
+
+void SpecializationConstants::set(uint32_t constantId, float value)
+{
+	uint32_t word;
+	memcpy(&word, &value, sizeof(word));
+	setWord(constantId, word);
+}
+
+std::vector<VkSpecializationMapEntry> SpecializationConstants::getMapEntries() const
+{
+	std::vector<VkSpecializationMapEntry> mapEntries(constantIds.size());
+	for (size_t i = 0; i < constantIds.size(); i++)
+	{
+		mapEntries[i].constantID = constantIds[i];								// constant_id in the shader
+		mapEntries[i].offset = static_cast<uint32_t>(i * sizeof(uint32_t));	// Where its value is in data
+		mapEntries[i].size = sizeof(uint32_t);
+	}
+	return mapEntries;
+}
+
+bool SpecializationConstants::operator==(const SpecializationConstants &other) const
+{
+	return constantIds == other.constantIds && data == other.data;
+}
+
+void SpecializationConstants::setWord(uint32_t constantId, uint32_t word)
+{
+	// Keep ids sorted (replace the value if already set)
+	auto it = std::lower_bound(constantIds.begin(), constantIds.end(), constantId);
+	size_t index = it - constantIds.begin();
+	if (it != constantIds.end() && *it == constantId)
+	{
+		data[index] = word;
+		return;
+	}
+	constantIds.insert(it, constantId);
+	data.insert(data.begin() + index, word);
+}
+
+
+bool PipelineDesc::isDynamic(VkDynamicState state) const
+{
+	return std::find(dynamicStates.begin(), dynamicStates.end(), state) != dynamicStates.end();
+}
+
+size_t PipelineDesc::hash() const
+{
+	size_t seed = 0;
+
+	// -- Shaders (whole SPIR-V blob, so the same code loaded twice still dedupes)
+	for (const auto &shaderStage : shaderStages)
+	{
+		hashCombine(seed, static_cast<uint32_t>(shaderStage.stage));
+		hashCombine(seed, hashBytes(shaderStage.entryPoint, strlen(shaderStage.entryPoint)));
+		hashCombine(seed, hashBytes(shaderStage.code, shaderStage.codeSize));
+		for (size_t i = 0; i < shaderStage.specialization.constantIds.size(); i++)
+		{
+			hashCombine(seed, shaderStage.specialization.constantIds[i]);
+			hashCombine(seed, shaderStage.specialization.data[i]);
+		}
+	}
+
+	// -- Vertex Input
+	for (const auto &binding : vertexBindings)
+	{
+		hashCombine(seed, binding.binding);
+		hashCombine(seed, binding.stride);
+		hashCombine(seed, static_cast<uint32_t>(binding.inputRate));
+	}
+	for (const auto &attribute : vertexAttributes)
+	{
+		hashCombine(seed, attribute.location);
+		hashCombine(seed, attribute.binding);
+		hashCombine(seed, static_cast<uint32_t>(attribute.format));
+		hashCombine(seed, attribute.offset);
+	}
+	hashCombine(seed, isDynamic(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY) ? topologyClass(topology) : static_cast<uint32_t>(topology));
+
+	// -- Viewport
+	if (!isDynamic(VK_DYNAMIC_STATE_VIEWPORT))
+	{
+		hashCombine(seed, viewportExtent.width);
+		hashCombine(seed, viewportExtent.height);
+	}
+
+	// -- Rasterizer and Multisampling
+	hashCombine(seed, static_cast<uint32_t>(polygonMode));
+	if (!isDynamic(VK_DYNAMIC_STATE_CULL_MODE))
+	{
+		hashCombine(seed, static_cast<uint32_t>(cullMode));
+	}
+	hashCombine(seed, static_cast<uint32_t>(frontFace));
+	hashCombine(seed, static_cast<uint32_t>(rasterizationSamples));
+
+	// -- Depth
+	if (!isDynamic(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE))
+	{
+		hashCombine(seed, depthTestEnable);
+	}
+	hashCombine(seed, depthWriteEnable);
+	hashCombine(seed, static_cast<uint32_t>(depthCompareOp));
+
+	// -- Blending
+	hashCombine(seed, colorAttachmentCount);
+	hashCombine(seed, colorBlend.blendEnable);
+	hashCombine(seed, colorBlend.colorWriteMask);
+	if (colorBlend.blendEnable)
+	{
+		hashCombine(seed, static_cast<uint32_t>(colorBlend.srcColorBlendFactor));
+		hashCombine(seed, static_cast<uint32_t>(colorBlend.dstColorBlendFactor));
+		hashCombine(seed, static_cast<uint32_t>(colorBlend.colorBlendOp));
+		hashCombine(seed, static_cast<uint32_t>(colorBlend.srcAlphaBlendFactor));
+		hashCombine(seed, static_cast<uint32_t>(colorBlend.dstAlphaBlendFactor));
+		hashCombine(seed, static_cast<uint32_t>(colorBlend.alphaBlendOp));
+	}
+
+	// -- Dynamic states
+	for (VkDynamicState state : sortedDynamicStates(dynamicStates))
+	{
+		hashCombine(seed, static_cast<uint32_t>(state));
+	}
+
+	// -- Layout and Render Pass
+	hashCombine(seed, layout);
+	hashCombine(seed, renderPass);
+	hashCombine(seed, subpass);
+
+	return seed;
+}
+
+bool PipelineDesc::operator==(const PipelineDesc &other) const
+{
+	// Both sides must have the same dynamic states before static values can be skipped
+	if (sortedDynamicStates(dynamicStates) != sortedDynamicStates(other.dynamicStates))
+	{
+		return false;
+	}
+
+	bool sameTopology = isDynamic(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY)
+		? topologyClass(topology) == topologyClass(other.topology)
+		: topology == other.topology;
+	bool sameViewport = isDynamic(VK_DYNAMIC_STATE_VIEWPORT) ||
+		(viewportExtent.width == other.viewportExtent.width && viewportExtent.height == other.viewportExtent.height);
+	bool sameCullMode = isDynamic(VK_DYNAMIC_STATE_CULL_MODE) || cullMode == other.cullMode;
+	bool sameDepthTest = isDynamic(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE) || depthTestEnable == other.depthTestEnable;
+
+	return shaderStages == other.shaderStages &&
+		vertexBindings == other.vertexBindings &&
+		vertexAttributes == other.vertexAttributes &&
+		sameTopology &&
+		sameViewport &&
+		polygonMode == other.polygonMode &&
+		sameCullMode &&
+		frontFace == other.frontFace &&
+		rasterizationSamples == other.rasterizationSamples &&
+		sameDepthTest &&
+		depthWriteEnable == other.depthWriteEnable &&
+		depthCompareOp == other.depthCompareOp &&
+		colorAttachmentCount == other.colorAttachmentCount &&
+		colorBlend == other.colorBlend &&
+		layout == other.layout &&
+		renderPass == other.renderPass &&
+		subpass == other.subpass;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+
+// Values for specialization constants (layout(constant_id = N) const ... in GLSL).
+// Each set of values is its own shader variant: the driver folds the constants in and
+// removes the dead branches, so feature toggles cost nothing at runtime.
+// NOTE: only 32 bit constants (bool, int, uint, float), which covers every GLSL scalar but double
+struct SpecializationConstants
+{
+	std::vector<uint32_t> constantIds;		// Sorted, so the same values set in any order compare equal
+	std::vector<uint32_t> data;				// data[i] is the value of constantIds[i]
+
+	void set(uint32_t constantId, bool value);		// Stored as VkBool32
+	void set(uint32_t constantId, int32_t value);
+	void set(uint32_t constantId, uint32_t value);
+	void set(uint32_t constantId, float value);
+
+	bool empty() const { return constantIds.empty(); }
+
+	// Map entries for VkSpecializationInfo (pData is data.data())
+	std::vector<VkSpecializationMapEntry> getMapEntries() const;
+
+	bool operator==(const SpecializationConstants &other) const;
+
+private:
+	void setWord(uint32_t constantId, uint32_t word);
+};
+
+// One programmable stage of a pipeline: SPIR-V code and where to enter it
+// Copies share the code (embedded arrays are never copied, loaded files are ref counted)
+struct ShaderStageDesc
+{
+	VkShaderStageFlagBits stage;					// Stage the code is for (vertex, fragment, etc)
+	const uint32_t*		  code = nullptr;			// SPIR-V code for the stage (embedded array or codeStorage)
+	size_t				  codeSize = 0;				// Size of code in bytes
+	std::shared_ptr<const std::vector<uint32_t>> codeStorage;	// Owns code loaded at runtime (null for embedded code)
+	std::string			  path;						// .spv file the code comes from, to reload it (not part of the hash)
+	const char*			  entryPoint = "main";
+	SpecializationConstants specialization;			// Variant of the code to build (constants it doesn't declare are ignored)
+};
+
+// Everything needed to build a graphics pipeline, stored by value so the
+// description can be handed to another thread and outlive the caller's stack
+struct PipelineDesc
+{
+	// -- Shaders
+	std::vector<ShaderStageDesc> shaderStages;
+
+	// -- Vertex Input
+	std::vector<VkVertexInputBindingDescription>   vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	// -- Viewport and Scissor
+	VkExtent2D viewportExtent = { 0, 0 };
+
+	// -- Rasterizer
+	VkPolygonMode	polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode	= VK_CULL_MODE_BACK_BIT;
+	VkFrontFace		frontFace	= VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	// -- Multisampling
+	VkSampleCountFlagBits rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// -- Depth testing (ignored if the subpass has no depth attachment)
+	VkBool32	depthTestEnable	 = VK_FALSE;
+	VkBool32	depthWriteEnable = VK_FALSE;
+	VkCompareOp depthCompareOp	 = VK_COMPARE_OP_LESS;
+
+	// -- Blending (0 or 1 color attachment: 0 for depth-only passes)
+	uint32_t							colorAttachmentCount = 1;
+	VkPipelineColorBlendAttachmentState colorBlend = {};
+
+	// -- Dynamic states: set with vkCmdSet* when recording instead of being baked in.
+	// Static value of a dynamic state is ignored when comparing descriptions, so e.g. all
+	// viewport sizes share one pipeline. PRIMITIVE_TOPOLOGY only frees the topology within
+	// its class (points / lines / triangles / patches)
+	std::vector<VkDynamicState> dynamicStates;
+
+	// -- Layout and Render Pass compatibility
+	// NOTE: render pass is compared by handle, so two compatible-but-distinct render passes
+	//		 still get their own pipelines (never shares a pipeline that isn't compatible)
+	VkPipelineLayout layout		= VK_NULL_HANDLE;
+	VkRenderPass	 renderPass = VK_NULL_HANDLE;
+	uint32_t		 subpass	= 0;
+
+	bool isDynamic(VkDynamicState state) const;
+
+	// Hash over all of the state above (shader code included), used to dedupe pipelines
+	size_t hash() const;
+
+	bool operator==(const PipelineDesc &other) const;
+	bool operator!=(const PipelineDesc &other) const { return !(*this == other); }
+};
+
+// Functor so PipelineDesc can be used as a key of unordered containers
+struct PipelineDescHash
+{
+	size_t operator()(const PipelineDesc &desc) const { return desc.hash(); }
+};
+
+// Mix value's hash into seed (same mixing as boost::hash_combine)
+template <typename T>
+inline void hashCombine(size_t &seed, const T &value)
+{
+	seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
@@ -0,0 +1,137 @@
+#include "PipelineRegistry.h"
+
+#include <iostream>
+#include <chrono>
+
+
+PipelineRegistry::PipelineRegistry()
+{
+}
+
+void PipelineRegistry::init(VkDevice newDevice, PipelineCompiler *compiler)
+{
+	m_device = newDevice;
+	m_compiler = compiler;
+}
+
+std::shared_future<VkPipeline> PipelineRegistry::getPipeline(const PipelineDesc &desc)
+{
+	std::lock_guard<std::mutex> lock(m_pipelineMutex);
+	m_requestCount++;
+
+	// Already requested: share the same (possibly still compiling) pipeline
+	auto existing = m_pipelines.find(desc);
+	if (existing != m_pipelines.end())
+	{
+		if (!hasFailed(existing->second))
+		{
+			return existing->second;
+		}
+
+		// Failed build: don't hand out the stale error forever, try again (e.g. the cause was fixed since)
+		m_pipelines.erase(existing);
+	}
+
+	// First request for this state: compile it
+	std::shared_future<VkPipeline> pipeline = m_compiler->compile(desc);
+	m_pipelines.emplace(desc, pipeline);
+
+	return pipeline;
+}
+
+std::shared_future<VkPipeline> PipelineRegistry::getVariant(const PipelineDesc &base, const SpecializationConstants &constants)
+{
+	// Stages ignore constants they don't declare, so one set of values can go to every stage
+	PipelineDesc variant = base;
+	for (auto &shaderStage : variant.shaderStages)
+	{
+		shaderStage.specialization = constants;
+	}
+
+	return getPipeline(variant);
+}
+
+bool PipelineRegistry::release(VkPipeline pipeline)
+{
+	std::lock_guard<std::mutex> lock(m_pipelineMutex);
+
+	// Only finished builds can hold the pipeline; skip the rest without waiting on them
+	for (auto entry = m_pipelines.begin(); entry != m_pipelines.end(); ++entry)
+	{
+		if (entry->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			continue;
+		}
+
+		try
+		{
+			if (entry->second.get() == pipeline)
+			{
+				m_pipelines.erase(entry);
+				return true;
+			}
+		}
+		catch (const std::runtime_error &)
+		{
+			// Failed build, not the one we're after
+		}
+	}
+
+	return false;
+}
+
+bool PipelineRegistry::hasFailed(const std::shared_future<VkPipeline> &pipeline)
+{
+	// Still compiling isn't failed (yet); don't wait on it
+	if (pipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return false;
+	}
+
+	try
+	{
+		pipeline.get();
+		return false;
+	}
+	catch (const std::runtime_error &)
+	{
+		return true;
+	}
+}
+
+uint32_t PipelineRegistry::getPipelineCount()
+{
+	std::lock_guard<std::mutex> lock(m_pipelineMutex);
+	return static_cast<uint32_t>(m_pipelines.size());
+}
+
+uint32_t PipelineRegistry::getRequestCount()
+{
+	std::lock_guard<std::mutex> lock(m_pipelineMutex);
+	return m_requestCount;
+}
+
+void PipelineRegistry::destroy()
+{
+	std::lock_guard<std::mutex> lock(m_pipelineMutex);
+
+	// Wait for in-flight builds so no pipeline is leaked, then destroy them all
+	for (auto &entry : m_pipelines)
+	{
+		try
+		{
+			vkDestroyPipeline(m_device, entry.second.get(), nullptr);
+		}
+		catch (const std::runtime_error &e)
+		{
+			// Build failed, so there is nothing to destroy
+			std::cout << "Error: " << e.what() << std::endl;
+		}
+	}
+	m_pipelines.clear();
+	m_requestCount = 0;
+}
+
+PipelineRegistry::~PipelineRegistry()
+{
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <unordered_map>
+#include <mutex>
+#include <future>
+
+#include "PipelineDesc.h"
+#include "PipelineCompiler.h"
+
+// Owns every graphics pipeline and hands out shared handles.
+// Identical descriptions (e.g. two materials with the same state) map to one pipeline,
+// which is only compiled the first time it is asked for.
+class PipelineRegistry
+{
+public:
+	PipelineRegistry();
+
+	void init(VkDevice newDevice, PipelineCompiler *compiler);
+
+	// Pipeline for the description; compiles it on the compiler's workers if not seen before (or if its last build failed)
+	// NOTE: registry owns the pipeline, callers must NOT destroy it
+	std::shared_future<VkPipeline> getPipeline(const PipelineDesc &desc);
+
+	// Variant of base with the given specialization constants applied to all its stages.
+	// Every distinct set of values is compiled the first time it is asked for, then shared like any other pipeline
+	std::shared_future<VkPipeline> getVariant(const PipelineDesc &base, const SpecializationConstants &constants);
+
+	// Forget the entry that built pipeline, so later requests for its description compile a new one.
+	// Ownership passes to the caller, who destroys it once no command buffer uses it; false if not found
+	bool release(VkPipeline pipeline);
+
+	uint32_t getPipelineCount();			// Unique pipelines created
+	uint32_t getRequestCount();				// Total requests (requests - pipelines == duplicates avoided)
+
+	void destroy();
+
+	~PipelineRegistry();
+
+private:
+	VkDevice		  m_device = VK_NULL_HANDLE;
+	PipelineCompiler* m_compiler = nullptr;
+
+	std::unordered_map<PipelineDesc, std::shared_future<VkPipeline>, PipelineDescHash> m_pipelines;
+	std::mutex m_pipelineMutex;
+	uint32_t   m_requestCount = 0;
+
+	static bool hasFailed(const std::shared_future<VkPipeline> &pipeline);	// Finished with an exception
+};
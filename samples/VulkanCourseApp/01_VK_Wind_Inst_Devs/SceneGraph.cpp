@@ -0,0 +1,309 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define SCENE_GRAPH_SSE
+#include <xmmintrin.h>
+#endif
+
+
+const SceneGraph::NodeHandle SceneGraph::k_noParent;
+const uint8_t SceneGraph::k_localDirty;
+const uint8_t SceneGraph::k_childDirty;
+const uint32_t SceneGraph::k_minJobNodes;
+
+// out = a * b (column major, so each column of out is a's columns weighted by one column of b)
+static inline void multiplyTransform(const glm::mat4 &a, const glm::mat4 &b, glm::mat4 &out)
+{
+#ifdef SCENE_GRAPH_SSE
+	__m128 a0 = _mm_loadu_ps(&a[0][0]);
+	__m128 a1 = _mm_loadu_ps(&a[1][0]);
+	__m128 a2 = _mm_loadu_ps(&a[2][0]);
+	__m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+	for (int column = 0; column < 4; column++)
+	{
+		__m128 b_column = _mm_loadu_ps(&b[column][0]);
+		__m128 result = _mm_mul_ps(a0, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(0, 0, 0, 0)));
+		result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(1, 1, 1, 1))));
+		result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(2, 2, 2, 2))));
+		result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(3, 3, 3, 3))));
+		_mm_storeu_ps(&out[column][0], result);
+	}
+#else
+	out = a * b;
+#endif
+}
+
+
+SceneGraph::SceneGraph()
+{
+}
+
+void SceneGraph::reserve(size_t nodeCount)
+{
+	m_local.reserve(nodeCount);
+	m_world.reserve(nodeCount);
+	m_parent.reserve(nodeCount);
+	m_subtreeSize.reserve(nodeCount);
+	m_dirty.reserve(nodeCount);
+	m_handleOfIndex.reserve(nodeCount);
+	m_indexOfHandle.reserve(nodeCount);
+}
+
+SceneGraph::NodeHandle SceneGraph::addNode(NodeHandle parent, const glm::mat4 &localTransform)
+{
+	uint32_t index = static_cast<uint32_t>(m_local.size());
+	uint32_t parentIndex = parent == k_noParent ? k_noParent : m_indexOfHandle[parent];
+
+	// Still depth first only if the parent's subtree ends at the back of the arrays (a root always does)
+	if (parentIndex != k_noParent && parentIndex + m_subtreeSize[parentIndex] != index)
+	{
+		m_orderDirty = true;
+	}
+
+	NodeHandle handle = static_cast<NodeHandle>(m_indexOfHandle.size());
+	m_local.push_back(localTransform);
+	m_world.push_back(localTransform);
+	m_parent.push_back(parentIndex);
+	m_subtreeSize.push_back(1);
+	m_dirty.push_back(0);
+	m_handleOfIndex.push_back(handle);
+	m_indexOfHandle.push_back(index);
+
+	for (uint32_t ancestor = parentIndex; ancestor != k_noParent; ancestor = m_parent[ancestor])
+	{
+		m_subtreeSize[ancestor]++;
+	}
+
+	markDirty(index, k_localDirty);
+	return handle;
+}
+
+void SceneGraph::setLocalTransform(NodeHandle node, const glm::mat4 &localTransform)
+{
+	uint32_t index = m_indexOfHandle[node];
+	m_local[index] = localTransform;
+	markDirty(index, k_localDirty);
+}
+
+const glm::mat4 &SceneGraph::getLocalTransform(NodeHandle node) const
+{
+	return m_local[m_indexOfHandle[node]];
+}
+
+const glm::mat4 &SceneGraph::getWorldTransform(NodeHandle node) const
+{
+	return m_world[m_indexOfHandle[node]];
+}
+
+void SceneGraph::updateWorldTransforms(JobSystem *jobs)
+{
+	if (m_orderDirty)
+	{
+		sortHierarchy();
+	}
+
+	JobCounter counter;
+	updateRange(0, static_cast<uint32_t>(m_local.size()), false, jobs, &counter);
+	if (jobs != nullptr)
+	{
+		jobs->wait(counter);
+	}
+}
+
+size_t SceneGraph::size() const
+{
+	return m_local.size();
+}
+
+void SceneGraph::clear()
+{
+	m_local.clear();
+	m_world.clear();
+	m_parent.clear();
+	m_subtreeSize.clear();
+	m_dirty.clear();
+	m_handleOfIndex.clear();
+	m_indexOfHandle.clear();
+	m_orderDirty = false;
+}
+
+SceneGraph::~SceneGraph()
+{
+}
+
+void SceneGraph::markDirty(uint32_t index, uint8_t flags)
+{
+	m_dirty[index] |= flags;
+
+	// Let every ancestor know, so the update pass walks down to this node; stop at one that already knows
+	for (uint32_t ancestor = m_parent[index]; ancestor != k_noParent; ancestor = m_parent[ancestor])
+	{
+		if (m_dirty[ancestor] & k_childDirty)
+		{
+			break;
+		}
+		m_dirty[ancestor] |= k_childDirty;
+	}
+}
+
+// Update the subtrees making up [begin, end); forced == their roots changed too (a changed ancestor moved them)
+void SceneGraph::updateRange(uint32_t begin, uint32_t end, bool forced, JobSystem *jobs, JobCounter *counter)
+{
+	uint32_t index = begin;
+	while (index < end)
+	{
+		uint32_t subtreeEnd = index + m_subtreeSize[index];
+
+		// Nothing changed in here: skip the whole subtree
+		if (!forced && m_dirty[index] == 0)
+		{
+			index = subtreeEnd;
+			continue;
+		}
+
+		// Only something below changed: this node is fine, carry on into its children
+		if (!forced && (m_dirty[index] & k_localDirty) == 0)
+		{
+			m_dirty[index] = 0;
+			index++;
+			continue;
+		}
+
+		// Node changed: everything under it moves with it. Parents come first, so their world is always ready
+		uint32_t parentIndex = m_parent[index];
+		if (parentIndex == k_noParent)
+		{
+			m_world[index] = m_local[index];
+		}
+		else
+		{
+			multiplyTransform(m_world[parentIndex], m_local[index], m_world[index]);
+		}
+		m_dirty[index] = 0;
+
+		if (jobs != nullptr && subtreeEnd - index > k_minJobNodes)
+		{
+			// Big subtree: hand its children's subtrees out in batches of about k_minJobNodes nodes
+			uint32_t batchBegin = index + 1;
+			while (batchBegin < subtreeEnd)
+			{
+				uint32_t batchEnd = batchBegin;
+				while (batchEnd < subtreeEnd && batchEnd - batchBegin < k_minJobNodes)
+				{
+					batchEnd += m_subtreeSize[batchEnd];
+				}
+				jobs->run([this, batchBegin, batchEnd, jobs, counter]() {
+					updateRange(batchBegin, batchEnd, true, jobs, counter);
+				}, counter);
+				batchBegin = batchEnd;
+			}
+		}
+		else
+		{
+			for (uint32_t child = index + 1; child < subtreeEnd; child++)
+			{
+				multiplyTransform(m_world[m_parent[child]], m_local[child], m_world[child]);
+			}
+			memset(&m_dirty[index], 0, subtreeEnd - index);
+		}
+
+		index = subtreeEnd;
+	}
+}
+
+void SceneGraph::sortHierarchy()
+{
+	uint32_t nodeCount = static_cast<uint32_t>(m_local.size());
+
+	// Children of each node, packed one node after another (keeps insertion order among siblings)
+	std::vector<uint32_t> childStart(nodeCount + 1, 0);
+	for (uint32_t i = 0; i < nodeCount; i++)
+	{
+		if (m_parent[i] != k_noParent)
+		{
+			childStart[m_parent[i] + 1]++;
+		}
+	}
+	for (uint32_t i = 0; i < nodeCount; i++)
+	{
+		childStart[i + 1] += childStart[i];
+	}
+	std::vector<uint32_t> children(childStart[nodeCount]);
+	std::vector<uint32_t> childFill(childStart.begin(), childStart.end() - 1);
+	for (uint32_t i = 0; i < nodeCount; i++)
+	{
+		if (m_parent[i] != k_noParent)
+		{
+			children[childFill[m_parent[i]]++] = i;
+		}
+	}
+
+	// Depth first walk from every root gives the new order (new index -> old index)
+	std::vector<uint32_t> order;
+	order.reserve(nodeCount);
+	std::vector<uint32_t> stack;
+	for (uint32_t root = 0; root < nodeCount; root++)
+	{
+		if (m_parent[root] != k_noParent)
+		{
+			continue;
+		}
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			uint32_t node = stack.back();
+			stack.pop_back();
+			order.push_back(node);
+
+			// Reversed, so the first child is visited first
+			for (uint32_t child = childStart[node + 1]; child > childStart[node]; child--)
+			{
+				stack.push_back(children[child - 1]);
+			}
+		}
+	}
+
+	std::vector<uint32_t> newIndexOf(nodeCount);
+	for (uint32_t newIndex = 0; newIndex < nodeCount; newIndex++)
+	{
+		newIndexOf[order[newIndex]] = newIndex;
+	}
+
+	// Move every array into the new order
+	std::vector<glm::mat4>	local(nodeCount);
+	std::vector<glm::mat4>	world(nodeCount);
+	std::vector<uint32_t>	parent(nodeCount);
+	std::vector<uint8_t>	dirty(nodeCount);
+	std::vector<NodeHandle> handleOfIndex(nodeCount);
+	for (uint32_t newIndex = 0; newIndex < nodeCount; newIndex++)
+	{
+		uint32_t oldIndex = order[newIndex];
+		local[newIndex] = m_local[oldIndex];
+		world[newIndex] = m_world[oldIndex];
+		parent[newIndex] = m_parent[oldIndex] == k_noParent ? k_noParent : newIndexOf[m_parent[oldIndex]];
+		dirty[newIndex] = m_dirty[oldIndex];
+		handleOfIndex[newIndex] = m_handleOfIndex[oldIndex];
+		m_indexOfHandle[handleOfIndex[newIndex]] = newIndex;
+	}
+	m_local.swap(local);
+	m_world.swap(world);
+	m_parent.swap(parent);
+	m_dirty.swap(dirty);
+	m_handleOfIndex.swap(handleOfIndex);
+
+	// Children come after their parent, so one backwards pass adds up every subtree
+	std::fill(m_subtreeSize.begin(), m_subtreeSize.end(), 1u);
+	for (uint32_t i = nodeCount; i-- > 0;)
+	{
+		if (m_parent[i] != k_noParent)
+		{
+			m_subtreeSize[m_parent[i]] += m_subtreeSize[i];
+		}
+	}
+
+	m_orderDirty = false;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+
+// Transform hierarchy stored as structure of arrays (local, world, parent, subtree size, dirty flags),
+// kept in depth first order: a parent always comes before its children and every subtree is one contiguous range.
+// updateWorldTransforms() is then a single forward pass that jumps over subtrees with nothing dirty in them
+// and recomputes changed subtrees front to back (the parent's world matrix is always ready before its children).
+// Nodes are referred to by handles, which stay valid when the arrays are reordered.
+class SceneGraph
+{
+public:
+	typedef uint32_t NodeHandle;
+	static const NodeHandle k_noParent = UINT32_MAX;
+
+	SceneGraph();
+
+	void reserve(size_t nodeCount);
+
+	// Parent must already exist (or be k_noParent for a root)
+	NodeHandle addNode(NodeHandle parent, const glm::mat4 &localTransform);
+
+	void setLocalTransform(NodeHandle node, const glm::mat4 &localTransform);
+	const glm::mat4 &getLocalTransform(NodeHandle node) const;
+
+	// Valid as of the last updateWorldTransforms()
+	const glm::mat4 &getWorldTransform(NodeHandle node) const;
+
+	// Bring world transforms of every changed node (and everything below it) up to date.
+	// With a job system, large changed subtrees are split over its workers (sibling subtrees never touch each other)
+	void updateWorldTransforms(JobSystem *jobs = nullptr);
+
+	size_t size() const;
+
+	void clear();
+
+	~SceneGraph();
+
+private:
+	static const uint8_t k_localDirty = 1 << 0;		// Node's own local transform changed
+	static const uint8_t k_childDirty = 1 << 1;		// Some node below it changed
+	static const uint32_t k_minJobNodes = 16384;		// Smaller changed subtrees aren't worth a job
+
+	// -- Per node, in depth first order
+	std::vector<glm::mat4> m_local;
+	std::vector<glm::mat4> m_world;
+	std::vector<uint32_t>  m_parent;					// Index of the parent, k_noParent for roots
+	std::vector<uint32_t>  m_subtreeSize;			// Node itself + all descendants
+	std::vector<uint8_t>   m_dirty;
+
+	// -- Handle <-> index
+	std::vector<NodeHandle> m_handleOfIndex;
+	std::vector<uint32_t>	m_indexOfHandle;
+
+	bool m_orderDirty = false;						// A node was added in the middle of an existing subtree
+
+	void markDirty(uint32_t index, uint8_t flags);
+	void updateRange(uint32_t begin, uint32_t end, bool forced, JobSystem *jobs, JobCounter *counter);
+	void sortHierarchy();
+};
@@ -0,0 +1,607 @@
+#include "ShaderReflection.h"
+
+#include <cstring>
+#include <algorithm>
+
+
+// -- SPIR-V constants used by the reflection (see the SPIR-V spec, section 3)
+namespace spv
+{
+	const uint32_t MagicNumber = 0x07230203;
+
+	// Opcodes
+	const uint32_t OpName			   = 5;
+	const uint32_t OpEntryPoint		   = 15;
+	const uint32_t OpTypeBool		   = 20;
+	const uint32_t OpTypeInt		   = 21;
+	const uint32_t OpTypeFloat		   = 22;
+	const uint32_t OpTypeVector		   = 23;
+	const uint32_t OpTypeMatrix		   = 24;
+	const uint32_t OpTypeImage		   = 25;
+	const uint32_t OpTypeSampler	   = 26;
+	const uint32_t OpTypeSampledImage  = 27;
+	const uint32_t OpTypeArray		   = 28;
+	const uint32_t OpTypeRuntimeArray  = 29;
+	const uint32_t OpTypeStruct		   = 30;
+	const uint32_t OpTypePointer	   = 32;
+	const uint32_t OpConstant		   = 43;
+	const uint32_t OpSpecConstantTrue  = 48;
+	const uint32_t OpSpecConstantFalse = 49;
+	const uint32_t OpSpecConstant	   = 50;
+	const uint32_t OpVariable		   = 59;
+	const uint32_t OpDecorate		   = 71;
+	const uint32_t OpMemberDecorate	   = 72;
+
+	// Decorations
+	const uint32_t DecorationSpecId		  = 1;
+	const uint32_t DecorationBlock		  = 2;
+	const uint32_t DecorationBufferBlock  = 3;
+	const uint32_t DecorationArrayStride  = 6;
+	const uint32_t DecorationMatrixStride = 7;
+	const uint32_t DecorationBuiltIn	  = 11;
+	const uint32_t DecorationLocation	  = 30;
+	const uint32_t DecorationBinding	  = 33;
+	const uint32_t DecorationDescriptorSet = 34;
+	const uint32_t DecorationOffset		  = 35;
+
+	// Storage classes
+	const uint32_t StorageClassUniformConstant = 0;
+	const uint32_t StorageClassInput		   = 1;
+	const uint32_t StorageClassUniform		   = 2;
+	const uint32_t StorageClassPushConstant	   = 9;
+	const uint32_t StorageClassStorageBuffer   = 12;
+
+	// Image dimensions
+	const uint32_t DimBuffer	  = 5;
+	const uint32_t DimSubpassData = 6;
+}
+
+// Everything the reflection needs to know about an id
+struct SpirvId
+{
+	uint32_t opcode = 0;					// Instruction that declared it (OpType*, OpVariable, OpConstant)
+	std::vector<uint32_t> operands;			// Operands after the result id
+	std::string name;						// Debug name (OpName), empty if stripped
+
+	// Decorations
+	uint32_t set = 0, binding = 0, location = 0, specId = 0;
+	bool hasSet = false, hasBinding = false, hasLocation = false, hasSpecId = false, isBuiltIn = false;
+	bool isBlock = false, isBufferBlock = false;
+	uint32_t arrayStride = 0;
+
+	// Member decorations (structs only)
+	std::vector<uint32_t> memberOffsets;
+	std::vector<uint32_t> memberMatrixStrides;
+};
+
+// Whole module parsed into ids, so types can be followed from the variables
+struct SpirvModule
+{
+	std::vector<SpirvId> ids;
+	std::vector<uint32_t> variables;			// Ids of all global variables
+	std::vector<uint32_t> specConstants;		// Ids of all scalar specialization constants
+	VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL_GRAPHICS;
+};
+
+
+static VkShaderStageFlagBits executionModelToStage(uint32_t executionModel)
+{
+	switch (executionModel)
+	{
+	case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+	case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+	case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+	case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+	case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+	case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+	case 5364: return VK_SHADER_STAGE_TASK_BIT_EXT;		// VK_EXT_mesh_shader
+	case 5365: return VK_SHADER_STAGE_MESH_BIT_EXT;
+	default:
+		throw std::runtime_error("Failed to reflect a SHADER: unsupported execution model!");
+	}
+}
+
+static void ensureMember(std::vector<uint32_t> &list, uint32_t member)
+{
+	if (list.size() <= member)
+	{
+		list.resize(member + 1, 0);
+	}
+}
+
+static SpirvModule parseModule(const uint32_t *code, size_t codeSize)
+{
+	if (code == nullptr || codeSize < 5 * sizeof(uint32_t) || codeSize % sizeof(uint32_t) != 0)
+	{
+		throw std::runtime_error("Failed to reflect a SHADER: code is not SPIR-V!");
+	}
+
+	const uint32_t *words = code;
+	size_t wordCount = codeSize / sizeof(uint32_t);
+
+	if (words[0] != spv::MagicNumber)
+	{
+		throw std::runtime_error("Failed to reflect a SHADER: bad SPIR-V magic number!");
+	}
+
+	SpirvModule module;
+	module.ids.resize(words[3]);				// Header word 3 is the id bound
+	bool hasEntryPoint = false;
+
+	// Instructions start after the 5 word header. Each is (word count << 16 | opcode)
+	size_t pos = 5;
+	while (pos < wordCount)
+	{
+		uint32_t opcode = words[pos] & 0xFFFF;
+		uint32_t instWordCount = words[pos] >> 16;
+		if (instWordCount == 0 || pos + instWordCount > wordCount)
+		{
+			throw std::runtime_error("Failed to reflect a SHADER: truncated SPIR-V instruction!");
+		}
+		const uint32_t *inst = &words[pos];
+
+		switch (opcode)
+		{
+		case spv::OpName:
+			// Literal string, nul terminated and padded to a word boundary
+			module.ids.at(inst[1]).name = std::string(reinterpret_cast<const char*>(inst + 2),
+				strnlen(reinterpret_cast<const char*>(inst + 2), (instWordCount - 2) * sizeof(uint32_t)));
+			break;
+
+		case spv::OpEntryPoint:
+			// Only the first entry point is used (glslang emits one per module)
+			if (!hasEntryPoint)
+			{
+				module.stage = executionModelToStage(inst[1]);
+				hasEntryPoint = true;
+			}
+			break;
+
+		case spv::OpDecorate:
+		{
+			SpirvId &id = module.ids.at(inst[1]);
+			uint32_t value = instWordCount > 3 ? inst[3] : 0;
+			switch (inst[2])
+			{
+			case spv::DecorationSpecId:		   id.specId = value; id.hasSpecId = true; break;
+			case spv::DecorationBlock:		   id.isBlock = true; break;
+			case spv::DecorationBufferBlock:   id.isBufferBlock = true; break;
+			case spv::DecorationArrayStride:   id.arrayStride = value; break;
+			case spv::DecorationBuiltIn:	   id.isBuiltIn = true; break;
+			case spv::DecorationLocation:	   id.location = value; id.hasLocation = true; break;
+			case spv::DecorationBinding:	   id.binding = value; id.hasBinding = true; break;
+			case spv::DecorationDescriptorSet: id.set = value; id.hasSet = true; break;
+			}
+			break;
+		}
+
+		case spv::OpMemberDecorate:
+		{
+			SpirvId &id = module.ids.at(inst[1]);
+			uint32_t member = inst[2];
+			uint32_t value = instWordCount > 4 ? inst[4] : 0;
+			if (inst[3] == spv::DecorationOffset)
+			{
+				ensureMember(id.memberOffsets, member);
+				id.memberOffsets[member] = value;
+			}
+			else if (inst[3] == spv::DecorationMatrixStride)
+			{
+				ensureMember(id.memberMatrixStrides, member);
+				id.memberMatrixStrides[member] = value;
+			}
+			else if (inst[3] == spv::DecorationBuiltIn)
+			{
+				id.isBuiltIn = true;			// gl_PerVertex and co
+			}
+			break;
+		}
+
+		case spv::OpTypeBool:
+		case spv::OpTypeInt:
+		case spv::OpTypeFloat:
+		case spv::OpTypeVector:
+		case spv::OpTypeMatrix:
+		case spv::OpTypeImage:
+		case spv::OpTypeSampler:
+		case spv::OpTypeSampledImage:
+		case spv::OpTypeArray:
+		case spv::OpTypeRuntimeArray:
+		case spv::OpTypeStruct:
+		case spv::OpTypePointer:
+		{
+			// Result id first, then operands
+			SpirvId &id = module.ids.at(inst[1]);
+			id.opcode = opcode;
+			id.operands.assign(inst + 2, inst + instWordCount);
+			break;
+		}
+
+		case spv::OpConstant:
+		case spv::OpSpecConstantTrue:
+		case spv::OpSpecConstantFalse:
+		case spv::OpSpecConstant:
+		case spv::OpVariable:
+		{
+			// Result type first, then result id: keep the type as the first operand
+			SpirvId &id = module.ids.at(inst[2]);
+			id.opcode = opcode;
+			id.operands.assign(inst + 1, inst + instWordCount);
+			id.operands.erase(id.operands.begin() + 1);		// Drop the result id
+			if (opcode == spv::OpVariable)
+			{
+				module.variables.push_back(inst[2]);
+			}
+			else if (opcode != spv::OpConstant)
+			{
+				module.specConstants.push_back(inst[2]);
+			}
+			break;
+		}
+		}
+
+		pos += instWordCount;
+	}
+
+	if (!hasEntryPoint)
+	{
+		throw std::runtime_error("Failed to reflect a SHADER: no entry point!");
+	}
+
+	return module;
+}
+
+// Size in bytes of a type as laid out in a block (uses Offset/ArrayStride/MatrixStride decorations)
+static uint32_t typeSize(const SpirvModule &module, uint32_t typeId, uint32_t matrixStride = 0)
+{
+	const SpirvId &type = module.ids.at(typeId);
+	switch (type.opcode)
+	{
+	case spv::OpTypeBool:
+		return 4;
+	case spv::OpTypeInt:
+	case spv::OpTypeFloat:
+		return type.operands[0] / 8;									// Width in bits
+	case spv::OpTypeVector:
+		return typeSize(module, type.operands[0]) * type.operands[1];
+	case spv::OpTypeMatrix:
+		// Columns are matrixStride apart when decorated (std140/std430), packed otherwise
+		return type.operands[1] * (matrixStride > 0 ? matrixStride : typeSize(module, type.operands[0]));
+	case spv::OpTypeArray:
+	{
+		uint32_t length = module.ids.at(type.operands[1]).operands.at(1);		// OpConstant value
+		uint32_t stride = type.arrayStride > 0 ? type.arrayStride : typeSize(module, type.operands[0], matrixStride);
+		return length * stride;
+	}
+	case spv::OpTypeStruct:
+	{
+		// End of the furthest member
+		uint32_t size = 0;
+		for (size_t i = 0; i < type.operands.size(); i++)
+		{
+			uint32_t offset = i < type.memberOffsets.size() ? type.memberOffsets[i] : 0;
+			uint32_t stride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+			size = std::max(size, offset + typeSize(module, type.operands[i], stride));
+		}
+		return size;
+	}
+	default:
+		return 0;		// Runtime arrays have no static size
+	}
+}
+
+// Vertex attribute format for a scalar/vector input type
+static VkFormat inputFormat(const SpirvModule &module, uint32_t typeId)
+{
+	const SpirvId &type = module.ids.at(typeId);
+	uint32_t components = 1;
+	const SpirvId *scalar = &type;
+	if (type.opcode == spv::OpTypeVector)
+	{
+		components = type.operands[1];
+		scalar = &module.ids.at(type.operands[0]);
+	}
+
+	if (scalar->operands.empty() || scalar->operands[0] != 32)
+	{
+		throw std::runtime_error("Failed to reflect a SHADER: only 32 bit vertex inputs are supported!");
+	}
+
+	static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+	static const VkFormat sintFormats[]  = { VK_FORMAT_R32_SINT,   VK_FORMAT_R32G32_SINT,	VK_FORMAT_R32G32B32_SINT,	VK_FORMAT_R32G32B32A32_SINT };
+	static const VkFormat uintFormats[]  = { VK_FORMAT_R32_UINT,   VK_FORMAT_R32G32_UINT,	VK_FORMAT_R32G32B32_UINT,	VK_FORMAT_R32G32B32A32_UINT };
+
+	if (scalar->opcode == spv::OpTypeFloat)
+	{
+		return floatFormats[components - 1];
+	}
+	return scalar->operands[1] ? sintFormats[components - 1] : uintFormats[components - 1];	// Int signedness
+}
+
+// Descriptor type (and count) of a resource variable
+static VkDescriptorType descriptorType(const SpirvModule &module, uint32_t storageClass, uint32_t typeId, uint32_t &count)
+{
+	count = 1;
+	const SpirvId *type = &module.ids.at(typeId);
+
+	// Arrays of resources: one descriptor per element
+	if (type->opcode == spv::OpTypeArray)
+	{
+		count = module.ids.at(type->operands[1]).operands.at(1);
+		type = &module.ids.at(type->operands[0]);
+	}
+	else if (type->opcode == spv::OpTypeRuntimeArray)
+	{
+		count = 0;
+		type = &module.ids.at(type->operands[0]);
+	}
+
+	if (storageClass == spv::StorageClassStorageBuffer)
+	{
+		return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	}
+	if (storageClass == spv::StorageClassUniform)
+	{
+		// Old style storage buffers are Uniform + BufferBlock
+		return type->isBufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	}
+
+	switch (type->opcode)
+	{
+	case spv::OpTypeSampler:
+		return VK_DESCRIPTOR_TYPE_SAMPLER;
+	case spv::OpTypeSampledImage:
+		return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	case spv::OpTypeImage:
+	{
+		uint32_t dim = type->operands[1];
+		uint32_t sampled = type->operands[5];				// 1 == used with a sampler, 2 == storage image
+		if (dim == spv::DimSubpassData)
+		{
+			return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		}
+		if (dim == spv::DimBuffer)
+		{
+			return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+		}
+		return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	}
+	default:
+		throw std::runtime_error("Failed to reflect a SHADER: unsupported descriptor type!");
+	}
+}
+
+static void addBinding(ShaderReflection &reflection, uint32_t set, const VkDescriptorSetLayoutBinding &binding)
+{
+	// Find (or insert, keeping sets sorted) the set
+	auto setIt = std::lower_bound(reflection.descriptorSets.begin(), reflection.descriptorSets.end(), set,
+		[](const ReflectedDescriptorSet &a, uint32_t b) { return a.set < b; });
+	if (setIt == reflection.descriptorSets.end() || setIt->set != set)
+	{
+		ReflectedDescriptorSet newSet;
+		newSet.set = set;
+		setIt = reflection.descriptorSets.insert(setIt, newSet);
+	}
+
+	// Same binding from another stage: just add the stage
+	auto &bindings = setIt->bindings;
+	auto bindingIt = std::lower_bound(bindings.begin(), bindings.end(), binding.binding,
+		[](const VkDescriptorSetLayoutBinding &a, uint32_t b) { return a.binding < b; });
+	if (bindingIt != bindings.end() && bindingIt->binding == binding.binding)
+	{
+		if (bindingIt->descriptorType != binding.descriptorType || bindingIt->descriptorCount != binding.descriptorCount)
+		{
+			throw std::runtime_error("Failed to reflect a SHADER: stages disagree on a DESCRIPTOR BINDING!");
+		}
+		bindingIt->stageFlags |= binding.stageFlags;
+		return;
+	}
+	bindings.insert(bindingIt, binding);
+}
+
+static void addSpecConstant(ShaderReflection &reflection, const ReflectedSpecConstant &specConstant)
+{
+	for (const auto &existing : reflection.specConstants)
+	{
+		if (existing.constantId == specConstant.constantId)
+		{
+			return;						// Already declared by another stage
+		}
+	}
+	reflection.specConstants.push_back(specConstant);
+}
+
+static void addPushConstantRange(ShaderReflection &reflection, const VkPushConstantRange &range)
+{
+	// Stages sharing a block share one range
+	for (auto &existing : reflection.pushConstantRanges)
+	{
+		if (existing.offset == range.offset && existing.size == range.size)
+		{
+			existing.stageFlags |= range.stageFlags;
+			return;
+		}
+	}
+	reflection.pushConstantRanges.push_back(range);
+}
+
+
+void ShaderReflection::merge(const ShaderReflection &other)
+{
+	stages |= other.stages;
+
+	for (const auto &otherSet : other.descriptorSets)
+	{
+		for (const auto &binding : otherSet.bindings)
+		{
+			addBinding(*this, otherSet.set, binding);
+		}
+	}
+
+	for (const auto &range : other.pushConstantRanges)
+	{
+		addPushConstantRange(*this, range);
+	}
+
+	for (const auto &specConstant : other.specConstants)
+	{
+		addSpecConstant(*this, specConstant);
+	}
+
+	// Only the vertex stage has vertex inputs
+	if (other.stages & VK_SHADER_STAGE_VERTEX_BIT)
+	{
+		vertexAttributes = other.vertexAttributes;
+		vertexStride = other.vertexStride;
+	}
+}
+
+bool ShaderReflection::findSpecConstant(const std::string &name, uint32_t &constantId) const
+{
+	for (const auto &specConstant : specConstants)
+	{
+		if (specConstant.name == name)
+		{
+			constantId = specConstant.constantId;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::getSetBindings(uint32_t set) const
+{
+	for (const auto &descriptorSet : descriptorSets)
+	{
+		if (descriptorSet.set == set)
+		{
+			return descriptorSet.bindings;
+		}
+	}
+	return {};
+}
+
+bool ShaderReflection::makeDynamic(uint32_t set, uint32_t binding)
+{
+	for (auto &descriptorSet : descriptorSets)
+	{
+		for (auto &setBinding : descriptorSet.bindings)
+		{
+			if (descriptorSet.set == set && setBinding.binding == binding && setBinding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+			{
+				setBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+
+ShaderReflection reflectShader(const uint32_t *code, size_t codeSize)
+{
+	SpirvModule module = parseModule(code, codeSize);
+
+	ShaderReflection reflection;
+	reflection.stages = module.stage;
+
+	for (uint32_t variableId : module.variables)
+	{
+		const SpirvId &variable = module.ids[variableId];
+		uint32_t storageClass = variable.operands.at(1);
+
+		// Variables are pointers: follow to the pointed-to type
+		const SpirvId &pointer = module.ids.at(variable.operands[0]);
+		uint32_t typeId = pointer.operands.at(1);
+
+		switch (storageClass)
+		{
+		case spv::StorageClassUniformConstant:
+		case spv::StorageClassUniform:
+		case spv::StorageClassStorageBuffer:
+		{
+			VkDescriptorSetLayoutBinding binding = {};
+			binding.binding = variable.binding;
+			binding.descriptorType = descriptorType(module, storageClass, typeId, binding.descriptorCount);
+			binding.stageFlags = module.stage;
+			binding.pImmutableSamplers = nullptr;
+			addBinding(reflection, variable.set, binding);		// Set defaults to 0 when undecorated
+			break;
+		}
+
+		case spv::StorageClassPushConstant:
+		{
+			// One block per stage, spanning from its first member offset to its end
+			const SpirvId &block = module.ids.at(typeId);
+			VkPushConstantRange range = {};
+			range.stageFlags = module.stage;
+			range.offset = block.memberOffsets.empty() ? 0 : *std::min_element(block.memberOffsets.begin(), block.memberOffsets.end());
+			range.size = typeSize(module, typeId) - range.offset;
+			addPushConstantRange(reflection, range);
+			break;
+		}
+
+		case spv::StorageClassInput:
+		{
+			if (module.stage != VK_SHADER_STAGE_VERTEX_BIT || variable.isBuiltIn || !variable.hasLocation ||
+				module.ids.at(typeId).isBuiltIn)
+			{
+				break;							// gl_VertexIndex etc. aren't fed from vertex buffers
+			}
+
+			// Matrices take one location per column
+			const SpirvId &type = module.ids.at(typeId);
+			uint32_t columnType = typeId;
+			uint32_t columns = 1;
+			if (type.opcode == spv::OpTypeMatrix)
+			{
+				columnType = type.operands[0];
+				columns = type.operands[1];
+			}
+
+			for (uint32_t column = 0; column < columns; column++)
+			{
+				VkVertexInputAttributeDescription attribute = {};
+				attribute.location = variable.location + column;
+				attribute.binding = 0;
+				attribute.format = inputFormat(module, columnType);
+				attribute.offset = typeSize(module, columnType);			// Size for now: offsets assigned below
+				reflection.vertexAttributes.push_back(attribute);
+			}
+			break;
+		}
+		}
+	}
+
+	// Specialization constants (ones without a SpecId can't be set from the API)
+	for (uint32_t specConstantId : module.specConstants)
+	{
+		const SpirvId &constant = module.ids[specConstantId];
+		if (constant.hasSpecId)
+		{
+			addSpecConstant(reflection, { constant.name, constant.specId });
+		}
+	}
+
+	// Pack the vertex attributes in location order
+	std::sort(reflection.vertexAttributes.begin(), reflection.vertexAttributes.end(),
+		[](const VkVertexInputAttributeDescription &a, const VkVertexInputAttributeDescription &b) { return a.location < b.location; });
+	for (auto &attribute : reflection.vertexAttributes)
+	{
+		uint32_t size = attribute.offset;
+		attribute.offset = reflection.vertexStride;
+		reflection.vertexStride += size;
+	}
+
+	return reflection;
+}
+
+ShaderReflection reflectShaders(const std::vector<ShaderStageDesc> &shaderStages)
+{
+	ShaderReflection reflection;
+	for (const auto &shaderStage : shaderStages)
+	{
+		reflection.merge(reflectShader(shaderStage.code, shaderStage.codeSize));
+	}
+	return reflection;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+#include <string>
+
+#include "PipelineDesc.h"
+
+// Bindings of one descriptor set as declared by the shaders
+struct ReflectedDescriptorSet
+{
+	uint32_t set = 0;
+	std::vector<VkDescriptorSetLayoutBinding> bindings;		// Sorted by binding number
+};
+
+// layout(constant_id = N) const ... declared by a shader
+struct ReflectedSpecConstant
+{
+	std::string name;						// GLSL name (empty if the SPIR-V was stripped of names)
+	uint32_t	constantId = 0;
+};
+
+// Resource interface of one or more shader stages, read straight from the SPIR-V
+struct ShaderReflection
+{
+	VkShaderStageFlags stages = 0;								// Stages this was reflected from
+
+	std::vector<ReflectedDescriptorSet> descriptorSets;			// Sorted by set number
+	std::vector<VkPushConstantRange>	pushConstantRanges;
+	std::vector<ReflectedSpecConstant>	specConstants;			// Feature toggles available as SpecializationConstants
+
+	// -- Vertex stage inputs, tightly packed in location order into binding 0
+	// NOTE: assumes the vertex struct declares its members in location order without padding
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+	uint32_t									   vertexStride = 0;
+
+	// Add another stage's interface. Bindings declared by both get both stage flags
+	void merge(const ShaderReflection &other);
+
+	// constant_id of the specialization constant with the given GLSL name; false if no stage declares it
+	bool findSpecConstant(const std::string &name, uint32_t &constantId) const;
+
+	// Bindings of the given set (empty if no stage uses it)
+	std::vector<VkDescriptorSetLayoutBinding> getSetBindings(uint32_t set) const;
+
+	// Turn a uniform buffer binding into UNIFORM_BUFFER_DYNAMIC (GLSL can't tell them apart); false if no stage declares it
+	bool makeDynamic(uint32_t set, uint32_t binding);
+};
+
+// Parse a SPIR-V module. Throws if the code isn't valid SPIR-V
+// NOTE: runtime arrays (e.g. sampler2D textures[]) are reflected with a descriptorCount of 0,
+//		 the caller decides how many descriptors to give them
+ShaderReflection reflectShader(const uint32_t *code, size_t codeSize);
+
+// Reflect and merge all stages of a pipeline
+ShaderReflection reflectShaders(const std::vector<ShaderStageDesc> &shaderStages);
@@ -0,0 +1,171 @@
+#include "ShaderWatcher.h"
+
+#include <cstdlib>
+#include <chrono>
+#include <set>
+#include <iostream>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+
+// How often the watch thread checks whether it should stop (and, without inotify, polls the files)
+static const int k_watchIntervalMs = 250;
+
+ShaderWatcher::ShaderWatcher()
+{
+}
+
+bool ShaderWatcher::init(const std::string &directory, const std::vector<ShaderSource> &sources)
+{
+	m_directory = directory;
+	m_sources = sources;
+	m_stopping = false;
+
+#ifdef __linux__
+	// Editors save either in place (CLOSE_WRITE) or by renaming a temp file over the original (MOVED_TO)
+	m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotifyFd < 0 || inotify_add_watch(m_inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		std::cout << "Shader hot reload disabled: can't watch " << directory << std::endl;
+		if (m_inotifyFd >= 0)
+		{
+			close(m_inotifyFd);
+			m_inotifyFd = -1;
+		}
+		return false;
+	}
+#else
+	struct stat info;
+	if (stat(directory.c_str(), &info) != 0)
+	{
+		std::cout << "Shader hot reload disabled: can't watch " << directory << std::endl;
+		return false;
+	}
+#endif
+
+	m_thread = std::thread(&ShaderWatcher::watchLoop, this);
+	return true;
+}
+
+std::vector<std::string> ShaderWatcher::takeRecompiled()
+{
+	std::lock_guard<std::mutex> lock(m_recompiledMutex);
+	std::vector<std::string> recompiled;
+	recompiled.swap(m_recompiled);
+	return recompiled;
+}
+
+void ShaderWatcher::destroy()
+{
+	m_stopping = true;
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+
+#ifdef __linux__
+	if (m_inotifyFd >= 0)
+	{
+		close(m_inotifyFd);
+		m_inotifyFd = -1;
+	}
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+	// Thread must be joined before it destructs
+	destroy();
+}
+
+void ShaderWatcher::watchLoop()
+{
+#ifdef __linux__
+	alignas(struct inotify_event) char buffer[4096];
+
+	while (!m_stopping)
+	{
+		// Wake up at least every interval to check m_stopping
+		pollfd pollFd = { m_inotifyFd, POLLIN, 0 };
+		if (poll(&pollFd, 1, k_watchIntervalMs) <= 0)
+		{
+			continue;
+		}
+
+		// One save often produces several events: collect the changed files, then compile each once
+		std::set<std::string> changedFiles;
+		ssize_t length;
+		while ((length = read(m_inotifyFd, buffer, sizeof(buffer))) > 0)
+		{
+			for (char *ptr = buffer; ptr < buffer + length; )
+			{
+				const struct inotify_event *event = reinterpret_cast<const struct inotify_event*>(ptr);
+				if (event->len > 0)
+				{
+					changedFiles.insert(event->name);
+				}
+				ptr += sizeof(struct inotify_event) + event->len;
+			}
+		}
+
+		for (const auto &source : m_sources)
+		{
+			if (changedFiles.count(source.glslFile) > 0)
+			{
+				recompile(source);
+			}
+		}
+	}
+#else
+	// No inotify: poll the modification time of every source
+	std::vector<time_t> modifiedTimes(m_sources.size(), 0);
+	for (size_t i = 0; i < m_sources.size(); i++)
+	{
+		struct stat info;
+		if (stat((m_directory + "/" + m_sources[i].glslFile).c_str(), &info) == 0)
+		{
+			modifiedTimes[i] = info.st_mtime;
+		}
+	}
+
+	while (!m_stopping)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(k_watchIntervalMs));
+
+		for (size_t i = 0; i < m_sources.size(); i++)
+		{
+			struct stat info;
+			if (stat((m_directory + "/" + m_sources[i].glslFile).c_str(), &info) == 0 && info.st_mtime != modifiedTimes[i])
+			{
+				modifiedTimes[i] = info.st_mtime;
+				recompile(m_sources[i]);
+			}
+		}
+	}
+#endif
+}
+
+void ShaderWatcher::recompile(const ShaderSource &source)
+{
+	const char *glslang = std::getenv("GLSLANG");
+	std::string command = std::string("\"") + (glslang != nullptr ? glslang : "glslangValidator") + "\" -V \"" +
+		m_directory + "/" + source.glslFile + "\" -o \"" + m_directory + "/" + source.spvFile + "\"";
+#ifdef _WIN32
+	command = "\"" + command + "\"";			// cmd.exe strips the outer quotes of the whole line
+#endif
+
+	// glslang prints its own errors; on failure the old .spv (and pipeline) stay in use
+	if (std::system(command.c_str()) != 0)
+	{
+		std::cout << "Failed to recompile SHADER: " << source.glslFile << std::endl;
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_recompiledMutex);
+	m_recompiled.push_back(m_directory + "/" + source.spvFile);
+}
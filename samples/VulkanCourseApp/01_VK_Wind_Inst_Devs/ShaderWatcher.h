@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// GLSL file and the .spv it compiles to, both relative to the watched directory
+struct ShaderSource
+{
+	std::string glslFile;		// e.g. "shader.vert"
+	std::string spvFile;		// e.g. "vert.spv"
+};
+
+// Watches the shader directory and recompiles GLSL files to SPIR-V on a background thread when they are saved.
+// Uses inotify on Linux, polls modification times elsewhere. The render thread picks up the results
+// with takeRecompiled() whenever it likes (e.g. at a frame boundary), so it never waits on glslang.
+// NOTE: runs glslangValidator from PATH, or the one named by the GLSLANG environment variable
+class ShaderWatcher
+{
+public:
+	ShaderWatcher();
+
+	// Returns false (and watches nothing) if the directory can't be watched, e.g. running outside the source tree
+	bool init(const std::string &directory, const std::vector<ShaderSource> &sources);
+
+	// .spv paths (directory + spvFile) recompiled successfully since the last call
+	std::vector<std::string> takeRecompiled();
+
+	void destroy();
+
+	~ShaderWatcher();
+
+private:
+	std::string				  m_directory;
+	std::vector<ShaderSource> m_sources;
+
+	std::thread				 m_thread;
+	std::atomic<bool>		 m_stopping{ false };
+	std::mutex				 m_recompiledMutex;
+	std::vector<std::string> m_recompiled;
+
+#ifdef __linux__
+	int m_inotifyFd = -1;
+#endif
+
+	void watchLoop();
+	void recompile(const ShaderSource &source);
+};
@@ -1,3 +1,13 @@
 C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V shader.vert
+C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V shader_bindless.vert -o vert_bindless.spv
 C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V shader.frag
+C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V -x shader.vert -o vert.spv.inc
+C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V -x shader_bindless.vert -o vert_bindless.spv.inc
+C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V -x shader.frag -o frag.spv.inc
+C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V meshlet_cull.comp -o meshlet_cull.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V --target-env spirv1.4 meshlet.task -o meshlet_task.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V --target-env spirv1.4 meshlet.mesh -o meshlet_mesh.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V -x meshlet_cull.comp -o meshlet_cull.spv.inc
+C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V -x --target-env spirv1.4 meshlet.task -o meshlet_task.spv.inc
+C:/VulkanSDK/1.3.231.1/Bin/glslangValidator.exe -V -x --target-env spirv1.4 meshlet.mesh -o meshlet_mesh.spv.inc
 pause
\ No newline at end of file
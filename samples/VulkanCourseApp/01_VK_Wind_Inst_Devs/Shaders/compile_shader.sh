@@ -0,0 +1,22 @@
+#!/bin/sh
+# Linux counterpart of compile_shader.bat. Run from anywhere; set GLSLANG to override the compiler.
+#   *.spv     : SPIR-V binaries, read at runtime (shader hot reload)
+#   *.spv.inc : same code as hex words, compiled into the executable by EmbeddedShaders.cpp
+#   meshlet_*.spv : meshlet culling stages (--meshlets); task and mesh shaders need SPIR-V 1.4
+set -e
+cd "$(dirname "$0")"
+
+GLSLANG="${GLSLANG:-glslangValidator}"
+
+compile()
+{
+	"$GLSLANG" -V $3 "$1" -o "$2.spv"
+	"$GLSLANG" -V -x $3 "$1" -o "$2.spv.inc"
+}
+
+compile shader.vert vert
+compile shader_bindless.vert vert_bindless
+compile shader.frag frag
+compile meshlet_cull.comp meshlet_cull
+compile meshlet.task meshlet_task "--target-env spirv1.4"
+compile meshlet.mesh meshlet_mesh "--target-env spirv1.4"
@@ -0,0 +1,43 @@
+// Meshlet visibility, shared by meshlet_cull.comp and meshlet.task (same test as isMeshletVisible in Meshlets.cpp)
+
+// Meshlet in Meshlets.h
+struct Meshlet {
+	vec4 sphere;		// xyz: center (model space), w: radius
+	vec4 cone;			// xyz: axis, w: sine of the half angle (1: never culled)
+	uint firstIndex;
+	uint indexCount;
+	int  vertexOffset;
+	uint vertexCount;
+	uint dataOffset;
+	uint padding0;
+	uint padding1;
+	uint padding2;
+};
+
+// MeshletCullObject in VulkanRenderer.h: one per mesh
+struct CullObject {
+	mat4 world;
+	vec4 params;		// x: largest axis scale of world, y: 1 if back facing meshlets may be culled
+};
+
+// frustumPlanes: world space, pointing inside
+bool isMeshletVisible(Meshlet meshlet, CullObject object, vec4 frustumPlanes[6], vec3 cameraPosition) {
+	vec3 center = (object.world * vec4(meshlet.sphere.xyz, 1.0)).xyz;
+	float radius = meshlet.sphere.w * object.params.x;
+
+	for (int plane = 0; plane < 6; plane++) {
+		if (dot(frustumPlanes[plane].xyz, center) + frustumPlanes[plane].w < -radius) {
+			return false;
+		}
+	}
+
+	// Back facing: the camera is inside the cone opening behind every triangle of the meshlet
+	if (object.params.y != 0.0 && meshlet.cone.w < 1.0) {
+		vec3 axis = mat3(object.world) * meshlet.cone.xyz / object.params.x;
+		vec3 offset = center - cameraPosition;
+		if (dot(offset, axis) >= meshlet.cone.w * length(offset) + radius) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -1,5 +1,10 @@
 #version 450
 
+// Feature toggles, set per pipeline variant (VulkanRenderer::updateShaderFeatures): the unused branch is compiled out
+layout(constant_id = 0) const bool k_showDepth = false;		// Shade by distance to the camera instead of vertex color
+layout(constant_id = 1) const float k_nearPlane = 0.1;		// Projection the depth was written with
+layout(constant_id = 2) const float k_farPlane = 100.0;
+
 // frag color
 layout(location = 0) in vec3 v_color;
 
@@ -7,5 +12,12 @@ layout(location = 0) in vec3 v_color;
 layout(location = 0) out vec4 out_FragColor;
 
 void main(){
+	if (k_showDepth) {
+		// Back to view space distance, then log scale so near and far objects both get a visible range of grays
+		float distance = k_nearPlane * k_farPlane / (k_farPlane - gl_FragCoord.z * (k_farPlane - k_nearPlane));
+		float shade = 1.0 - log(distance / k_nearPlane) / log(k_farPlane / k_nearPlane);
+		out_FragColor = vec4(vec3(shade), 1.0);
+		return;
+	}
 	out_FragColor = vec4(v_color, 1.0);
-}
\ No newline at end of file
+}
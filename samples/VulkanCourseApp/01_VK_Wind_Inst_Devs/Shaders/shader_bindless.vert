@@ -0,0 +1,32 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// shader.vert for bindless: no set 0, the MVP comes out of the global storage buffer array
+
+// Input vertex
+layout(location = 0) in vec3 a_position;
+layout(location = 1) in vec3 a_color;
+
+// DrawIndices in VulkanRenderer.h
+layout(push_constant) uniform DrawIndices {
+	uint mvpBuffer;
+	uint object;
+} draw;
+
+// Global set (BindlessDescriptors): every storage buffer. An MVP buffer holds one MVP per mesh,
+// k_mvpStride (256 bytes, 4 matrices) apart: projection, view, model and padding
+layout(set = 1, binding = 0) readonly buffer MvpBuffer {
+	mat4 matrices[];
+} buffers[];
+
+layout(location = 0) out vec3 v_color;
+
+void main() {
+	uint first = draw.object * 4u;
+	mat4 projection = buffers[draw.mvpBuffer].matrices[first];
+	mat4 view = buffers[draw.mvpBuffer].matrices[first + 1u];
+	mat4 model = buffers[draw.mvpBuffer].matrices[first + 2u];
+
+	v_color = a_color;
+	gl_Position = projection * view * model * vec4(a_position, 1.0);
+}
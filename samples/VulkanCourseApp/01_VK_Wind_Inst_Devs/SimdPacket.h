@@ -0,0 +1,646 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "CpuFeatures.h"
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// Structure of arrays packets: floatx4 / floatx8 hold one float per lane, vec3x8 holds 8 vec3 as x[8], y[8], z[8]
+// and so on, so vector math runs on all lanes at once with no lane left idle (unlike an AoS glm::vec3 in an __m128).
+// loadVec3 / storeVec3 (and the vec4 / mat4 versions) transpose between GLM arrays and packets.
+//
+// Width is fixed at compile time: floatx8 is one AVX register in a translation unit that defines SIMD_PACKET_AVX2
+// before including this (only call its code after getCpuSimdLevel() said AVX2), two SSE registers otherwise.
+// Functions using AVX2 packets must be compiled for AVX2 as well (put SIMD_PACKET_FUNCTION in front of them), or GCC/Clang
+// pass them differently. Each variant lives in its own inline namespace, so the linker never mixes up their copies.
+// Comparisons return masks (all bits set in lanes where true) for select(), any(), all() and the bit operators.
+
+#if defined(SIMD_X86) && (defined(SIMD_PACKET_AVX2) || defined(__AVX2__))
+#define SIMD_PACKET_NATIVE8
+#if !defined(__AVX2__) && defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#define SIMD_PACKET_TARGET_PUSHED
+#elif !defined(__AVX2__) && defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#define SIMD_PACKET_TARGET_PUSHED
+#endif
+#define SIMD_PACKET_NAMESPACE SimdPacketAvx2
+#if !defined(__AVX2__) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_PACKET_FUNCTION __attribute__((target("avx2,fma")))
+#endif
+#elif defined(SIMD_X86)
+#define SIMD_PACKET_NAMESPACE SimdPacketSse
+#else
+#define SIMD_PACKET_NAMESPACE SimdPacketScalar
+#endif
+
+#ifndef SIMD_PACKET_FUNCTION
+#define SIMD_PACKET_FUNCTION
+#endif
+
+inline namespace SIMD_PACKET_NAMESPACE
+{
+
+/** -- FLOAT PACKETS -- **/
+
+struct floatx4
+{
+	static const int width = 4;
+
+#ifdef SIMD_X86
+	__m128 v;
+
+	floatx4() {}
+	floatx4(__m128 value) : v(value) {}
+	explicit floatx4(float value) : v(_mm_set1_ps(value)) {}
+
+	static floatx4 load(const float *p) { return _mm_loadu_ps(p); }
+	void store(float *p) const { _mm_storeu_ps(p, v); }
+#else
+	float v[4];
+
+	floatx4() {}
+	explicit floatx4(float value) { v[0] = v[1] = v[2] = v[3] = value; }
+
+	static floatx4 load(const float *p) { floatx4 r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+	void store(float *p) const { for (int i = 0; i < 4; i++) p[i] = v[i]; }
+#endif
+
+	float lane(int i) const { float values[4]; store(values); return values[i]; }
+};
+
+#ifdef SIMD_X86
+inline floatx4 operator+(floatx4 a, floatx4 b) { return _mm_add_ps(a.v, b.v); }
+inline floatx4 operator-(floatx4 a, floatx4 b) { return _mm_sub_ps(a.v, b.v); }
+inline floatx4 operator*(floatx4 a, floatx4 b) { return _mm_mul_ps(a.v, b.v); }
+inline floatx4 operator/(floatx4 a, floatx4 b) { return _mm_div_ps(a.v, b.v); }
+inline floatx4 operator-(floatx4 a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+
+inline floatx4 operator<(floatx4 a, floatx4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline floatx4 operator<=(floatx4 a, floatx4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline floatx4 operator>(floatx4 a, floatx4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline floatx4 operator>=(floatx4 a, floatx4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline floatx4 operator==(floatx4 a, floatx4 b) { return _mm_cmpeq_ps(a.v, b.v); }
+inline floatx4 operator!=(floatx4 a, floatx4 b) { return _mm_cmpneq_ps(a.v, b.v); }
+
+inline floatx4 operator&(floatx4 a, floatx4 b) { return _mm_and_ps(a.v, b.v); }
+inline floatx4 operator|(floatx4 a, floatx4 b) { return _mm_or_ps(a.v, b.v); }
+inline floatx4 operator^(floatx4 a, floatx4 b) { return _mm_xor_ps(a.v, b.v); }
+inline floatx4 andNot(floatx4 mask, floatx4 a) { return _mm_andnot_ps(mask.v, a.v); }		// a where mask is clear
+
+inline floatx4 min(floatx4 a, floatx4 b) { return _mm_min_ps(a.v, b.v); }
+inline floatx4 max(floatx4 a, floatx4 b) { return _mm_max_ps(a.v, b.v); }
+inline floatx4 abs(floatx4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+inline floatx4 sqrt(floatx4 a) { return _mm_sqrt_ps(a.v); }
+
+// a * b + c
+inline floatx4 fmadd(floatx4 a, floatx4 b, floatx4 c)
+{
+#ifdef SIMD_PACKET_NATIVE8
+	return _mm_fmadd_ps(a.v, b.v, c.v);
+#else
+	return _mm_add_ps(_mm_mul_ps(a.v, b.v), c.v);
+#endif
+}
+
+// Lanes of a where mask is set, of b elsewhere
+inline floatx4 select(floatx4 mask, floatx4 a, floatx4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+
+inline int movemask(floatx4 mask) { return _mm_movemask_ps(mask.v); }		// Bit i set == lane i set
+#else
+#define SIMD_PACKET_SCALAR_OP(op) \
+	inline floatx4 operator op(floatx4 a, floatx4 b) { floatx4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] op b.v[i]; return r; }
+#define SIMD_PACKET_SCALAR_CMP(op) \
+	inline floatx4 operator op(floatx4 a, floatx4 b) { floatx4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] op b.v[i] ? maskTrue() : 0.0f; return r; }
+#define SIMD_PACKET_SCALAR_BIT(name, expr) \
+	inline floatx4 name(floatx4 a, floatx4 b) { floatx4 r; for (int i = 0; i < 4; i++) { uint32_t x = bits(a.v[i]), y = bits(b.v[i]), z = expr; r.v[i] = fromBits(z); } return r; }
+
+inline uint32_t bits(float f) { uint32_t u; memcpy(&u, &f, 4); return u; }
+inline float fromBits(uint32_t u) { float f; memcpy(&f, &u, 4); return f; }
+inline float maskTrue() { return fromBits(0xFFFFFFFFu); }
+
+SIMD_PACKET_SCALAR_OP(+)
+SIMD_PACKET_SCALAR_OP(-)
+SIMD_PACKET_SCALAR_OP(*)
+SIMD_PACKET_SCALAR_OP(/)
+inline floatx4 operator-(floatx4 a) { floatx4 r; for (int i = 0; i < 4; i++) r.v[i] = -a.v[i]; return r; }
+
+SIMD_PACKET_SCALAR_CMP(<)
+SIMD_PACKET_SCALAR_CMP(<=)
+SIMD_PACKET_SCALAR_CMP(>)
+SIMD_PACKET_SCALAR_CMP(>=)
+SIMD_PACKET_SCALAR_CMP(==)
+SIMD_PACKET_SCALAR_CMP(!=)
+
+SIMD_PACKET_SCALAR_BIT(operator&, x & y)
+SIMD_PACKET_SCALAR_BIT(operator|, x | y)
+SIMD_PACKET_SCALAR_BIT(operator^, x ^ y)
+SIMD_PACKET_SCALAR_BIT(andNot, ~x & y)
+
+inline floatx4 min(floatx4 a, floatx4 b) { floatx4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+inline floatx4 max(floatx4 a, floatx4 b) { floatx4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+inline floatx4 abs(floatx4 a) { floatx4 r; for (int i = 0; i < 4; i++) r.v[i] = std::fabs(a.v[i]); return r; }
+inline floatx4 sqrt(floatx4 a) { floatx4 r; for (int i = 0; i < 4; i++) r.v[i] = std::sqrt(a.v[i]); return r; }
+inline floatx4 fmadd(floatx4 a, floatx4 b, floatx4 c) { return a * b + c; }
+inline floatx4 select(floatx4 mask, floatx4 a, floatx4 b) { return (mask & a) | andNot(mask, b); }
+inline int movemask(floatx4 mask) { int m = 0; for (int i = 0; i < 4; i++) m |= (bits(mask.v[i]) >> 31) << i; return m; }
+
+#undef SIMD_PACKET_SCALAR_OP
+#undef SIMD_PACKET_SCALAR_CMP
+#undef SIMD_PACKET_SCALAR_BIT
+#endif
+
+
+struct floatx8
+{
+	static const int width = 8;
+
+#ifdef SIMD_PACKET_NATIVE8
+	__m256 v;
+
+	floatx8() {}
+	floatx8(__m256 value) : v(value) {}
+	explicit floatx8(float value) : v(_mm256_set1_ps(value)) {}
+
+	static floatx8 load(const float *p) { return _mm256_loadu_ps(p); }
+	void store(float *p) const { _mm256_storeu_ps(p, v); }
+#else
+	floatx4 lo, hi;		// Lanes 0-3, 4-7
+
+	floatx8() {}
+	floatx8(floatx4 low, floatx4 high) : lo(low), hi(high) {}
+	explicit floatx8(float value) : lo(value), hi(value) {}
+
+	static floatx8 load(const float *p) { return floatx8(floatx4::load(p), floatx4::load(p + 4)); }
+	void store(float *p) const { lo.store(p); hi.store(p + 4); }
+#endif
+
+	float lane(int i) const { float values[8]; store(values); return values[i]; }
+};
+
+#ifdef SIMD_PACKET_NATIVE8
+inline floatx8 operator+(floatx8 a, floatx8 b) { return _mm256_add_ps(a.v, b.v); }
+inline floatx8 operator-(floatx8 a, floatx8 b) { return _mm256_sub_ps(a.v, b.v); }
+inline floatx8 operator*(floatx8 a, floatx8 b) { return _mm256_mul_ps(a.v, b.v); }
+inline floatx8 operator/(floatx8 a, floatx8 b) { return _mm256_div_ps(a.v, b.v); }
+inline floatx8 operator-(floatx8 a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+
+inline floatx8 operator<(floatx8 a, floatx8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline floatx8 operator<=(floatx8 a, floatx8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+inline floatx8 operator>(floatx8 a, floatx8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline floatx8 operator>=(floatx8 a, floatx8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+inline floatx8 operator==(floatx8 a, floatx8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+inline floatx8 operator!=(floatx8 a, floatx8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ); }
+
+inline floatx8 operator&(floatx8 a, floatx8 b) { return _mm256_and_ps(a.v, b.v); }
+inline floatx8 operator|(floatx8 a, floatx8 b) { return _mm256_or_ps(a.v, b.v); }
+inline floatx8 operator^(floatx8 a, floatx8 b) { return _mm256_xor_ps(a.v, b.v); }
+inline floatx8 andNot(floatx8 mask, floatx8 a) { return _mm256_andnot_ps(mask.v, a.v); }
+
+inline floatx8 min(floatx8 a, floatx8 b) { return _mm256_min_ps(a.v, b.v); }
+inline floatx8 max(floatx8 a, floatx8 b) { return _mm256_max_ps(a.v, b.v); }
+inline floatx8 abs(floatx8 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+inline floatx8 sqrt(floatx8 a) { return _mm256_sqrt_ps(a.v); }
+inline floatx8 fmadd(floatx8 a, floatx8 b, floatx8 c) { return _mm256_fmadd_ps(a.v, b.v, c.v); }
+inline floatx8 select(floatx8 mask, floatx8 a, floatx8 b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+inline int movemask(floatx8 mask) { return _mm256_movemask_ps(mask.v); }
+#else
+#define SIMD_PACKET_SPLIT_OP(op) \
+	inline floatx8 operator op(floatx8 a, floatx8 b) { return floatx8(a.lo op b.lo, a.hi op b.hi); }
+#define SIMD_PACKET_SPLIT_FUNCTION(name) \
+	inline floatx8 name(floatx8 a, floatx8 b) { return floatx8(name(a.lo, b.lo), name(a.hi, b.hi)); }
+
+SIMD_PACKET_SPLIT_OP(+)
+SIMD_PACKET_SPLIT_OP(-)
+SIMD_PACKET_SPLIT_OP(*)
+SIMD_PACKET_SPLIT_OP(/)
+inline floatx8 operator-(floatx8 a) { return floatx8(-a.lo, -a.hi); }
+
+SIMD_PACKET_SPLIT_OP(<)
+SIMD_PACKET_SPLIT_OP(<=)
+SIMD_PACKET_SPLIT_OP(>)
+SIMD_PACKET_SPLIT_OP(>=)
+SIMD_PACKET_SPLIT_OP(==)
+SIMD_PACKET_SPLIT_OP(!=)
+
+SIMD_PACKET_SPLIT_OP(&)
+SIMD_PACKET_SPLIT_OP(|)
+SIMD_PACKET_SPLIT_OP(^)
+SIMD_PACKET_SPLIT_FUNCTION(andNot)
+
+SIMD_PACKET_SPLIT_FUNCTION(min)
+SIMD_PACKET_SPLIT_FUNCTION(max)
+inline floatx8 abs(floatx8 a) { return floatx8(abs(a.lo), abs(a.hi)); }
+inline floatx8 sqrt(floatx8 a) { return floatx8(sqrt(a.lo), sqrt(a.hi)); }
+inline floatx8 fmadd(floatx8 a, floatx8 b, floatx8 c) { return floatx8(fmadd(a.lo, b.lo, c.lo), fmadd(a.hi, b.hi, c.hi)); }
+inline floatx8 select(floatx8 mask, floatx8 a, floatx8 b) { return floatx8(select(mask.lo, a.lo, b.lo), select(mask.hi, a.hi, b.hi)); }
+inline int movemask(floatx8 mask) { return movemask(mask.lo) | (movemask(mask.hi) << 4); }
+
+#undef SIMD_PACKET_SPLIT_OP
+#undef SIMD_PACKET_SPLIT_FUNCTION
+#endif
+
+template <typename F> inline F &operator+=(F &a, F b) { return a = a + b; }
+template <typename F> inline F &operator-=(F &a, F b) { return a = a - b; }
+template <typename F> inline F &operator*=(F &a, F b) { return a = a * b; }
+template <typename F> inline F &operator/=(F &a, F b) { return a = a / b; }
+
+template <typename F> inline bool any(F mask) { return movemask(mask) != 0; }
+template <typename F> inline bool all(F mask) { return movemask(mask) == (1 << F::width) - 1; }
+template <typename F> inline F clamp(F a, F low, F high) { return min(max(a, low), high); }
+
+
+/** -- VECTORS AND MATRICES: one packet per component -- **/
+
+template <typename F>
+struct tvec3x
+{
+	F x, y, z;
+
+	tvec3x() {}
+	tvec3x(F newX, F newY, F newZ) : x(newX), y(newY), z(newZ) {}
+	explicit tvec3x(const glm::vec3 &v) : x(v.x), y(v.y), z(v.z) {}		// Same vector in every lane
+
+	glm::vec3 lane(int i) const { return glm::vec3(x.lane(i), y.lane(i), z.lane(i)); }
+};
+
+template <typename F>
+struct tvec4x
+{
+	F x, y, z, w;
+
+	tvec4x() {}
+	tvec4x(F newX, F newY, F newZ, F newW) : x(newX), y(newY), z(newZ), w(newW) {}
+	tvec4x(const tvec3x<F> &v, F newW) : x(v.x), y(v.y), z(v.z), w(newW) {}
+	explicit tvec4x(const glm::vec4 &v) : x(v.x), y(v.y), z(v.z), w(v.w) {}
+
+	tvec3x<F> xyz() const { return tvec3x<F>(x, y, z); }
+	glm::vec4 lane(int i) const { return glm::vec4(x.lane(i), y.lane(i), z.lane(i), w.lane(i)); }
+};
+
+// Column major like glm::mat4: m[column][row]
+template <typename F>
+struct tmat4x
+{
+	F m[4][4];
+
+	tmat4x() {}
+	explicit tmat4x(const glm::mat4 &matrix)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				m[column][row] = F(matrix[column][row]);
+			}
+		}
+	}
+
+	glm::mat4 lane(int i) const
+	{
+		glm::mat4 matrix;
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				matrix[column][row] = m[column][row].lane(i);
+			}
+		}
+		return matrix;
+	}
+};
+
+typedef tvec3x<floatx4> vec3x4;
+typedef tvec3x<floatx8> vec3x8;
+typedef tvec4x<floatx4> vec4x4;
+typedef tvec4x<floatx8> vec4x8;
+typedef tmat4x<floatx4> mat4x4p;			// Not glm::mat4x4: 4 matrices, one per lane
+typedef tmat4x<floatx8> mat4x8;
+
+template <typename F> inline tvec3x<F> operator+(const tvec3x<F> &a, const tvec3x<F> &b) { return tvec3x<F>(a.x + b.x, a.y + b.y, a.z + b.z); }
+template <typename F> inline tvec3x<F> operator-(const tvec3x<F> &a, const tvec3x<F> &b) { return tvec3x<F>(a.x - b.x, a.y - b.y, a.z - b.z); }
+template <typename F> inline tvec3x<F> operator*(const tvec3x<F> &a, const tvec3x<F> &b) { return tvec3x<F>(a.x * b.x, a.y * b.y, a.z * b.z); }
+template <typename F> inline tvec3x<F> operator/(const tvec3x<F> &a, const tvec3x<F> &b) { return tvec3x<F>(a.x / b.x, a.y / b.y, a.z / b.z); }
+template <typename F> inline tvec3x<F> operator*(const tvec3x<F> &a, F s) { return tvec3x<F>(a.x * s, a.y * s, a.z * s); }
+template <typename F> inline tvec3x<F> operator*(F s, const tvec3x<F> &a) { return a * s; }
+template <typename F> inline tvec3x<F> operator/(const tvec3x<F> &a, F s) { return tvec3x<F>(a.x / s, a.y / s, a.z / s); }
+template <typename F> inline tvec3x<F> operator-(const tvec3x<F> &a) { return tvec3x<F>(-a.x, -a.y, -a.z); }
+
+template <typename F> inline F dot(const tvec3x<F> &a, const tvec3x<F> &b) { return fmadd(a.x, b.x, fmadd(a.y, b.y, a.z * b.z)); }
+template <typename F> inline tvec3x<F> cross(const tvec3x<F> &a, const tvec3x<F> &b)
+{
+	return tvec3x<F>(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+template <typename F> inline F length(const tvec3x<F> &a) { return sqrt(dot(a, a)); }
+template <typename F> inline tvec3x<F> normalize(const tvec3x<F> &a) { return a / length(a); }
+template <typename F> inline tvec3x<F> min(const tvec3x<F> &a, const tvec3x<F> &b) { return tvec3x<F>(min(a.x, b.x), min(a.y, b.y), min(a.z, b.z)); }
+template <typename F> inline tvec3x<F> max(const tvec3x<F> &a, const tvec3x<F> &b) { return tvec3x<F>(max(a.x, b.x), max(a.y, b.y), max(a.z, b.z)); }
+template <typename F> inline tvec3x<F> abs(const tvec3x<F> &a) { return tvec3x<F>(abs(a.x), abs(a.y), abs(a.z)); }
+template <typename F> inline tvec3x<F> select(F mask, const tvec3x<F> &a, const tvec3x<F> &b)
+{
+	return tvec3x<F>(select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z));
+}
+
+template <typename F> inline tvec4x<F> operator+(const tvec4x<F> &a, const tvec4x<F> &b) { return tvec4x<F>(a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w); }
+template <typename F> inline tvec4x<F> operator-(const tvec4x<F> &a, const tvec4x<F> &b) { return tvec4x<F>(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w); }
+template <typename F> inline tvec4x<F> operator*(const tvec4x<F> &a, const tvec4x<F> &b) { return tvec4x<F>(a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w); }
+template <typename F> inline tvec4x<F> operator*(const tvec4x<F> &a, F s) { return tvec4x<F>(a.x * s, a.y * s, a.z * s, a.w * s); }
+template <typename F> inline tvec4x<F> operator*(F s, const tvec4x<F> &a) { return a * s; }
+template <typename F> inline tvec4x<F> operator/(const tvec4x<F> &a, F s) { return tvec4x<F>(a.x / s, a.y / s, a.z / s, a.w / s); }
+template <typename F> inline tvec4x<F> operator-(const tvec4x<F> &a) { return tvec4x<F>(-a.x, -a.y, -a.z, -a.w); }
+
+template <typename F> inline F dot(const tvec4x<F> &a, const tvec4x<F> &b) { return fmadd(a.x, b.x, fmadd(a.y, b.y, fmadd(a.z, b.z, a.w * b.w))); }
+template <typename F> inline F length(const tvec4x<F> &a) { return sqrt(dot(a, a)); }
+template <typename F> inline tvec4x<F> normalize(const tvec4x<F> &a) { return a / length(a); }
+template <typename F> inline tvec4x<F> min(const tvec4x<F> &a, const tvec4x<F> &b) { return tvec4x<F>(min(a.x, b.x), min(a.y, b.y), min(a.z, b.z), min(a.w, b.w)); }
+template <typename F> inline tvec4x<F> max(const tvec4x<F> &a, const tvec4x<F> &b) { return tvec4x<F>(max(a.x, b.x), max(a.y, b.y), max(a.z, b.z), max(a.w, b.w)); }
+template <typename F> inline tvec4x<F> select(F mask, const tvec4x<F> &a, const tvec4x<F> &b)
+{
+	return tvec4x<F>(select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z), select(mask, a.w, b.w));
+}
+
+// m * v per lane
+template <typename F> inline tvec4x<F> operator*(const tmat4x<F> &a, const tvec4x<F> &v)
+{
+	tvec4x<F> result;
+	F *out[4] = { &result.x, &result.y, &result.z, &result.w };
+	for (int row = 0; row < 4; row++)
+	{
+		*out[row] = fmadd(a.m[0][row], v.x, fmadd(a.m[1][row], v.y, fmadd(a.m[2][row], v.z, a.m[3][row] * v.w)));
+	}
+	return result;
+}
+
+// (m * vec4(p, 1)).xyz per lane: no perspective divide
+template <typename F> inline tvec3x<F> transformPoint(const tmat4x<F> &a, const tvec3x<F> &p)
+{
+	return tvec3x<F>(
+		fmadd(a.m[0][0], p.x, fmadd(a.m[1][0], p.y, fmadd(a.m[2][0], p.z, a.m[3][0]))),
+		fmadd(a.m[0][1], p.x, fmadd(a.m[1][1], p.y, fmadd(a.m[2][1], p.z, a.m[3][1]))),
+		fmadd(a.m[0][2], p.x, fmadd(a.m[1][2], p.y, fmadd(a.m[2][2], p.z, a.m[3][2]))));
+}
+
+// a * b per lane
+template <typename F> inline tmat4x<F> operator*(const tmat4x<F> &a, const tmat4x<F> &b)
+{
+	tmat4x<F> result;
+	for (int column = 0; column < 4; column++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			result.m[column][row] = fmadd(a.m[0][row], b.m[column][0], fmadd(a.m[1][row], b.m[column][1],
+				fmadd(a.m[2][row], b.m[column][2], a.m[3][row] * b.m[column][3])));
+		}
+	}
+	return result;
+}
+
+
+/** -- AoS <-> SoA -- **/
+
+#ifdef SIMD_X86
+// 4 packed vec3 (12 floats) -> x, y, z registers
+inline vec3x4 loadVec3x4(const float *p)
+{
+	__m128 m0 = _mm_loadu_ps(p + 0);		// x0 y0 z0 x1
+	__m128 m1 = _mm_loadu_ps(p + 4);		// y1 z1 x2 y2
+	__m128 m2 = _mm_loadu_ps(p + 8);		// z2 x3 y3 z3
+
+	__m128 xy = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));		// x2 y2 x3 y3
+	__m128 yz = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));		// y0 z0 y1 z1
+	return vec3x4(_mm_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0)),
+		_mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)),
+		_mm_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1)));
+}
+
+inline void storeVec3x4(float *p, const vec3x4 &v)
+{
+	__m128 xy = _mm_shuffle_ps(v.x.v, v.y.v, _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 yz = _mm_shuffle_ps(v.y.v, v.z.v, _MM_SHUFFLE(3, 1, 3, 1));
+	__m128 zx = _mm_shuffle_ps(v.z.v, v.x.v, _MM_SHUFFLE(3, 1, 2, 0));
+	_mm_storeu_ps(p + 0, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)));
+	_mm_storeu_ps(p + 4, _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)));
+	_mm_storeu_ps(p + 8, _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+// 4 vec4 starting every stride floats -> x, y, z, w registers
+inline vec4x4 loadVec4x4(const float *p, size_t stride)
+{
+	__m128 r0 = _mm_loadu_ps(p), r1 = _mm_loadu_ps(p + stride), r2 = _mm_loadu_ps(p + 2 * stride), r3 = _mm_loadu_ps(p + 3 * stride);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	return vec4x4(r0, r1, r2, r3);
+}
+
+inline void storeVec4x4(float *p, size_t stride, const vec4x4 &v)
+{
+	__m128 r0 = v.x.v, r1 = v.y.v, r2 = v.z.v, r3 = v.w.v;
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_storeu_ps(p, r0);
+	_mm_storeu_ps(p + stride, r1);
+	_mm_storeu_ps(p + 2 * stride, r2);
+	_mm_storeu_ps(p + 3 * stride, r3);
+}
+#else
+inline vec3x4 loadVec3x4(const float *p)
+{
+	vec3x4 v;
+	for (int i = 0; i < 4; i++)
+	{
+		v.x.v[i] = p[i * 3 + 0];
+		v.y.v[i] = p[i * 3 + 1];
+		v.z.v[i] = p[i * 3 + 2];
+	}
+	return v;
+}
+
+inline void storeVec3x4(float *p, const vec3x4 &v)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		p[i * 3 + 0] = v.x.v[i];
+		p[i * 3 + 1] = v.y.v[i];
+		p[i * 3 + 2] = v.z.v[i];
+	}
+}
+
+inline vec4x4 loadVec4x4(const float *p, size_t stride)
+{
+	vec4x4 v;
+	for (int i = 0; i < 4; i++)
+	{
+		v.x.v[i] = p[i * stride + 0];
+		v.y.v[i] = p[i * stride + 1];
+		v.z.v[i] = p[i * stride + 2];
+		v.w.v[i] = p[i * stride + 3];
+	}
+	return v;
+}
+
+inline void storeVec4x4(float *p, size_t stride, const vec4x4 &v)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		p[i * stride + 0] = v.x.v[i];
+		p[i * stride + 1] = v.y.v[i];
+		p[i * stride + 2] = v.z.v[i];
+		p[i * stride + 3] = v.w.v[i];
+	}
+}
+#endif
+
+#ifdef SIMD_PACKET_NATIVE8
+// 8 packed vec3 (24 floats): points 0-3 go to the lower 128 bits, 4-7 to the upper, then the same shuffles as loadVec3x4
+inline vec3x8 loadVec3x8(const float *p)
+{
+	__m256 m03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 0)), _mm_loadu_ps(p + 12), 1);
+	__m256 m14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+	__m256 m25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+
+	__m256 xy = _mm256_shuffle_ps(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));
+	__m256 yz = _mm256_shuffle_ps(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));
+	return vec3x8(_mm256_shuffle_ps(m03, xy, _MM_SHUFFLE(2, 0, 3, 0)),
+		_mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)),
+		_mm256_shuffle_ps(yz, m25, _MM_SHUFFLE(3, 0, 3, 1)));
+}
+
+inline void storeVec3x8(float *p, const vec3x8 &v)
+{
+	__m256 xy = _mm256_shuffle_ps(v.x.v, v.y.v, _MM_SHUFFLE(2, 0, 2, 0));
+	__m256 yz = _mm256_shuffle_ps(v.y.v, v.z.v, _MM_SHUFFLE(3, 1, 3, 1));
+	__m256 zx = _mm256_shuffle_ps(v.z.v, v.x.v, _MM_SHUFFLE(3, 1, 2, 0));
+	__m256 r03 = _mm256_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0));
+	__m256 r14 = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+	__m256 r25 = _mm256_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1));
+
+	_mm_storeu_ps(p + 0, _mm256_castps256_ps128(r03));
+	_mm_storeu_ps(p + 4, _mm256_castps256_ps128(r14));
+	_mm_storeu_ps(p + 8, _mm256_castps256_ps128(r25));
+	_mm_storeu_ps(p + 12, _mm256_extractf128_ps(r03, 1));
+	_mm_storeu_ps(p + 16, _mm256_extractf128_ps(r14, 1));
+	_mm_storeu_ps(p + 20, _mm256_extractf128_ps(r25, 1));
+}
+
+// 8 vec4 starting every stride floats: vectors i and i + 4 share a register, transposed 4x4 within each 128 bit half
+inline vec4x8 loadVec4x8(const float *p, size_t stride)
+{
+	__m256 r[4];
+	for (int i = 0; i < 4; i++)
+	{
+		r[i] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + i * stride)), _mm_loadu_ps(p + (i + 4) * stride), 1);
+	}
+	__m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);		// x0 x1 y0 y1
+	__m256 t1 = _mm256_unpacklo_ps(r[2], r[3]);		// x2 x3 y2 y3
+	__m256 t2 = _mm256_unpackhi_ps(r[0], r[1]);		// z0 z1 w0 w1
+	__m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);		// z2 z3 w2 w3
+	return vec4x8(_mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2)),
+		_mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2)));
+}
+
+inline void storeVec4x8(float *p, size_t stride, const vec4x8 &v)
+{
+	__m256 t0 = _mm256_unpacklo_ps(v.x.v, v.y.v);		// x0 y0 x1 y1
+	__m256 t1 = _mm256_unpacklo_ps(v.z.v, v.w.v);		// z0 w0 z1 w1
+	__m256 t2 = _mm256_unpackhi_ps(v.x.v, v.y.v);		// x2 y2 x3 y3
+	__m256 t3 = _mm256_unpackhi_ps(v.z.v, v.w.v);		// z2 w2 z3 w3
+	__m256 r[4] = {
+		_mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2)),
+		_mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2))
+	};
+	for (int i = 0; i < 4; i++)
+	{
+		_mm_storeu_ps(p + i * stride, _mm256_castps256_ps128(r[i]));
+		_mm_storeu_ps(p + (i + 4) * stride, _mm256_extractf128_ps(r[i], 1));
+	}
+}
+#else
+inline vec3x8 loadVec3x8(const float *p)
+{
+	vec3x4 lo = loadVec3x4(p), hi = loadVec3x4(p + 12);
+	return vec3x8(floatx8(lo.x, hi.x), floatx8(lo.y, hi.y), floatx8(lo.z, hi.z));
+}
+
+inline void storeVec3x8(float *p, const vec3x8 &v)
+{
+	storeVec3x4(p, vec3x4(v.x.lo, v.y.lo, v.z.lo));
+	storeVec3x4(p + 12, vec3x4(v.x.hi, v.y.hi, v.z.hi));
+}
+
+inline vec4x8 loadVec4x8(const float *p, size_t stride)
+{
+	vec4x4 lo = loadVec4x4(p, stride), hi = loadVec4x4(p + 4 * stride, stride);
+	return vec4x8(floatx8(lo.x, hi.x), floatx8(lo.y, hi.y), floatx8(lo.z, hi.z), floatx8(lo.w, hi.w));
+}
+
+inline void storeVec4x8(float *p, size_t stride, const vec4x8 &v)
+{
+	storeVec4x4(p, stride, vec4x4(v.x.lo, v.y.lo, v.z.lo, v.w.lo));
+	storeVec4x4(p + 4 * stride, stride, vec4x4(v.x.hi, v.y.hi, v.z.hi, v.w.hi));
+}
+#endif
+
+// Packet sized loads/stores from GLM arrays: the packet type picks the width
+inline void loadVec3(const glm::vec3 *p, vec3x4 &v) { v = loadVec3x4(&p->x); }
+inline void loadVec3(const glm::vec3 *p, vec3x8 &v) { v = loadVec3x8(&p->x); }
+inline void storeVec3(glm::vec3 *p, const vec3x4 &v) { storeVec3x4(&p->x, v); }
+inline void storeVec3(glm::vec3 *p, const vec3x8 &v) { storeVec3x8(&p->x, v); }
+
+inline void loadVec4(const glm::vec4 *p, vec4x4 &v) { v = loadVec4x4(&p->x, 4); }
+inline void loadVec4(const glm::vec4 *p, vec4x8 &v) { v = loadVec4x8(&p->x, 4); }
+inline void storeVec4(glm::vec4 *p, const vec4x4 &v) { storeVec4x4(&p->x, 4, v); }
+inline void storeVec4(glm::vec4 *p, const vec4x8 &v) { storeVec4x8(&p->x, 4, v); }
+
+// A matrix's column is a vec4 and the next matrix's same column is 16 floats on
+inline void loadMat4(const glm::mat4 *p, mat4x4p &m)
+{
+	for (int column = 0; column < 4; column++)
+	{
+		vec4x4 v = loadVec4x4(&p[0][column][0], 16);
+		m.m[column][0] = v.x; m.m[column][1] = v.y; m.m[column][2] = v.z; m.m[column][3] = v.w;
+	}
+}
+
+inline void loadMat4(const glm::mat4 *p, mat4x8 &m)
+{
+	for (int column = 0; column < 4; column++)
+	{
+		vec4x8 v = loadVec4x8(&p[0][column][0], 16);
+		m.m[column][0] = v.x; m.m[column][1] = v.y; m.m[column][2] = v.z; m.m[column][3] = v.w;
+	}
+}
+
+inline void storeMat4(glm::mat4 *p, const mat4x4p &m)
+{
+	for (int column = 0; column < 4; column++)
+	{
+		storeVec4x4(&p[0][column][0], 16, vec4x4(m.m[column][0], m.m[column][1], m.m[column][2], m.m[column][3]));
+	}
+}
+
+inline void storeMat4(glm::mat4 *p, const mat4x8 &m)
+{
+	for (int column = 0; column < 4; column++)
+	{
+		storeVec4x8(&p[0][column][0], 16, vec4x8(m.m[column][0], m.m[column][1], m.m[column][2], m.m[column][3]));
+	}
+}
+
+}
+
+#ifdef SIMD_PACKET_TARGET_PUSHED
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+#undef SIMD_PACKET_TARGET_PUSHED
+#endif
+#undef SIMD_PACKET_NAMESPACE
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <fstream>
+#include <stdexcept>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -18,6 +19,14 @@ struct Vertex
 	glm::vec3 a_color;		// vertex color
 };
 
+// Same vertex in half the bytes (RendererSettings::compactVertices); the shader inputs stay vec3, normalized formats read as floats
+// Position is quantized to the mesh bounds, the mesh's dequantize matrix (folded into its model matrix) scales it back
+struct CompactVertex
+{
+	int16_t a_position[4];	// VK_FORMAT_R16G16B16A16_SNORM: -1..1 over the bounds (w unused, 3 x 16 bit isn't a required vertex format)
+	uint8_t a_color[4];		// VK_FORMAT_R8G8B8A8_UNORM (alpha unused)
+};
+
 // Indices (location) of queue families if they exists at all
 struct QueueFamilyIndices
 {
@@ -73,21 +82,30 @@ static std::vector<char> readFile(const std::string &filename)
 }
 
 
-static uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t allowedTypes, VkMemoryPropertyFlags properties)
+// Index of a memory type allowed by the resource (bit i of allowedTypes) with all the given properties.
+// preferredProperties are only a preference (e.g. lazily allocated): tried first, dropped if no type has them
+static uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t allowedTypes, VkMemoryPropertyFlags properties,
+									VkMemoryPropertyFlags preferredProperties = 0)
 {
 	// Properties of Physical device
 	VkPhysicalDeviceMemoryProperties memoryProperties;
 	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
 
-	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	VkMemoryPropertyFlags wantedProperties[] = { properties | preferredProperties, properties };
+	for (VkMemoryPropertyFlags wanted : wantedProperties)
 	{
-		if ((allowedTypes & (i << 1))														// index of mem type must match corresponding bit in allowedTypes
-			&& (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)	// Desired properties bit flags are part of memory type's properties flags
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
 		{
-			// This mem type is valid so return its index
-			return i;
+			if ((allowedTypes & (1u << i))														// index of mem type must match corresponding bit in allowedTypes
+				&& (memoryProperties.memoryTypes[i].propertyFlags & wanted) == wanted)		// Desired properties bit flags are part of memory type's properties flags
+			{
+				// This mem type is valid so return its index
+				return i;
+			}
 		}
 	}
+
+	throw std::runtime_error("Failed to find a suitable MEMORY TYPE!");
 }
 
 
@@ -1,14 +1,47 @@
 #include "VulkanRenderer.h"
 
 
+// Stages of a pipeline up to rasterization: vertex, or task and mesh (depth-only passes don't need the fragment shader)
+static std::vector<ShaderStageDesc> withoutFragmentStage(const std::vector<ShaderStageDesc> &shaderStages)
+{
+	std::vector<ShaderStageDesc> geometryStages;
+	for (const auto &shaderStage : shaderStages)
+	{
+		if (shaderStage.stage != VK_SHADER_STAGE_FRAGMENT_BIT)
+		{
+			geometryStages.push_back(shaderStage);
+		}
+	}
+	return geometryStages;
+}
+
+static bool hasDeviceExtension(VkPhysicalDevice physicalDevice, const char *extensionName)
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+	for (const auto &extension : extensions)
+	{
+		if (strcmp(extension.extensionName, extensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 
 VulkanRenderer::VulkanRenderer()
 {
 }
 
-int VulkanRenderer::init(GLFWwindow* newWindow)
+int VulkanRenderer::init(GLFWwindow* newWindow, JobSystem *jobSystem, const RendererSettings &settings)
 {
 	m_window = newWindow;
+	m_jobSystem = jobSystem;
+	m_settings = settings;
 
 	try
 	{
@@ -17,19 +50,36 @@ int VulkanRenderer::init(GLFWwindow* newWindow)
 		createSurface();
 		getPhysicalDevice();
 		createLogicalDevice();
+		m_pipelineCompiler.init(m_mainDevice.logicalDevice);
+		m_pipelineRegistry.init(m_mainDevice.logicalDevice, &m_pipelineCompiler);
+		m_layoutCache.init(m_mainDevice.logicalDevice);
+		if (m_bindless)
+		{
+			m_bindlessDescriptors.init(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, 1024, 4096);
+		}
 		createSwapchain();
+		m_msaaSamples = chooseSampleCount(m_settings.msaaSamples);
+		createColorBufferImage();
+		createDepthBufferImage();
 		createRenderPass();
+		loadShaders();
 		createDescriptorSetLayout();
 		createGraphicsPipeline();
+		if (m_meshletPath == MeshletPath::Compute)
+		{
+			createMeshletCullPipeline();
+		}
 		createFramebuffers();
 		createCommandPool();
 
-		m_mvp.projection = glm::perspective(glm::radians(45.0f), (float)m_swapchainExtent.width / (float)m_swapchainExtent.height, 0.1f, 100.0f);
+		m_mvp.projection = glm::perspective(glm::radians(45.0f), (float)m_swapchainExtent.width / (float)m_swapchainExtent.height, k_nearPlane, k_farPlane);
 		m_mvp.view = glm::lookAt(glm::vec3(3.0f, 1.0f, 2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 		m_mvp.model = glm::mat4(1.0);
 
 		m_mvp.projection[1][1] *= -1;
 
+		m_sceneRoot = m_scene.addNode(SceneGraph::k_noParent, m_mvp.model);
+
 		// CREATE MESH DATA
 		// Vertex Data
 		std::vector<Vertex> meshVertices = {
@@ -46,6 +96,11 @@ int VulkanRenderer::init(GLFWwindow* newWindow)
 			{glm::vec3(0.1, -0.4, 0.0), glm::vec3(1.0, 1.0, 1.0)},
 		};
 
+		MeshSettings meshSettings;
+		meshSettings.compactVertices = m_settings.compactVertices;
+		meshSettings.split16BitIndices = m_settings.split16BitIndices;
+		meshSettings.buildMeshlets = m_meshletPath != MeshletPath::None;
+
 		// Index Data
 		std::vector<uint32_t> meshIndices = {
 			0, 1, 2,
@@ -54,20 +109,66 @@ int VulkanRenderer::init(GLFWwindow* newWindow)
 
 		Mesh firstMesh = Mesh(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice,
 						 m_graphicsQueue, m_graphicsCmdPool,
-						 &meshVertices, &meshIndices);
+						 &meshVertices, &meshIndices, meshSettings, m_jobSystem);
 		Mesh secondMesh = Mesh(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice,
 						m_graphicsQueue, m_graphicsCmdPool,
-						&meshVertices2, &meshIndices);
+						&meshVertices2, &meshIndices, meshSettings, m_jobSystem);
+
+		secondMesh.setOpacity(0.5f);								// Drawn in the transparent pass
 
 		meshList.push_back(firstMesh);
 		meshList.push_back(secondMesh);
 
+		// Overdraw benchmark: quads covering the view, submitted back to front (worst order for early-Z)
+		std::vector<uint32_t> quadIndices = {
+			0, 1, 2,
+			2, 3, 0
+		};
+		for (uint32_t i = 0; i < m_settings.overdrawLayers; i++)
+		{
+			float z = -1.0f + (i + 1) * (0.9f / (m_settings.overdrawLayers + 1));		// -1 (far) .. -0.1 (near)
+			float shade = 0.2f + 0.6f * i / m_settings.overdrawLayers;
+			std::vector<Vertex> quadVertices = {
+				{glm::vec3(-2.0, -2.0, z), glm::vec3(shade)},
+				{glm::vec3(2.0, -2.0, z), glm::vec3(shade)},
+				{glm::vec3(2.0, 2.0, z), glm::vec3(shade)},
+				{glm::vec3(-2.0, 2.0, z), glm::vec3(shade)},
+			};
+			meshList.push_back(Mesh(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice,
+						m_graphicsQueue, m_graphicsCmdPool,
+						&quadVertices, &quadIndices, meshSettings, m_jobSystem));
+		}
+
+		// Every mesh hangs off the root, placed where its vertices already are
+		for (size_t i = 0; i < meshList.size(); i++)
+		{
+			m_meshNodes.push_back(m_scene.addNode(m_sceneRoot, glm::mat4(1.0f)));
+		}
+		m_scene.updateWorldTransforms();
+
 		createCommandBuffers();
 		createUniformBuffers();
+		createMeshletBuffers();
 		createDescriptorPool();
 		createDescriptorSets();
+
+		createTimestampQueryPool();
+
+		// Commands need the pipeline, so wait for it to finish compiling
+		m_graphicsPipeline = m_graphicsPipelineFuture.get();
+		m_transparentPipeline = m_transparentPipelineFuture.get();
+		if (m_settings.depthPrePass)
+		{
+			m_depthPrePassPipeline = m_depthPrePassPipelineFuture.get();
+		}
+
+		cullMeshes();
+		sortTransparentMeshes();
 		recordCommands();
 		createSynchronization();
+
+		// Recompile shaders when their GLSL is saved; picked up in draw()
+		m_shaderWatcher.init("./Shaders", { { "shader.vert", "vert.spv" }, { "shader_bindless.vert", "vert_bindless.spv" }, { "shader.frag", "frag.spv" } });
 	}
 	catch (const std::runtime_error &e)
 	{
@@ -80,16 +181,26 @@ int VulkanRenderer::init(GLFWwindow* newWindow)
 
 void VulkanRenderer::UpdateModel(glm::mat4 newModel)
 {
-	m_mvp.model = newModel;
+	m_scene.setLocalTransform(m_sceneRoot, newModel);
+}
+
+double VulkanRenderer::takeAverageGpuTime()
+{
+	double average = m_gpuTimeFrames > 0 ? m_gpuTimeTotal / m_gpuTimeFrames : 0.0;
+	m_gpuTimeTotal = 0.0;
+	m_gpuTimeFrames = 0;
+	return average;
 }
 
 void VulkanRenderer::draw()
 {
+	/* -- HOT RELOAD -- */
+	// Frame boundary: start rebuilding for recompiled shaders, swap in a finished rebuild (never waits for one)
+	reloadShaders();
+
 	/* -- GET NEXT IMAGE -- */
 	// Wait for given fence to signal (open) from last draw before continuing
 	vkWaitForFences(m_mainDevice.logicalDevice, 1, &m_drawFences[m_currFrame], VK_TRUE, std::numeric_limits<uint64_t>::max()); // opening the fence
-	// Manually reset (close) fences
-	vkResetFences(m_mainDevice.logicalDevice, 1, &m_drawFences[m_currFrame]);	// closing the fence
 
 
 	// Get index of the next image to be drawn to, and signal semaphore when ready to be drawn to
@@ -97,8 +208,34 @@ void VulkanRenderer::draw()
 	vkAcquireNextImageKHR(m_mainDevice.logicalDevice, m_swapchain, std::numeric_limits<uint64_t>::max(), 
 							m_semaphoreImageAvailable[m_currFrame], VK_NULL_HANDLE, &imageIndex);
 
+	// Image's cmd buffer may still be in use by an earlier frame (more images than frames in flight); usually already done
+	if (m_imageFences[imageIndex] != VK_NULL_HANDLE)
+	{
+		vkWaitForFences(m_mainDevice.logicalDevice, 1, &m_imageFences[imageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+	m_imageFences[imageIndex] = m_drawFences[m_currFrame];
+
+	// Last submission of this cmd buffer is done, so its timestamps are ready
+	readTimestamps(imageIndex);
+
+	// World transforms of whatever moved since last frame
+	m_scene.updateWorldTransforms(m_jobSystem);
+
+	// Pipeline, visible meshes or transparent draw order changed since this cmd buffer was recorded: record it again now that it's idle
+	cullMeshes();
+	sortTransparentMeshes();
+	if (m_recordedGeneration[imageIndex] != m_pipelineGeneration || m_recordedVisibleMeshes[imageIndex] != m_visibleMeshes
+		|| m_recordedTransparentOrder[imageIndex] != m_transparentOrder)
+	{
+		recordCommandBuffer(imageIndex);
+	}
+	destroyRetiredPipelines(false);
+
 	UpdateUniformBuffer(imageIndex);
 
+	// Manually reset (close) fences; only now, as the image fence above may be this same fence
+	vkResetFences(m_mainDevice.logicalDevice, 1, &m_drawFences[m_currFrame]);	// closing the fence
+
 	/* -- SUBMIT COMMAND BUFFER TO RENDER -- */
 	// Queue submission informaiton
 	VkSubmitInfo submitInfo = {};
@@ -120,6 +257,10 @@ void VulkanRenderer::draw()
 	{
 		throw std::runtime_error("Failed to SUBMIT COMMAND BUFFER TO QUEUE!");
 	}
+	if (m_timestampQueryPool != VK_NULL_HANDLE)
+	{
+		m_timestampsPending[imageIndex] = true;
+	}
 
 	// 3. Present image to screen when it has signaled finished rendering
 	/* -- PRESENT RENDERED IMAGE TO SCREEN -- */
@@ -261,14 +402,78 @@ void VulkanRenderer::createLogicalDevice()
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());		// number of queue create infos
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();								// List of create infos so dev can create requried queues
-	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());	//Num of logical dev ext. instance handles extensions
-	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();							// list of enabled logical dev ext
+	std::vector<const char*> enabledExtensions = deviceExtensions;
 	//deviceCreateInfo.enabledLayerCount = 0;
 
 	// physical device features used by logical device
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;		// enable shader stages:VS, GS, TS, etc
 
+	// Descriptor indexing (VK 1.2) for the global bindless set, if the device has it
+	VkPhysicalDeviceVulkan12Features vulkan12Features;
+	m_bindless = BindlessDescriptors::getDeviceFeatures(m_mainDevice.physicalDevice, vulkan12Features);
+
+	// Cull mode, depth test and topology are core dynamic states from VK 1.3 (VK_EXT_extended_dynamic_state before)
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(m_mainDevice.physicalDevice, &deviceProperties);
+	m_extendedDynamicState = deviceProperties.apiVersion >= VK_API_VERSION_1_3;
+
+	// Meshlets: mesh shaders if the device has them (and vertices are floats, which is what meshlet.mesh reads),
+	// else indirect draws written by a cull pass; the compute path stays enabled as the fallback
+	VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = {};
+	meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+	if (m_settings.meshlets && deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+	{
+		bool meshShaderExtension = hasDeviceExtension(m_mainDevice.physicalDevice, VK_EXT_MESH_SHADER_EXTENSION_NAME);
+
+		VkPhysicalDeviceVulkan12Features supported12 = {};
+		supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		VkPhysicalDeviceMeshShaderFeaturesEXT supportedMeshShader = {};
+		supportedMeshShader.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+		supported12.pNext = meshShaderExtension ? &supportedMeshShader : nullptr;
+		VkPhysicalDeviceFeatures2 features = {};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &supported12;
+		vkGetPhysicalDeviceFeatures2(m_mainDevice.physicalDevice, &features);
+
+		// More than one draw per indirect call needs multiDrawIndirect. The GPU written draw count is optional:
+		// without it each mesh draws all its meshlet slots, the culled ones with zero instances
+		if (features.features.multiDrawIndirect)
+		{
+			deviceFeatures.multiDrawIndirect = VK_TRUE;
+			m_drawIndirectCount = supported12.drawIndirectCount == VK_TRUE;
+			vulkan12Features.drawIndirectCount = supported12.drawIndirectCount;
+			m_meshletPath = MeshletPath::Compute;
+		}
+
+		if (m_settings.meshShaders && !m_settings.compactVertices && supportedMeshShader.taskShader && supportedMeshShader.meshShader)
+		{
+			meshShaderFeatures.taskShader = VK_TRUE;
+			meshShaderFeatures.meshShader = VK_TRUE;
+			enabledExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+			m_meshletPath = MeshletPath::MeshShader;
+		}
+	}
+	if (m_settings.meshlets && m_meshletPath == MeshletPath::None)
+	{
+		std::cout << "Meshlets need VK_EXT_mesh_shader or VK 1.2 and multiDrawIndirect: drawing whole meshes" << std::endl;
+	}
+
+	// Feature structs the device gets: bindless and draw count are both in the VK 1.2 one
+	if (meshShaderFeatures.meshShader)
+	{
+		meshShaderFeatures.pNext = const_cast<void *>(deviceCreateInfo.pNext);
+		deviceCreateInfo.pNext = &meshShaderFeatures;
+	}
+	if (m_bindless || vulkan12Features.drawIndirectCount)
+	{
+		vulkan12Features.pNext = const_cast<void *>(deviceCreateInfo.pNext);
+		deviceCreateInfo.pNext = &vulkan12Features;
+	}
+
+	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());	//Num of logical dev ext. instance handles extensions
+	deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();						// list of enabled logical dev ext
+
 	// create the logical device for the given physical device
 	VkResult result = vkCreateDevice(m_mainDevice.physicalDevice, &deviceCreateInfo, nullptr, &m_mainDevice.logicalDevice);
 	if (result != VK_SUCCESS)
@@ -281,6 +486,12 @@ void VulkanRenderer::createLogicalDevice()
 	// From given logical device, of given queue family, of given queue index (0 since only 1 queue), place ref in given vkQueue
 	vkGetDeviceQueue(m_mainDevice.logicalDevice, indices.graphicsFamily, 0, &m_graphicsQueue);	// grab our queue for us
 	vkGetDeviceQueue(m_mainDevice.logicalDevice, indices.presentationFamily, 0, &m_presentationQueue);	// grab our queue for us
+
+	if (m_meshletPath == MeshletPath::MeshShader)
+	{
+		m_cmdDrawMeshTasks = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(
+			vkGetDeviceProcAddr(m_mainDevice.logicalDevice, "vkCmdDrawMeshTasksEXT"));
+	}
 }
 
 void VulkanRenderer::createSurface()
@@ -407,49 +618,147 @@ void VulkanRenderer::createSwapchain()
 	}
 }
 
+void VulkanRenderer::createDepthBufferImage()
+{
+	// Get a depth format the device can use as an attachment (prefer 32 bit float)
+	m_depthFormat = chooseSupportedFormat(
+		{ VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM },
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+	m_depthBufferImages.resize(m_swapchainImages.size());
+	m_depthBufferImageMemory.resize(m_swapchainImages.size());
+	m_depthBufferImageViews.resize(m_swapchainImages.size());
+
+	for (size_t i = 0; i < m_swapchainImages.size(); i++)
+	{
+		// Only used inside the render pass, never read after it; same sample count as the color buffer
+		m_depthBufferImages[i] = createTransientImage(m_depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, m_msaaSamples,
+			&m_depthBufferImageMemory[i]);
+
+		m_depthBufferImageViews[i] = createImageView(m_depthBufferImages[i], m_depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+	}
+}
+
+void VulkanRenderer::createColorBufferImage()
+{
+	// Without MSAA the pass renders straight into the swapchain image
+	if (m_msaaSamples == VK_SAMPLE_COUNT_1_BIT)
+	{
+		return;
+	}
+
+	m_colorBufferImages.resize(m_swapchainImages.size());
+	m_colorBufferImageMemory.resize(m_swapchainImages.size());
+	m_colorBufferImageViews.resize(m_swapchainImages.size());
+
+	for (size_t i = 0; i < m_swapchainImages.size(); i++)
+	{
+		// Samples are resolved in the subpass and dropped, so they never leave the tile
+		m_colorBufferImages[i] = createTransientImage(m_swapchainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, m_msaaSamples,
+			&m_colorBufferImageMemory[i]);
+
+		m_colorBufferImageViews[i] = createImageView(m_colorBufferImages[i], m_swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+}
+
 void VulkanRenderer::createRenderPass()
 {
+	bool multisampled = m_msaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
 	// Color attachment of render pass: all sub-passes has access to this attachment
+	// With MSAA this is the multisampled color buffer, resolved into the swapchain image (attachment 2) and then dropped
 	VkAttachmentDescription colorAttachment = {};
 	colorAttachment.format = m_swapchainImageFormat;					// Format to use for the attachment. we had it saved
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;					// Number of sample to write in multisampling
+	colorAttachment.samples = m_msaaSamples;							// Number of sample to write in multisampling
 	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;				// Describes what to do with the attachment b4 rendering; Equiv to GL_CLEAR operation in OpenGL.
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;				// Describes what to do with the attachment after rendering;
+	colorAttachment.storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE	// Describes what to do with the attachment after rendering;
+										   : VK_ATTACHMENT_STORE_OP_STORE;
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;	// Describes what to do with Stencil b4 rendering;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;	// Describes what to do with Stencil after rendering;
 	// Framebuffer data will be store as an image, but images can be given different data layout
 	// to give optimal use for certain operations
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;			// Image data layout b4 render pass starts
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;		// Image data layout after render pass (to change to)
+	colorAttachment.finalLayout = multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL	// Image data layout after render pass (to change to)
+											   : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	// Resolve attachment (MSAA only): the swapchain image, written once per pixel by the resolve at the end of the color subpass
+	VkAttachmentDescription resolveAttachment = {};
+	resolveAttachment.format = m_swapchainImageFormat;
+	resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;			// Every pixel gets overwritten by the resolve
+	resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	resolveAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	// Depth attachment of render pass: cleared each frame, not needed once the pass is done
+	VkAttachmentDescription depthAttachment = {};
+	depthAttachment.format = m_depthFormat;
+	depthAttachment.samples = m_msaaSamples;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 	// Attachment reference uses an attachment index that refers to index in attachment list passed to renderPassCreateInfo;
 	VkAttachmentReference colorAttachmentReference = {};
 	colorAttachmentReference.attachment = 0;
 	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+	VkAttachmentReference depthAttachmentReference = {};
+	depthAttachmentReference.attachment = 1;
+	depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference resolveAttachmentReference = {};
+	resolveAttachmentReference.attachment = 2;
+	resolveAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	std::vector<VkSubpassDescription> subpasses;
+
+	// Optional depth pre-pass: depth only, lays down the nearest depth of every pixel
+	if (m_settings.depthPrePass)
+	{
+		VkSubpassDescription depthSubpass = {};
+		depthSubpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		depthSubpass.colorAttachmentCount = 0;
+		depthSubpass.pDepthStencilAttachment = &depthAttachmentReference;
+		subpasses.push_back(depthSubpass);
+	}
+	m_colorSubpass = static_cast<uint32_t>(subpasses.size());
+
 	// Information about a particular SUBPASS the Render pass is using
 	VkSubpassDescription subpass = {};
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;		// Pipeline type subpass is to be bound to
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &colorAttachmentReference;
+	subpass.pDepthStencilAttachment = &depthAttachmentReference;
+	subpass.pResolveAttachments = multisampled ? &resolveAttachmentReference : nullptr;	// Resolve MSAA color in the subpass: no separate resolve pass
+	subpasses.push_back(subpass);
 
 	// Need to determine when layout transition occurs using subpass dependencies
-	std::array<VkSubpassDependency, 2> subpassDependencies;
+	std::vector<VkSubpassDependency> subpassDependencies(2);
 
-	// 1. Conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+	// 1. Conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL (and clear of depth)
 	// Transition must happen after ..
 	subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;						// Subpass index (VK_SUBPASS_EXTERNAL : Special value meaning outside of renderpass
-	subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;		// Pipeline Stage; Which stage of pipeline has to happen this conversion. End of pipeline
-	subpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;				// Stage Access mask (memory access)
+	subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT		// Pipeline Stage; Which stage of pipeline has to happen this conversion. End of pipeline
+										| VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;	// and last depth writes of earlier frames
+	subpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT				// Stage Access mask (memory access)
+										| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 	// But must happen before..
 	subpassDependencies[0].dstSubpass = 0;												
-	subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+										| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 	subpassDependencies[0].dependencyFlags = 0;					// Setting up to 0 means we have no dependencies, usually it holds a garbage value by default
 
 	// 2. Conversion from VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL to VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
 	// Transition must happen after ..
-	subpassDependencies[1].srcSubpass = 0;													 
+	subpassDependencies[1].srcSubpass = m_colorSubpass;
 	subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;	
 	subpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 	// But must happen before..
@@ -458,13 +767,51 @@ void VulkanRenderer::createRenderPass()
 	subpassDependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
 	subpassDependencies[1].dependencyFlags = 0;
 
+	// 3. With a depth pre-pass the color (or resolve) attachment is first used in subpass 1, so its transition and
+	// first writes need their own dependency on the acquire (the one above only covers the depth-only subpass 0)
+	if (m_colorSubpass != 0)
+	{
+		subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		subpassDependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		VkSubpassDependency colorDependency = {};
+		colorDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+		colorDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;	// Stage the image available semaphore is waited at
+		colorDependency.srcAccessMask = 0;
+		colorDependency.dstSubpass = m_colorSubpass;
+		colorDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		colorDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		colorDependency.dependencyFlags = 0;
+		subpassDependencies.push_back(colorDependency);
+	}
+
+	// 4. Pre-pass depth writes must be done before the color pass tests against them
+	if (m_settings.depthPrePass)
+	{
+		VkSubpassDependency depthDependency = {};
+		depthDependency.srcSubpass = 0;
+		depthDependency.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		depthDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		depthDependency.dstSubpass = m_colorSubpass;
+		depthDependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		depthDependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+		depthDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;		// Each pixel only needs its own depth
+		subpassDependencies.push_back(depthDependency);
+	}
+
+	std::vector<VkAttachmentDescription> renderPassAttachments = { colorAttachment, depthAttachment };
+	if (multisampled)
+	{
+		renderPassAttachments.push_back(resolveAttachment);
+	}
+
 	// Create info for RenderPass
 	VkRenderPassCreateInfo renderPassCreateInfo = {};
 	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassCreateInfo.attachmentCount = 1;
-	renderPassCreateInfo.pAttachments = &colorAttachment;
-	renderPassCreateInfo.subpassCount = 1;
-	renderPassCreateInfo.pSubpasses = &subpass;
+	renderPassCreateInfo.attachmentCount = static_cast<uint32_t>(renderPassAttachments.size());
+	renderPassCreateInfo.pAttachments = renderPassAttachments.data();
+	renderPassCreateInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+	renderPassCreateInfo.pSubpasses = subpasses.data();
 	renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
 	renderPassCreateInfo.pDependencies = subpassDependencies.data();
 
@@ -476,248 +823,470 @@ void VulkanRenderer::createRenderPass()
 	}
 }
 
-void VulkanRenderer::createDescriptorSetLayout()
+void VulkanRenderer::loadShaders()
 {
-	// MVP binding info
-	VkDescriptorSetLayoutBinding mvpLayoutBinding = {};
-	mvpLayoutBinding.binding = 0;											// Binding point in shader (designated by "binding" number)
-	mvpLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;	// Types of descriptors (uniform, dynamic, sampler, etc)
-	mvpLayoutBinding.descriptorCount = 1;									// Number of descriptors for binding
-	mvpLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;				// Which shader stage to bind to
-	mvpLayoutBinding.pImmutableSamplers = nullptr;							// For textures: can make sampler data unchangeable (inmutable) by specifying in layout
+	// SPIR-V code for shader is compiled into the executable (no file reads); paths are kept for reloading
+	m_shaderStages.clear();
+	// With bindless the vertex shader reads its MVP from the global set, so it needs no set 0
+	m_shaderStages.push_back(embeddedShaderStage(VK_SHADER_STAGE_VERTEX_BIT,   m_bindless ? "./Shaders/vert_bindless.spv" : "./Shaders/vert.spv"));
+	m_shaderStages.push_back(embeddedShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, "./Shaders/frag.spv"));
 
+	// Read the resource interface out of the SPIR-V, so layouts can't drift from the shaders
+	m_shaderReflection = reflectGraphicsShaders(m_shaderStages);
 
-	// Create Descriptor Set Layout  w/ given binding
-	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
-	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutCreateInfo.bindingCount = 1;										// Number of binding infos
-	layoutCreateInfo.pBindings = &mvpLayoutBinding;							// Array of binding info
+	if (m_meshletPath != MeshletPath::None)
+	{
+		loadMeshletShaders();
+	}
+	updateShaderFeatures();
+}
 
-	// Create Descriptor Set Layout
-	VkResult result = vkCreateDescriptorSetLayout(m_mainDevice.logicalDevice, &layoutCreateInfo, nullptr, &m_descriptorSetLayout);
-	if (result != VK_SUCCESS)
+void VulkanRenderer::updateShaderFeatures()
+{
+	// Values for the toggles the shaders declare (looked up by name, so constant ids may change on reload)
+	m_shaderFeatures = SpecializationConstants();
+	uint32_t constantId;
+	if (m_shaderReflection.findSpecConstant("k_showDepth", constantId))
 	{
-		throw std::runtime_error("Failed to Create a DESCRIPTOR SET LAYOUT!");
+		m_shaderFeatures.set(constantId, m_settings.showDepth);
 	}
+	if (m_shaderReflection.findSpecConstant("k_nearPlane", constantId))
+	{
+		m_shaderFeatures.set(constantId, k_nearPlane);
+	}
+	if (m_shaderReflection.findSpecConstant("k_farPlane", constantId))
+	{
+		m_shaderFeatures.set(constantId, k_farPlane);
+	}
+}
 
+void VulkanRenderer::setShowDepth(bool showDepth)
+{
+	if (showDepth == m_settings.showDepth)
+	{
+		return;
+	}
+	m_settings.showDepth = showDepth;
+	updateShaderFeatures();
+
+	// Registry hands back a variant it already has (finished or compiling) instead of building it again.
+	// The pre-pass has no fragment stage, so it is the same for every variant and stays
+	m_reloadedPipelineFuture = m_pipelineRegistry.getVariant(m_graphicsPipelineDesc, m_shaderFeatures);
+	m_reloadedTransparentFuture = m_pipelineRegistry.getVariant(m_transparentPipelineDesc, m_shaderFeatures);
+	std::cout << "Depth view " << (showDepth ? "on" : "off") << ": " << m_pipelineRegistry.getPipelineCount() << " pipelines compiled for "
+		<< m_pipelineRegistry.getRequestCount() << " requests" << std::endl;
 }
 
-void VulkanRenderer::createGraphicsPipeline()
+void VulkanRenderer::loadMeshletShaders()
 {
-	// read in SPIR-V code for shader
-	auto vertexShaderCode		= readFile("./Shaders/vert.spv");
-	auto fragmentShaderCode	= readFile("./Shaders/frag.spv");
+	// Embedded like the other stages (the device picked the path, so the SPIR-V 1.4 task and mesh stages are supported)
+	if (m_meshletPath == MeshletPath::MeshShader)
+	{
+		std::vector<ShaderStageDesc> shaderStages = {
+			embeddedShaderStage(VK_SHADER_STAGE_TASK_BIT_EXT, "./Shaders/meshlet_task.spv"),
+			embeddedShaderStage(VK_SHADER_STAGE_MESH_BIT_EXT, "./Shaders/meshlet_mesh.spv"),
+		};
+		for (const auto &shaderStage : m_shaderStages)
+		{
+			if (shaderStage.stage == VK_SHADER_STAGE_FRAGMENT_BIT)
+			{
+				shaderStages.push_back(shaderStage);				// meshlet.mesh has shader.vert's outputs
+			}
+		}
+		m_shaderStages = shaderStages;
+		m_shaderReflection = reflectGraphicsShaders(shaderStages);
+	}
 
-	// Build a Shader Module to link to Graphics Pipeline
-	// once we create graphics pipeline, we don't need these modules
-	// -- and we have to destroy the modules
+	if (m_meshletPath == MeshletPath::Compute)
+	{
+		m_meshletCullStage = embeddedShaderStage(VK_SHADER_STAGE_COMPUTE_BIT, "./Shaders/meshlet_cull.spv");
+		m_meshletCullReflection = reflectShaders({ m_meshletCullStage });
+	}
+}
 
-	// CREATE SHADER MODULE
-	VkShaderModule vertexShaderModule	= createShaderModule(vertexShaderCode);
-	VkShaderModule fragmentShaderModule = createShaderModule(fragmentShaderCode);
+ShaderReflection VulkanRenderer::reflectGraphicsShaders(const std::vector<ShaderStageDesc> &shaderStages)
+{
+	// Every mesh's MVP sits k_mvpStride apart in the one uniform buffer: a dynamic offset per draw picks it,
+	// so one set per image serves every mesh
+	ShaderReflection reflection = reflectShaders(shaderStages);
+	reflection.makeDynamic(0, 0);
+	return reflection;
+}
 
-	/** -- SHADER STAGE CREATION INFORMATION -- **/
-	// Vertex Stage creation information
-	VkPipelineShaderStageCreateInfo vertexShaderCreateInfo = {};
-	vertexShaderCreateInfo.sType	= VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	vertexShaderCreateInfo.stage	= VK_SHADER_STAGE_VERTEX_BIT;							// Shader stage name
-	vertexShaderCreateInfo.module	= vertexShaderModule;									// shader module to be used by the stage
-	vertexShaderCreateInfo.pName	= "main";												// entry point into shader
+void VulkanRenderer::reloadShaders()
+{
+	// Shaders recompiled by the watcher: load them and queue a pipeline build (through the shared pipeline cache)
+	std::vector<std::string> recompiled = m_shaderWatcher.takeRecompiled();
+	if (!recompiled.empty())
+	{
+		try
+		{
+			std::vector<ShaderStageDesc> shaderStages = m_shaderStages;
+			for (auto &shaderStage : shaderStages)
+			{
+				if (std::find(recompiled.begin(), recompiled.end(), shaderStage.path) != recompiled.end())
+				{
+					shaderStage = loadShaderStage(shaderStage.stage, shaderStage.path);
+				}
+			}
 
-	// Fragment Stage creation information
-	VkPipelineShaderStageCreateInfo fragmentShaderCreateInfo = {};
-	fragmentShaderCreateInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	fragmentShaderCreateInfo.stage  = VK_SHADER_STAGE_FRAGMENT_BIT;							// Shader stage name
-	fragmentShaderCreateInfo.module = fragmentShaderModule;									// shader module to be used by the stage
-	fragmentShaderCreateInfo.pName  = "main";												// entry point into shader
+			// Descriptor sets and vertex buffers are built for the current interface: it must stay the same
+			ShaderReflection reflection = reflectGraphicsShaders(shaderStages);
+			if (getPipelineLayout(reflection) != m_pipelineLayout || reflection.vertexStride != m_shaderReflection.vertexStride)
+			{
+				throw std::runtime_error("Shader interface changed, restart to apply!");
+			}
 
-	// Put shader stage creation info into an array
-	// Graphics pipeline input requires array of of shader stage create info
-	VkPipelineShaderStageCreateInfo shaderStagesCreateInfos[] = { vertexShaderCreateInfo, fragmentShaderCreateInfo };
+			m_shaderStages = shaderStages;
+			m_shaderReflection = reflection;
+			updateShaderFeatures();
+			m_reloadRetiresOld = true;
+			m_graphicsPipelineDesc.shaderStages = shaderStages;
+			m_reloadedPipelineFuture = m_pipelineRegistry.getVariant(m_graphicsPipelineDesc, m_shaderFeatures);
+			m_transparentPipelineDesc.shaderStages = shaderStages;
+			m_reloadedTransparentFuture = m_pipelineRegistry.getVariant(m_transparentPipelineDesc, m_shaderFeatures);
+
+			// Pre-pass must transform vertices exactly like the color pass, so rebuild it too
+			if (m_settings.depthPrePass)
+			{
+				m_depthPrePassDesc.shaderStages = withoutFragmentStage(shaderStages);
+				m_reloadedDepthPrePassFuture = m_pipelineRegistry.getPipeline(m_depthPrePassDesc);
+			}
+		}
+		catch (const std::runtime_error &e)
+		{
+			std::cout << "Shader reload failed: " << e.what() << std::endl;
+		}
+	}
 
+	// Swap only once the builds are done, so draw() never waits on the compiler
+	auto isReady = [](const std::shared_future<VkPipeline> &pipeline) {
+		return !pipeline.valid() || pipeline.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	};
+	if (m_reloadedPipelineFuture.valid() && isReady(m_reloadedPipelineFuture) &&
+		isReady(m_reloadedTransparentFuture) && isReady(m_reloadedDepthPrePassFuture))
+	{
+		try
+		{
+			// Get all before swapping any, so a failed build leaves the old set in use
+			VkPipeline depthPrePassPipeline = m_reloadedDepthPrePassFuture.valid() ? m_reloadedDepthPrePassFuture.get() : m_depthPrePassPipeline;
+			VkPipeline transparentPipeline = m_reloadedTransparentFuture.get();
+			VkPipeline graphicsPipeline = m_reloadedPipelineFuture.get();
+			m_pipelineGeneration++;						// cmd buffers get re-recorded as their images come up
+
+			// Old pipelines of replaced shaders are still in cmd buffers that may be executing: destroy them once those are
+			// re-recorded. A variant switch keeps them cached in the registry, to switch back to without a rebuild
+			if (m_reloadRetiresOld)
+			{
+				retirePipeline(m_graphicsPipeline, graphicsPipeline);
+				retirePipeline(m_transparentPipeline, transparentPipeline);
+				retirePipeline(m_depthPrePassPipeline, depthPrePassPipeline);
+			}
+			m_graphicsPipeline = graphicsPipeline;
+			m_transparentPipeline = transparentPipeline;
+			m_depthPrePassPipeline = depthPrePassPipeline;
+		}
+		catch (const std::runtime_error &e)
+		{
+			std::cout << "Shader reload failed: " << e.what() << std::endl;
+		}
+		m_reloadedPipelineFuture = std::shared_future<VkPipeline>();
+		m_reloadedTransparentFuture = std::shared_future<VkPipeline>();
+		m_reloadedDepthPrePassFuture = std::shared_future<VkPipeline>();
+		m_reloadRetiresOld = false;
+	}
+}
 
-	// CREATE PIPELINE
+void VulkanRenderer::retirePipeline(VkPipeline oldPipeline, VkPipeline newPipeline)
+{
+	// Unchanged shaders give back the very same (shared) pipeline, which must stay
+	if (oldPipeline == VK_NULL_HANDLE || oldPipeline == newPipeline)
+	{
+		return;
+	}
 
-	// How the data for a single vertex	(including pos, tex, normal, color, etc) is as a whole
-	VkVertexInputBindingDescription bindingDescription = {};
-	bindingDescription.binding = 0;									// Can bind multiple streams of data, this defines which one
-	bindingDescription.stride = sizeof(Vertex);						// stride length
-	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;		// How to move b/w data after each vertex?
-																	// VK_VERTEX_INPUT_RATE_VERTEX: Move onto the next vertex
-																	// VK_VERTEX_INPUT_RATE_INSTNACE: Move to a vertex of a next instance.
+	// Take it out of the registry right away, so a later reload to the same code builds a fresh one instead of sharing it
+	if (m_pipelineRegistry.release(oldPipeline))
+	{
+		m_retiredPipelines.push_back({ oldPipeline, m_pipelineGeneration });
+	}
+}
 
-	// how the data of an attribute is defined within a vertex
-	std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions;
+void VulkanRenderer::destroyRetiredPipelines(bool all)
+{
+	// Every image is only re-recorded once its last submission is done (image fence), so once all of them
+	// were recorded at the retiring generation or later no cmd buffer in flight can still use the pipeline
+	uint32_t oldestGeneration = m_pipelineGeneration;
+	for (uint32_t generation : m_recordedGeneration)
+	{
+		oldestGeneration = std::min(oldestGeneration, generation);
+	}
 
-	// Position Attribute
-	attributeDescriptions[0].binding = 0;								// Which binding the data is at( should be same as above)
-	attributeDescriptions[0].location = 0;								// Location in shader where data will be read from
-	attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;		// Format data input will take (also helps define the size of data)
-	attributeDescriptions[0].offset = offsetof(Vertex, a_position);		// Where is ths attribute is defined for a single vertex
+	auto retired = m_retiredPipelines.begin();
+	while (retired != m_retiredPipelines.end())
+	{
+		if (all || retired->generation <= oldestGeneration)
+		{
+			vkDestroyPipeline(m_mainDevice.logicalDevice, retired->pipeline, nullptr);
+			retired = m_retiredPipelines.erase(retired);
+		}
+		else
+		{
+			++retired;
+		}
+	}
+}
 
-	//Color Attrib
-	attributeDescriptions[1].binding = 0;								
-	attributeDescriptions[1].location = 1;								
-	attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;		
-	attributeDescriptions[1].offset = offsetof(Vertex, a_color);		
+void VulkanRenderer::createDescriptorSetLayout()
+{
+	// Set 0 as declared by the shaders: MVP uniform buffer (dynamic) at binding 0 in the vertex stage
+	// Cache hands back the same layout to any other shader declaring identical bindings
+	m_descriptorSetLayout = m_layoutCache.getSetLayout(m_shaderReflection.getSetBindings(0));
+}
 
+VkPipelineLayout VulkanRenderer::getPipelineLayout(const ShaderReflection &reflection)
+{
+	// Without bindless: exactly what the shaders declare
+	if (!m_bindless)
+	{
+		return m_layoutCache.getPipelineLayout(reflection);
+	}
 
-	/** -- VERTEX INPUT -- **/
-	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
-	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-	vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;						// List of vertex binding description (data spacing, stride info, etc)
-	vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();				// List of vertex attribute description (data format and where to find to/from)
+	// Bindless: reflected sets below k_bindlessSet, the global bindless set, and DrawIndices as push constants.
+	// Every pipeline gets this same interface, so the sets and draw indices stay bound across pipeline switches
+	const std::vector<VkDescriptorSetLayoutBinding> &bindlessBindings = m_bindlessDescriptors.getSetBindings();
+	for (const auto &descriptorSet : reflection.descriptorSets)
+	{
+		if (descriptorSet.set > k_bindlessSet)
+		{
+			throw std::runtime_error("Failed to match SHADER descriptor sets with the bindless layout!");
+		}
+		if (descriptorSet.set != k_bindlessSet)
+		{
+			continue;
+		}
 
+		// The global set isn't built from reflection, so each declared binding must exist in it with the same type,
+		// and a sized array must fit (unsized arrays reflect a count of 0)
+		for (const auto &binding : descriptorSet.bindings)
+		{
+			auto bindlessIt = std::find_if(bindlessBindings.begin(), bindlessBindings.end(),
+				[&binding](const VkDescriptorSetLayoutBinding &bindlessBinding) { return bindlessBinding.binding == binding.binding; });
+			if (bindlessIt == bindlessBindings.end() || bindlessIt->descriptorType != binding.descriptorType
+				|| binding.descriptorCount > bindlessIt->descriptorCount)
+			{
+				throw std::runtime_error("Failed to match SHADER descriptor sets with the bindless layout!");
+			}
+		}
+	}
+	for (const auto &range : reflection.pushConstantRanges)
+	{
+		if (range.offset + range.size > sizeof(DrawIndices))
+		{
+			throw std::runtime_error("Failed to match SHADER push constants with DrawIndices!");
+		}
+	}
 
-	/** -- INPUT ASSEMBLY -- **/
-	VkPipelineInputAssemblyStateCreateInfo inputAssembleCreateInfo = {};
-	inputAssembleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembleCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;		// Primitive Type to assemble vertices as
-	inputAssembleCreateInfo.primitiveRestartEnable = VK_FALSE;					// allow overriding of strip topology to start new primitive
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	for (uint32_t set = 0; set < k_bindlessSet; set++)
+	{
+		setLayouts.push_back(m_layoutCache.getSetLayout(reflection.getSetBindings(set)));
+	}
+	setLayouts.push_back(m_bindlessDescriptors.getSetLayout());
 
+	VkPushConstantRange drawIndicesRange = {};
+	drawIndicesRange.stageFlags = m_drawIndicesStages;
+	drawIndicesRange.offset = 0;
+	drawIndicesRange.size = sizeof(DrawIndices);
 
-	/** -- VIEWPORT AND SCISSOR-- **/
-	// Create a viewport info struct
-	VkViewport viewport = {};
-	viewport.x = 0.0f;													// x start coord
-	viewport.y = 0.0f;													// y start coord
-	viewport.width = static_cast<float>(m_swapchainExtent.width);		// viewport width
-	viewport.height = static_cast<float>(m_swapchainExtent.height);		// viewport height
-	viewport.minDepth = 0.0f;											// min viewport depth
-	viewport.maxDepth = 1.0f;											// max viewport depth
-
-	// Create a Scissor info struct
-	VkRect2D scissor = {};
-	scissor.offset = { 0, 0 };									// Offset to use region from
-	scissor.extent = m_swapchainExtent;									// Extent to describe region to use, starting at offset
-			// -> scissor giving visible area
+	return m_layoutCache.getPipelineLayout(setLayouts, { drawIndicesRange });
+}
 
-	// create viewport state
-	VkPipelineViewportStateCreateInfo viewportCreateInfo = {};
-	viewportCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportCreateInfo.viewportCount = 1;
-	viewportCreateInfo.pViewports = &viewport;
-	viewportCreateInfo.scissorCount = 1;
-	viewportCreateInfo.pScissors = &scissor;
+void VulkanRenderer::createGraphicsPipeline()
+{
+	// Description of the pipeline; owns all its data, so it can be built on a worker thread
+	PipelineDesc pipelineDesc;
 
+	/** -- SHADER STAGES -- **/
+	pipelineDesc.shaderStages = m_shaderStages;
 
-	/** -- DYNAMIC STATES -- **/
-	// Dynamic states to ENABLE
-	/*std::vector<VkDynamicState> dynamicStateEnables;
-	dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT);	// Dynamic viewport: we can resize in cmd buffer w/ vkCmdSetViewport(cmdbuffer, whichViewport=0 , howmanyToSet=1, reftoViewportType=viewport) 
-	dynamicStateEnables.push_back(VK_DYNAMIC_STATE_SCISSOR);	// Dynamic scissor: we can resize in cmd buffer w/ vkCmdSetScissor(cmdbuffer, whichScissor=0 , howmanyToSet=1, reftoScissorType=scissor)
 
+	/** -- VERTEX INPUT -- **/
+	// Attributes come from the vertex shader's inputs (location order, tightly packed).
+	// Mesh shaders fetch their own vertices (storage buffer): no vertex input at all
+	if (m_meshletPath != MeshletPath::MeshShader)
+	{
+		if (m_shaderReflection.vertexStride != sizeof(Vertex))
+		{
+			throw std::runtime_error("Failed to match VERTEX struct with the vertex shader inputs!");
+		}
 
-	// Dynamic state creation info
-	VkPipelineDynamicStateCreateInfo dynStateCreateInfo = {};
-	dynStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	dynStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
-	dynStateCreateInfo.pDynamicStates = dynamicStateEnables.data();//*/
+		// How the data for a single vertex	(including pos, tex, normal, color, etc) is as a whole
+		VkVertexInputBindingDescription bindingDescription = {};
+		bindingDescription.binding = 0;									// Can bind multiple streams of data, this defines which one
+		bindingDescription.stride = m_shaderReflection.vertexStride;	// stride length
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;		// How to move b/w data after each vertex?
+																		// VK_VERTEX_INPUT_RATE_VERTEX: Move onto the next vertex
+																		// VK_VERTEX_INPUT_RATE_INSTNACE: Move to a vertex of a next instance.
+
+		pipelineDesc.vertexBindings.push_back(bindingDescription);
+		pipelineDesc.vertexAttributes = m_shaderReflection.vertexAttributes;	// location 0: a_position, location 1: a_color
+
+		// Compact vertices: same inputs read from CompactVertex, the normalized formats arrive in the shader as floats
+		if (m_settings.compactVertices)
+		{
+			if (pipelineDesc.vertexAttributes.size() != 2)
+			{
+				throw std::runtime_error("Failed to match COMPACT VERTEX struct with the vertex shader inputs!");
+			}
+			pipelineDesc.vertexBindings[0].stride = sizeof(CompactVertex);
+			for (auto &attribute : pipelineDesc.vertexAttributes)
+			{
+				attribute.format = attribute.location == 0 ? VK_FORMAT_R16G16B16A16_SNORM : VK_FORMAT_R8G8B8A8_UNORM;
+				attribute.offset = attribute.location == 0 ? offsetof(CompactVertex, a_position) : offsetof(CompactVertex, a_color);
+			}
+		}
+	}
+
+	/** -- INPUT ASSEMBLY -- **/
+	pipelineDesc.topology = m_dynamicState.topology;					// Primitive Type to assemble vertices as
+
+	/** -- VIEWPORT AND SCISSOR-- **/
+	pipelineDesc.viewportExtent = m_swapchainExtent;					// Viewport and scissor both cover the whole swapchain image (ignored: both are dynamic)
 
 
 	/** -- RASTERIZER -- **/
-	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
-	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizerCreateInfo.depthBiasClamp = VK_FALSE;				// Change if frag beyond near/far plane are clipped (default) or clamped to plane
-	rasterizerCreateInfo.rasterizerDiscardEnable = VK_FALSE;	// Whether to skip rasterizer. Never creates fragments, only suitable for pipeline w/o a FB output
-	rasterizerCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;	// How to handle filling frags between vertices. e.g. Render only vertex, edges or fill the triangle (our curr primitive)
-	rasterizerCreateInfo.lineWidth = 1.0f;						// How thick a line should be when drawn, needs a gpu extension if value other than 1.0f
-	rasterizerCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;		// Which side of a tri to cull. Cull back facing polygon
-	rasterizerCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;	// Winding to determine which side is front
-	rasterizerCreateInfo.depthBiasEnable = VK_FALSE;			// Whether to add Depthbias to fragments (good for handling Shadow Acne). DepthBias can be defined as a part of pipeline.
+	pipelineDesc.polygonMode = VK_POLYGON_MODE_FILL;					// How to handle filling frags between vertices. e.g. Render only vertex, edges or fill the triangle (our curr primitive)
+	pipelineDesc.cullMode = m_dynamicState.cullMode;					// Which side of a tri to cull. Cull back facing polygon
+	pipelineDesc.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;			// Winding to determine which side is front
+
+
+	/** -- DYNAMIC STATES -- **/
+	// Set in the cmd buffer (setDynamicState) instead of baked in, so resizing the window or
+	// changing these doesn't need a new pipeline
+	pipelineDesc.dynamicStates.push_back(VK_DYNAMIC_STATE_VIEWPORT);					// vkCmdSetViewport
+	pipelineDesc.dynamicStates.push_back(VK_DYNAMIC_STATE_SCISSOR);						// vkCmdSetScissor
+	if (m_extendedDynamicState)
+	{
+		pipelineDesc.dynamicStates.push_back(VK_DYNAMIC_STATE_CULL_MODE);				// vkCmdSetCullMode
+		pipelineDesc.dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE);		// vkCmdSetDepthTestEnable
+		if (m_meshletPath != MeshletPath::MeshShader)
+		{
+			pipelineDesc.dynamicStates.push_back(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY);	// vkCmdSetPrimitiveTopology (same topology class only; not with mesh shaders)
+		}
+	}
 
 
 	/** -- MULTISAMPLING (for anti-aliasing) -- **/
-	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo = {};
-	multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampleCreateInfo.sampleShadingEnable = VK_FALSE;				// Enable multisampling shading or not. r.n we are disabling it
-	multisampleCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;	// Num of samples to use per fragment
+	pipelineDesc.rasterizationSamples = m_msaaSamples;					// Num of samples to use per fragment (must match the attachments)
 
 
 	/** -- BLENDING -- **/
 	// Blending decides how to blend a new color being written to a fragment with the old value
+	// Opaque meshes overwrite it: no blending, so the old value never has to be read back
 
 	// Blend Attachment state (how blending is handled)
-	VkPipelineColorBlendAttachmentState colorStateAttachments = {};
+	VkPipelineColorBlendAttachmentState &colorStateAttachments = pipelineDesc.colorBlend;
 	colorStateAttachments.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
-							| VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;		// colors to apply blending to
-	colorStateAttachments.blendEnable = VK_TRUE;													// enable blending
+							| VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;		// colors to write
+	colorStateAttachments.blendEnable = VK_FALSE;													// disable blending
 
-	// Blending uses following equation: (srcColorBlendFactor * new_color) colorBlendOp (dstColorBlendFactor * old_color);
-	colorStateAttachments.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-	colorStateAttachments.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-	colorStateAttachments.colorBlendOp		   = VK_BLEND_OP_ADD;
-	// Summarize: (VK_BLEND_FACTOR_SRC_ALPHA * new_color) + (VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA * old_color)
-	//				  ===   (new_color_alpha * new_color) + ((1 - new_color_alpha) * old_color)
-
-	colorStateAttachments.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorStateAttachments.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorStateAttachments.alphaBlendOp = VK_BLEND_OP_ADD;
-	// Summarize: (1 * new_alpha)  + (0 * old_alpha) === new_alpha
-
-
-	VkPipelineColorBlendStateCreateInfo colorBlendingCreateInfo = {};
-	colorBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlendingCreateInfo.logicOpEnable = VK_FALSE;			// Alternative to calc is to use logical ops
-	colorBlendingCreateInfo.attachmentCount = 1;
-	colorBlendingCreateInfo.pAttachments = &colorStateAttachments;
-
-
-	/** -- PIPELINE LAYOUT (ToDo: Apply Future Descriptor Set Layouts) -- **/
-	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
-	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutCreateInfo.setLayoutCount = 1;
-	pipelineLayoutCreateInfo.pSetLayouts = &m_descriptorSetLayout;		// Attach descriptor set layout
-	pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-	pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
-
-	// Create pipeline layout
-	VkResult result = vkCreatePipelineLayout(m_mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout);
-	if(result != VK_SUCCESS)
+
+	/** -- PIPELINE LAYOUT -- **/
+	// Built from the reflected sets and push constants; set 0 is m_descriptorSetLayout (same cached layout)
+	// DrawIndices go to every stage that runs per draw with bindless, else to whichever stages declare them (meshlet.task)
+	if (m_bindless)
+	{
+		m_drawIndicesStages = (m_meshletPath == MeshletPath::MeshShader ? VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT
+			: VK_SHADER_STAGE_VERTEX_BIT) | VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+	else
 	{
-		throw std::runtime_error("Failed to create PIPELINE_LAYOUT");
+		m_drawIndicesStages = 0;
+		for (const auto &range : m_shaderReflection.pushConstantRanges)
+		{
+			m_drawIndicesStages |= range.stageFlags;
+		}
 	}
+	m_pipelineLayout = getPipelineLayout(m_shaderReflection);
 
 	
-	/** -- DEPTH STENSIL TESETING -- **/
-	// ToDo: Set up depth stensil testing: We need to learn about images, buffers, and device memory.
-
+	/** -- DEPTH STENCIL TESTING -- **/
+	// Fragment shader neither writes depth nor discards, so the test runs before shading (early-Z)
+	pipelineDesc.depthTestEnable = m_dynamicState.depthTestEnable;		// Compare fragment depth against the depth buffer
+	if (m_settings.depthPrePass)
+	{
+		// Depth is already final after the pre-pass: only the nearest fragment passes and nothing needs writing
+		pipelineDesc.depthWriteEnable = VK_FALSE;
+		pipelineDesc.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	}
+	else
+	{
+		pipelineDesc.depthWriteEnable = VK_TRUE;
+		pipelineDesc.depthCompareOp = VK_COMPARE_OP_LESS;
+	}
 
 
 	/** --GRAPHICS PIPELINE CREATION -- **/
-	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
-	graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	graphicsPipelineCreateInfo.stageCount = 2;									// Number of shader stages: Vert and frag shaders
-	graphicsPipelineCreateInfo.pStages = shaderStagesCreateInfos;				// List of shader stages
-	graphicsPipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;		// All the fixed function pipeline states
-	graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssembleCreateInfo;
-	graphicsPipelineCreateInfo.pViewportState = &viewportCreateInfo;
-	graphicsPipelineCreateInfo.pDynamicState = nullptr;
-	graphicsPipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
-	graphicsPipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
-	graphicsPipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;
-	graphicsPipelineCreateInfo.pDepthStencilState = nullptr;
-	graphicsPipelineCreateInfo.layout = m_pipelineLayout;						// Pipeline layout the pipeline should use
-	graphicsPipelineCreateInfo.renderPass = m_renderPass;						// render pass description the pipeline is compatible with
-	graphicsPipelineCreateInfo.subpass = 0;										// subpass of render pass  to use with pipeline
-
-	// Pipeline derivatives can create multiple pipeline that derives from one another for opitimisation
-	graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;			// Exiting pipeline derived from; Useful when creating multiple pipeline, we can create a base pipeline and change only the required details
-	graphicsPipelineCreateInfo.basePipelineIndex = -1;						// or index of pipeline being created to derived from (in case creating multiple at once)
-
-	// Create Graphics pipeline
-	// VkPipelineCache == VK_NULL_HANDLE, we can create a cache to recreate pipeline 
-	result = vkCreateGraphicsPipelines(m_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, 
-										&graphicsPipelineCreateInfo, nullptr, &m_graphicsPipeline);
-	if (result != VK_SUCCESS)
+	pipelineDesc.layout = m_pipelineLayout;								// Pipeline layout the pipeline should use
+	pipelineDesc.renderPass = m_renderPass;								// render pass description the pipeline is compatible with
+	pipelineDesc.subpass = m_colorSubpass;								// subpass of render pass  to use with pipeline
+
+	/** -- DEPTH PRE-PASS PIPELINE -- **/
+	// Same vertex input and transform (or task and mesh shader), no fragment shader and no color attachment: only writes depth
+	if (m_settings.depthPrePass)
 	{
-		throw std::runtime_error("Failed to create a GRAPHICS_PIPELINE");
+		m_depthPrePassDesc = pipelineDesc;
+		m_depthPrePassDesc.shaderStages = withoutFragmentStage(m_shaderStages);
+		m_depthPrePassDesc.colorAttachmentCount = 0;
+		m_depthPrePassDesc.depthWriteEnable = VK_TRUE;
+		m_depthPrePassDesc.depthCompareOp = VK_COMPARE_OP_LESS;
+		m_depthPrePassDesc.subpass = 0;
+		m_depthPrePassPipelineFuture = m_pipelineRegistry.getPipeline(m_depthPrePassDesc);	// No fragment stage: no shader features
 	}
-	// DESTROY shader modules, no longer needed after pipeline
-	vkDestroyShaderModule(m_mainDevice.logicalDevice, fragmentShaderModule, nullptr);
-	vkDestroyShaderModule(m_mainDevice.logicalDevice, vertexShaderModule, nullptr);
+
+	/** -- TRANSPARENT PIPELINE -- **/
+	// Transparent meshes are drawn after the opaque ones, back to front, tested against but not writing depth.
+	// shader.frag always outputs alpha 1, so a mesh's opacity comes in as the blend constant (set per draw)
+	m_transparentPipelineDesc = pipelineDesc;
+	m_transparentPipelineDesc.depthWriteEnable = VK_FALSE;
+	m_transparentPipelineDesc.dynamicStates.push_back(VK_DYNAMIC_STATE_BLEND_CONSTANTS);		// vkCmdSetBlendConstants
+
+	VkPipelineColorBlendAttachmentState &transparentBlend = m_transparentPipelineDesc.colorBlend;
+	transparentBlend.blendEnable = VK_TRUE;														// enable blending
+
+	// Blending uses following equation: (srcColorBlendFactor * new_color) colorBlendOp (dstColorBlendFactor * old_color);
+	transparentBlend.srcColorBlendFactor = VK_BLEND_FACTOR_CONSTANT_ALPHA;
+	transparentBlend.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_CONSTANT_ALPHA;
+	transparentBlend.colorBlendOp		  = VK_BLEND_OP_ADD;
+	// Summarize: (opacity * new_color) + ((1 - opacity) * old_color)
+
+	transparentBlend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	transparentBlend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	transparentBlend.alphaBlendOp = VK_BLEND_OP_ADD;
+	// Summarize: (0 * new_alpha)  + (1 * old_alpha) === old_alpha
+	m_transparentPipelineFuture = m_pipelineRegistry.getVariant(m_transparentPipelineDesc, m_shaderFeatures);
+
+	// Get the pipeline variant for the current shader features from the registry: identical state
+	// is shared, new state is queued on the compiler's worker threads; rest of init() carries on
+	// while it compiles and we only wait for it when recording commands
+	m_graphicsPipelineDesc = pipelineDesc;
+	m_graphicsPipelineFuture = m_pipelineRegistry.getVariant(pipelineDesc, m_shaderFeatures);
+}
+
+void VulkanRenderer::createMeshletCullPipeline()
+{
+	// Own layout (set 0: cull params, meshlets, draws, counts; MeshletCullConstants), nothing shared with the graphics pipelines
+	m_meshletCullSetLayout = m_layoutCache.getSetLayout(m_meshletCullReflection.getSetBindings(0));
+	m_meshletCullPipelineLayout = m_layoutCache.getPipelineLayout(m_meshletCullReflection);
+
+	// Compacted draws only if the device can read their count
+	uint32_t constantId;
+	if (m_meshletCullReflection.findSpecConstant("k_compactDraws", constantId))
+	{
+		m_meshletCullStage.specialization.set(constantId, m_drawIndirectCount);
+	}
+	m_meshletCullPipeline = m_pipelineCompiler.buildComputePipeline(m_meshletCullStage, m_meshletCullPipelineLayout);
 }
 
 void VulkanRenderer::createFramebuffers()
@@ -728,10 +1297,16 @@ void VulkanRenderer::createFramebuffers()
 	// Create a framebuffer for each swapchain image
 	for(size_t i = 0; i < m_swapchainFramebuffers.size(); i++)
 	{
-		// We will be having multiple attachments like depth
-		std::array<VkImageView, 1> attachments = {
-			m_swapchainImages[i].imageView
-		};
+		// Same order as the render pass attachments: with MSAA the swapchain image is the resolve target
+		std::vector<VkImageView> attachments;
+		if (m_msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+		{
+			attachments = { m_colorBufferImageViews[i], m_depthBufferImageViews[i], m_swapchainImages[i].imageView };
+		}
+		else
+		{
+			attachments = { m_swapchainImages[i].imageView, m_depthBufferImageViews[i] };
+		}
 
 		VkFramebufferCreateInfo framebufferCreateInfo = {};
 		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -758,6 +1333,7 @@ void VulkanRenderer::createCommandPool()
 
 	VkCommandPoolCreateInfo poolCreateInfo = {};
 	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;	// Buffers can be re-recorded one by one (shader hot reload)
 	poolCreateInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;		// Queue family type that buffer from this cmd pool will use
 
 	// Create a Graphics Queue family cmd pool
@@ -766,6 +1342,17 @@ void VulkanRenderer::createCommandPool()
 	{
 		throw std::runtime_error("Failed to create a COMMAND POOL!");
 	}
+
+	// One more per swapchain image for its cmd buffer, so all of them can be recorded at the same time
+	m_recordCmdPools.resize(m_swapchainImages.size());
+	for (auto &pool : m_recordCmdPools)
+	{
+		result = vkCreateCommandPool(m_mainDevice.logicalDevice, &poolCreateInfo, nullptr, &pool);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a COMMAND POOL!");
+		}
+	}
 }
 
 void VulkanRenderer::createCommandBuffers()
@@ -778,17 +1365,20 @@ void VulkanRenderer::createCommandBuffers()
 	// allocating not creating! Cmd buffer already exists. Memory is already there
 	VkCommandBufferAllocateInfo commandBufferAllcInfo = {};
 	commandBufferAllcInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;	
-	commandBufferAllcInfo.commandPool = m_graphicsCmdPool;							//
 	commandBufferAllcInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;					// PRIMARY  : Buffers you submit directly to queue. Can't be called by other buffers
 																			// SECONDARY: Buffers can't be called directly. Can be called by another buffer via
 																			//			  vkCmdExecuteCommand(buffer) when recording commands in primary buffer
-	commandBufferAllcInfo.commandBufferCount = static_cast<uint32_t>(m_commandBuffers.size());		// Size of cmd buffers we are creating
+	commandBufferAllcInfo.commandBufferCount = 1;									// Each from its own pool
 
 	// Allocate Command buffers and places handles in array of buffers
-	VkResult result = vkAllocateCommandBuffers(m_mainDevice.logicalDevice, &commandBufferAllcInfo, m_commandBuffers.data());
-	if (result != VK_SUCCESS)
+	for (size_t i = 0; i < m_commandBuffers.size(); i++)
 	{
-		throw std::runtime_error("Failed to allocate COMMAND BUFFERS!");
+		commandBufferAllcInfo.commandPool = m_recordCmdPools[i];
+		VkResult result = vkAllocateCommandBuffers(m_mainDevice.logicalDevice, &commandBufferAllcInfo, &m_commandBuffers[i]);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate COMMAND BUFFERS!");
+		}
 	}
 
 	// NOTE: Since its vkALLOCATEcommandBuffers, we are not creating it, hence we don't need to destroy it
@@ -799,6 +1389,7 @@ void VulkanRenderer::createSynchronization()
 	m_semaphoreImageAvailable.resize(MAX_FRAME_DRAWS);
 	m_semaphoreRenderFinished.resize(MAX_FRAME_DRAWS);
 	m_drawFences.resize(MAX_FRAME_DRAWS);
+	m_imageFences.assign(m_swapchainImages.size(), VK_NULL_HANDLE);		// No image in use yet
 
 	// Semaphore creation information
 	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
@@ -822,8 +1413,9 @@ void VulkanRenderer::createSynchronization()
 
 void VulkanRenderer::createUniformBuffers()
 {
-	// Buffer size  will be the size of all three vars (will offset to access
-	VkDeviceSize bufferSize = sizeof(MVP);
+	// An MVP per mesh, each starting at an offset any device can bind a uniform buffer at
+	static_assert(sizeof(MVP) <= k_mvpStride, "MVP must fit in its slot of the uniform buffer");
+	VkDeviceSize bufferSize = k_mvpStride * std::max<size_t>(meshList.size(), 1);
 
 	// NOTE: need to make host visible, since we will be updating model matrix regularly
 
@@ -831,100 +1423,303 @@ void VulkanRenderer::createUniformBuffers()
 	m_uniformBuffer.resize(m_swapchainImages.size());
 	m_uniformBufferMemory.resize(m_swapchainImages.size());
 
+	// With bindless the same buffers are also in the global storage buffer array
+	VkBufferUsageFlags bufferUsage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	if (m_bindless)
+	{
+		bufferUsage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		m_uniformBufferBindlessIndices.resize(m_swapchainImages.size());
+	}
+
 	// create the uniform buffer
 	for (size_t i = 0; i < m_swapchainImages.size(); i++) {
 		createBuffer(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, bufferSize,
-					 VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
+					 bufferUsage, 
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			&m_uniformBuffer[i], &m_uniformBufferMemory[i]);
+
+		if (m_bindless)
+		{
+			m_uniformBufferBindlessIndices[i] = m_bindlessDescriptors.addStorageBuffer(m_uniformBuffer[i]);
+		}
 	}
 
 
 
 }
 
-void VulkanRenderer::createDescriptorPool()
+void VulkanRenderer::createMeshletBuffers()
 {
-	// Type of descriptors + how many descriptors and not DESCRIPTOR SETS (combined makes the pool size)
-	VkDescriptorPoolSize poolsize = {};
-	poolsize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolsize.descriptorCount = static_cast<uint32_t>(m_uniformBuffer.size());
+	if (m_meshletPath == MeshletPath::None)
+	{
+		return;
+	}
 
+	// Cull params change every frame like the MVPs: host visible, one per image
+	VkDeviceSize cullBufferSize = sizeof(MeshletCullHeader) + sizeof(MeshletCullObject) * std::max<size_t>(meshList.size(), 1);
+	m_meshletCullBuffers.resize(m_swapchainImages.size());
+	m_meshletCullBufferMemory.resize(m_swapchainImages.size());
+	for (size_t i = 0; i < m_swapchainImages.size(); i++)
+	{
+		createBuffer(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, cullBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&m_meshletCullBuffers[i], &m_meshletCullBufferMemory[i]);
+	}
 
+	if (m_meshletPath != MeshletPath::Compute)
+	{
+		return;
+	}
 
-	// Data to create descriptor pool
-	VkDescriptorPoolCreateInfo poolCreateInfo = {};
-	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolCreateInfo.maxSets = static_cast<uint32_t>(m_uniformBuffer.size());		// Max number of DesSets that can be created from pool
-	poolCreateInfo.poolSizeCount = 1;											// Amt of pool sizes being passed
-	poolCreateInfo.pPoolSizes = &poolsize;										// Pool sizes to create pool with
+	// Room for every meshlet of every mesh to be visible; the GPU alone writes them
+	uint32_t drawCommandCount = 0;
+	m_firstDrawCommand.resize(meshList.size());
+	for (size_t i = 0; i < meshList.size(); i++)
+	{
+		m_firstDrawCommand[i] = drawCommandCount;
+		drawCommandCount += meshList[i].getMeshletCount();
+	}
 
-	// Create Descriptor Pool
-	VkResult result = vkCreateDescriptorPool(m_mainDevice.logicalDevice, &poolCreateInfo, nullptr, &m_descriptorPool);
-	if (result != VK_SUCCESS)
+	m_drawCommandBuffers.resize(m_swapchainImages.size());
+	m_drawCommandBufferMemory.resize(m_swapchainImages.size());
+	m_drawCountBuffers.resize(m_swapchainImages.size());
+	m_drawCountBufferMemory.resize(m_swapchainImages.size());
+	for (size_t i = 0; i < m_swapchainImages.size(); i++)
 	{
-		throw std::runtime_error("Failed to create a DESCRIPTOR POOL!");
+		createBuffer(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice,
+			sizeof(VkDrawIndexedIndirectCommand) * std::max<uint32_t>(drawCommandCount, 1),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&m_drawCommandBuffers[i], &m_drawCommandBufferMemory[i]);
+		createBuffer(m_mainDevice.physicalDevice, m_mainDevice.logicalDevice, sizeof(uint32_t) * std::max<size_t>(meshList.size(), 1),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_drawCountBuffers[i], &m_drawCountBufferMemory[i]);
 	}
+}
 
+void VulkanRenderer::createDescriptorPool()
+{
+	// Descriptors of each type a pool holds per set; pools are added as sets run out
+	std::vector<DescriptorPoolRatio> ratios = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,		 m_meshletPath != MeshletPath::None ? 4.0f : 1.0f },	// Meshlet sets bind 4 each
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f },
+	};
 
+	// Long lived sets: start with room for one set per image (per mesh and image with mesh shaders)
+	size_t setsPerImage = m_meshletPath == MeshletPath::MeshShader ? std::max<size_t>(meshList.size(), 1) : 1;
+	m_descriptorAllocator.init(m_mainDevice.logicalDevice, static_cast<uint32_t>(m_uniformBuffer.size() * setsPerImage), ratios);
+	m_descriptorSetCache.init(m_mainDevice.logicalDevice, &m_descriptorAllocator);
 }
 
 void VulkanRenderer::createDescriptorSets()
 {
-	// Resize descriptor set list  -- one for every buffer
-	m_descriptorSets.resize(m_uniformBuffer.size());
+	// Resize descriptor set list  -- one for every buffer (none if the shaders don't use set 0, e.g. bindless vertex shader)
+	m_descriptorSets.resize(m_shaderReflection.getSetBindings(0).empty() ? 0 : m_uniformBuffer.size());
 
-	std::vector<VkDescriptorSetLayout> setLayouts(m_uniformBuffer.size(), m_descriptorSetLayout);
+	// Binding 0 (must match with bindingId in shader) sees one MVP of the image's buffer; the dynamic offset bound with
+	// the set moves it to the mesh's. The cache writes a new set with one template update
+	for (size_t i = 0; i < m_descriptorSets.size(); i++)
+	{
+		DescriptorBinding mvpBinding = DescriptorBinding::buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, m_uniformBuffer[i], 0, sizeof(MVP));
+		if (m_meshletPath != MeshletPath::MeshShader)
+		{
+			m_descriptorSets[i] = m_descriptorSetCache.getSet(m_descriptorSetLayout, { mvpBinding });
+			continue;
+		}
 
-	// Descriptor set allocation info
-	VkDescriptorSetAllocateInfo setAllocInfo = {};
-	setAllocInfo.sType			= VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	setAllocInfo.descriptorPool = m_descriptorPool;										// Pool to allc DS from
-	setAllocInfo.descriptorSetCount = static_cast<uint32_t>(m_uniformBuffer.size());	// #sets to alloc
-	setAllocInfo.pSetLayouts	= setLayouts.data();									// Layout to use to allocate sets (1:1 Relationship)
+		// Mesh shaders: also the cull params (task), the mesh's meshlets (both) and its meshlet data and vertices (mesh),
+		// which differ per mesh
+		m_meshShaderSets.resize(m_uniformBuffer.size());
+		m_meshShaderSets[i].resize(meshList.size());
+		for (size_t meshIndex = 0; meshIndex < meshList.size(); meshIndex++)
+		{
+			Mesh &mesh = meshList[meshIndex];
+			m_meshShaderSets[i][meshIndex] = m_descriptorSetCache.getSet(m_descriptorSetLayout, {
+				mvpBinding,
+				DescriptorBinding::buffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_meshletCullBuffers[i], 0, VK_WHOLE_SIZE),
+				DescriptorBinding::buffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, mesh.getMeshletBuffer(), 0, VK_WHOLE_SIZE),
+				DescriptorBinding::buffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, mesh.getMeshletDataBuffer(), 0, VK_WHOLE_SIZE),
+				DescriptorBinding::buffer(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, mesh.getVertexBuffer(), 0, VK_WHOLE_SIZE)
+			});
+		}
+	}
 
-	// Allocate DS
-	VkResult result = vkAllocateDescriptorSets(m_mainDevice.logicalDevice, &setAllocInfo, m_descriptorSets.data());
+	// Cull pass: a set per image and mesh, binding the image's cull params, draws and counts with the mesh's meshlets
+	if (m_meshletPath == MeshletPath::Compute)
+	{
+		m_meshletCullSets.resize(m_uniformBuffer.size());
+		for (size_t i = 0; i < m_uniformBuffer.size(); i++)
+		{
+			m_meshletCullSets[i].resize(meshList.size());
+			for (size_t meshIndex = 0; meshIndex < meshList.size(); meshIndex++)
+			{
+				m_meshletCullSets[i][meshIndex] = m_descriptorSetCache.getSet(m_meshletCullSetLayout, {
+					DescriptorBinding::buffer(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_meshletCullBuffers[i], 0, VK_WHOLE_SIZE),
+					DescriptorBinding::buffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshList[meshIndex].getMeshletBuffer(), 0, VK_WHOLE_SIZE),
+					DescriptorBinding::buffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_drawCommandBuffers[i], 0, VK_WHOLE_SIZE),
+					DescriptorBinding::buffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_drawCountBuffers[i], 0, VK_WHOLE_SIZE)
+				});
+			}
+		}
+	}
+}
 
-	if (result != VK_SUCCESS)
+void VulkanRenderer::createTimestampQueryPool()
+{
+	// Not every queue can write timestamps; without them the benchmark just reports 0
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(m_mainDevice.physicalDevice, &deviceProperties);
+	if (!deviceProperties.limits.timestampComputeAndGraphics || deviceProperties.limits.timestampPeriod <= 0.0f)
 	{
-		throw std::runtime_error("Failed to Allocate a DESCRIPTOR SETS!");
+		return;
 	}
+	m_timestampPeriod = deviceProperties.limits.timestampPeriod;
 
-	// Update all of our DS buffer bindings
-	for(size_t i = 0; i < m_uniformBuffer.size(); i++)
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = static_cast<uint32_t>(m_commandBuffers.size() * 2);	// Start and end of each cmd buffer
+
+	VkResult result = vkCreateQueryPool(m_mainDevice.logicalDevice, &queryPoolCreateInfo, nullptr, &m_timestampQueryPool);
+	if (result != VK_SUCCESS)
 	{
-		// Create buffer info and data offset info
-		VkDescriptorBufferInfo mvpBufferInfo = {};
-		mvpBufferInfo.buffer = m_uniformBuffer[i];		// Buffer to get data from
-		mvpBufferInfo.offset = 0;						// Position of start of data
-		mvpBufferInfo.range	 = sizeof(MVP);				// Size of data
+		throw std::runtime_error("Failed to create a TIMESTAMP QUERY POOL!");
+	}
 
+	m_timestampsPending.assign(m_commandBuffers.size(), false);
+}
 
-		// Data about connection b/w binding and buffer
-		VkWriteDescriptorSet mvpSetWrite = {};
-		mvpSetWrite.sType		= VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		mvpSetWrite.dstSet		= m_descriptorSets[i];						// DS to update
-		mvpSetWrite.dstBinding  = 0;										// Binding to update: Must match with bindingId in shader
-		mvpSetWrite.dstArrayElement = 0;									// Index in array to update
-		mvpSetWrite.descriptorType	= VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;	// Type of Descriptor (must match with  m_descriptorSets[i])
-		mvpSetWrite.descriptorCount = 1;									// Amount to update
-		mvpSetWrite.pBufferInfo		= &mvpBufferInfo;						// Infor about buffer data to bind
+void VulkanRenderer::readTimestamps(uint32_t imageIndex)
+{
+	if (m_timestampQueryPool == VK_NULL_HANDLE || !m_timestampsPending[imageIndex])
+	{
+		return;
+	}
+	m_timestampsPending[imageIndex] = false;
 
-		// Update the DS w/ new buffer binding info
-		vkUpdateDescriptorSets(m_mainDevice.logicalDevice, 1, &mvpSetWrite, 0, nullptr);
+	// Image's fence has signalled, so this doesn't need to wait
+	uint64_t timestamps[2];
+	VkResult result = vkGetQueryPoolResults(m_mainDevice.logicalDevice, m_timestampQueryPool, imageIndex * 2, 2,
+		sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS)
+	{
+		return;
 	}
+
+	m_gpuTimeTotal += static_cast<double>(timestamps[1] - timestamps[0]) * m_timestampPeriod / 1e6;	// ticks -> ns -> ms
+	m_gpuTimeFrames++;
 }
 
 void VulkanRenderer::UpdateUniformBuffer(uint32_t imageIdx)
 {
+	// Model of each mesh: its world transform, after undoing the vertex quantization (identity for float vertices)
 	void *data;
-	vkMapMemory(m_mainDevice.logicalDevice, m_uniformBufferMemory[imageIdx], 0, sizeof(MVP), 0, &data);
-	memcpy(data, &m_mvp, sizeof(MVP));
+	vkMapMemory(m_mainDevice.logicalDevice, m_uniformBufferMemory[imageIdx], 0, VK_WHOLE_SIZE, 0, &data);
+	for (size_t i = 0; i < meshList.size(); i++)
+	{
+		MVP mvp = m_mvp;
+		mvp.model = m_scene.getWorldTransform(m_meshNodes[i]) * meshList[i].getDequantizeMatrix();
+		memcpy(static_cast<char *>(data) + i * k_mvpStride, &mvp, sizeof(MVP));
+	}
 	vkUnmapMemory(m_mainDevice.logicalDevice, m_uniformBufferMemory[imageIdx]);
+
+	// Meshlet culling: the same camera and world transforms. Cones only apply while back faces are culled (front is CCW)
+	if (m_meshletPath != MeshletPath::None)
+	{
+		MeshletCullHeader header;
+		Frustum frustum = makeFrustum(m_mvp.projection * m_mvp.view);
+		for (int plane = 0; plane < Frustum::PlaneCount; plane++)
+		{
+			header.frustumPlanes[plane] = frustum.planes[plane];
+		}
+		header.cameraPosition = glm::vec4(glm::vec3(glm::inverse(m_mvp.view)[3]), 1.0f);
+		bool backFacesCulled = m_dynamicState.cullMode == VK_CULL_MODE_BACK_BIT;
+
+		vkMapMemory(m_mainDevice.logicalDevice, m_meshletCullBufferMemory[imageIdx], 0, VK_WHOLE_SIZE, 0, &data);
+		memcpy(data, &header, sizeof(header));
+		MeshletCullObject *objects = reinterpret_cast<MeshletCullObject *>(static_cast<char *>(data) + sizeof(header));
+		for (size_t i = 0; i < meshList.size(); i++)
+		{
+			const glm::mat4 &world = m_scene.getWorldTransform(m_meshNodes[i]);
+			glm::mat3 linear(world);
+			float scale = std::max(glm::length(linear[0]), std::max(glm::length(linear[1]), glm::length(linear[2])));
+			objects[i].world = world;
+			objects[i].params = glm::vec4(scale, backFacesCulled && canConeCull(world) ? 1.0f : 0.0f, 0.0f, 0.0f);
+		}
+		vkUnmapMemory(m_mainDevice.logicalDevice, m_meshletCullBufferMemory[imageIdx]);
+	}
+}
+
+void VulkanRenderer::setDynamicState(VkCommandBuffer commandBuffer)
+{
+	// Viewport and scissor cover the whole swapchain image
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(m_swapchainExtent.width);
+	viewport.height = static_cast<float>(m_swapchainExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = m_swapchainExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	// Without VK 1.3 these stay baked into the pipeline
+	if (m_extendedDynamicState)
+	{
+		vkCmdSetCullMode(commandBuffer, m_dynamicState.cullMode);
+		vkCmdSetDepthTestEnable(commandBuffer, m_dynamicState.depthTestEnable);
+		vkCmdSetPrimitiveTopology(commandBuffer, m_dynamicState.topology);
+	}
 }
 
 void VulkanRenderer::recordCommands()
+{
+	m_recordedGeneration.assign(m_commandBuffers.size(), m_pipelineGeneration);
+	m_recordedVisibleMeshes.assign(m_commandBuffers.size(), m_visibleMeshes);
+	m_recordedTransparentOrder.assign(m_commandBuffers.size(), m_transparentOrder);
+
+	if (m_jobSystem == nullptr)
+	{
+		for (size_t i = 0; i < m_commandBuffers.size(); i++)
+		{
+			recordCommandBuffer(static_cast<uint32_t>(i));
+		}
+		return;
+	}
+
+	// Every cmd buffer has its own pool, and the sets they bind already exist, so they can all record at once.
+	// Errors are carried back here, so they reach init()'s handler instead of ending a worker thread
+	std::vector<std::exception_ptr> errors(m_commandBuffers.size());
+	JobCounter recorded;
+	m_jobSystem->parallelFor(static_cast<uint32_t>(m_commandBuffers.size()), 1, [this, &errors](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++)
+		{
+			try
+			{
+				recordCommandBuffer(i);
+			}
+			catch (...)
+			{
+				errors[i] = std::current_exception();
+			}
+		}
+	}, recorded);
+	m_jobSystem->wait(recorded);
+
+	for (auto &error : errors)
+	{
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+void VulkanRenderer::recordCommandBuffer(uint32_t imageIndex)
 {
 	// Information about how to begin each cmd buffer
 	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
@@ -938,62 +1733,259 @@ void VulkanRenderer::recordCommands()
 	renderPassBeginInfo.renderPass = m_renderPass;							// Render pass to begin
 	renderPassBeginInfo.renderArea.offset = { 0, 0 };				// start point of the render pass in pixels
 	renderPassBeginInfo.renderArea.extent = m_swapchainExtent;				// Size of region to run render pass on (starting at offset)
-	VkClearValue clearValues[] = {
-		{0.7f, 0.8f, 0.88f, 1.0}
-	};
-	renderPassBeginInfo.pClearValues = clearValues;							// List of clear values; (ToDo: Add Depth attachment clear value)
-	renderPassBeginInfo.clearValueCount = 1;
+	VkClearValue clearValues[2] = {};
+	clearValues[0].color = { 0.7f, 0.8f, 0.88f, 1.0f };						// Color attachment clear value
+	clearValues[1].depthStencil = { 1.0f, 0 };								// Depth attachment clear value: far plane
+	renderPassBeginInfo.pClearValues = clearValues;							// List of clear values (none needed for the resolve attachment)
+	renderPassBeginInfo.clearValueCount = 2;
 	
 	// Note: vkCmd: Command being recorded
 
-	for(size_t i = 0; i < m_commandBuffers.size(); i++)
+	renderPassBeginInfo.framebuffer = m_swapchainFramebuffers[imageIndex];
+
+	// Start recording commands to commandBuffers!
+	VkResult result = vkBeginCommandBuffer(m_commandBuffers[imageIndex], &commandBufferBeginInfo);
+	if (result != VK_SUCCESS)
 	{
-		renderPassBeginInfo.framebuffer = m_swapchainFramebuffers[i];
+		throw std::runtime_error("Failed to Start RECORDING a COMMAND BUFFERS!");
+	}
 
-		// Start recording commands to commandBuffers!
-		VkResult result = vkBeginCommandBuffer(m_commandBuffers[i], &commandBufferBeginInfo);
-		if (result != VK_SUCCESS)
+		// GPU time of the whole render pass: two timestamps per image, read back once its fence signals
+		if (m_timestampQueryPool != VK_NULL_HANDLE)
 		{
-			throw std::runtime_error("Failed to Start RECORDING a COMMAND BUFFERS!");
+			vkCmdResetQueryPool(m_commandBuffers[imageIndex], m_timestampQueryPool, imageIndex * 2, 2);
+			vkCmdWriteTimestamp(m_commandBuffers[imageIndex], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampQueryPool, imageIndex * 2);
 		}
 
-			// Begin Render pass
-			vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);	// All the cmds are primary commands
+		// Meshlet draws of the frame, written before the render pass reads them
+		if (m_meshletPath == MeshletPath::Compute)
+		{
+			recordMeshletCulling(m_commandBuffers[imageIndex], imageIndex);
+		}
 
-				// Bind Pipeline to be used in the Render Pass
-				vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+		// Begin Render pass
+		vkCmdBeginRenderPass(m_commandBuffers[imageIndex], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);	// All the cmds are primary commands
 
+			// Bind the bindless set: every pipeline of the pass has the same layout, so it stays bound for all draws
+			// (the vertex shader reads each mesh's MVP from it; only mesh shaders still bind set 0 per draw)
+			if (m_bindless)
+			{
+				VkDescriptorSet bindlessSet = m_bindlessDescriptors.getSet();
+				vkCmdBindDescriptorSets(m_commandBuffers[imageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, k_bindlessSet,
+					1, &bindlessSet, 0, nullptr);
+			}
 
-				for(auto& mesh: meshList){
-					VkBuffer vertexBuffers[] = { mesh.getVertexBuffer() };			// Buffers to bind
-					VkDeviceSize offsets[] = { 0 };										// Offsets into buffers being bound
-					vkCmdBindVertexBuffers(m_commandBuffers[i], 0, 1, vertexBuffers, offsets);	// Command to bind vertex buffer before drawing with time
+			// Depth pre-pass: lay down the nearest depth so the color pass shades each pixel once
+			if (m_settings.depthPrePass)
+			{
+				// Opaque only: transparent meshes must not hide what is behind them
+				vkCmdBindPipeline(m_commandBuffers[imageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, m_depthPrePassPipeline);
+				setDynamicState(m_commandBuffers[imageIndex]);
+				for (size_t meshIndex = 0; meshIndex < meshList.size(); meshIndex++)
+				{
+					if (!meshList[meshIndex].isTransparent() && isVisible(m_visibleMeshes.data(), meshIndex))
+					{
+						recordMeshDraw(m_commandBuffers[imageIndex], meshIndex, imageIndex);
+					}
+				}
 
-					// Bind mesh index buffer, with 0 offset and using uint32 type
-					vkCmdBindIndexBuffer(m_commandBuffers[i], mesh.getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+				vkCmdNextSubpass(m_commandBuffers[imageIndex], VK_SUBPASS_CONTENTS_INLINE);
+			}
 
-					// Bind Descriptor sets
-					vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0,
-						1, &m_descriptorSets[i], 0, nullptr);
+			// Opaque pass: Bind Pipeline to be used in the Render Pass
+			vkCmdBindPipeline(m_commandBuffers[imageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+			setDynamicState(m_commandBuffers[imageIndex]);
+			for (size_t meshIndex = 0; meshIndex < meshList.size(); meshIndex++)
+			{
+				if (!meshList[meshIndex].isTransparent() && isVisible(m_visibleMeshes.data(), meshIndex))
+				{
+					recordMeshDraw(m_commandBuffers[imageIndex], meshIndex, imageIndex);
+				}
+			}
 
-					// Execute our pipeline 
-					// a) drawing using vertex buffer
-						//vkCmdDraw(m_commandBuffers[i], static_cast<uint32_t>(firstMesh.getVertexCount()), 1, 0, 0);
-					// b) drawing using indices
-					vkCmdDrawIndexed(m_commandBuffers[i], mesh.getIndexCount(), 1, 0, 0, 0);
+			// Transparent pass: blended over the opaque result, back to front
+			if (!m_transparentOrder.empty())
+			{
+				vkCmdBindPipeline(m_commandBuffers[imageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, m_transparentPipeline);
+				setDynamicState(m_commandBuffers[imageIndex]);
+				for (size_t meshIndex : m_transparentOrder)
+				{
+					float opacity = meshList[meshIndex].getOpacity();
+					const float blendConstants[4] = { opacity, opacity, opacity, opacity };
+					vkCmdSetBlendConstants(m_commandBuffers[imageIndex], blendConstants);
+					recordMeshDraw(m_commandBuffers[imageIndex], meshIndex, imageIndex);
 				}
-				// Note: WE can have another pipeline here: for example for deferred shading: the above pipeline can be of Gbuffer pass
-				//			and the following pipeline can be about deferred pass
+			}
 
-			// End Renderer pass
-			vkCmdEndRenderPass(m_commandBuffers[i]);
+			// Note: WE can have another pipeline here: for example for deferred shading: the above pipeline can be of Gbuffer pass
+			//			and the following pipeline can be about deferred pass
 
-		result = vkEndCommandBuffer(m_commandBuffers[i]);
-		if (result != VK_SUCCESS)
+		// End Renderer pass
+		vkCmdEndRenderPass(m_commandBuffers[imageIndex]);
+
+		if (m_timestampQueryPool != VK_NULL_HANDLE)
+		{
+			vkCmdWriteTimestamp(m_commandBuffers[imageIndex], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampQueryPool, imageIndex * 2 + 1);
+		}
+
+	result = vkEndCommandBuffer(m_commandBuffers[imageIndex]);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to End RECORDING a COMMAND BUFFERS!");
+	}
+
+	m_recordedGeneration[imageIndex] = m_pipelineGeneration;
+	m_recordedVisibleMeshes[imageIndex] = m_visibleMeshes;
+	m_recordedTransparentOrder[imageIndex] = m_transparentOrder;
+}
+
+void VulkanRenderer::recordMeshDraw(VkCommandBuffer commandBuffer, size_t meshIndex, uint32_t imageIndex)
+{
+	Mesh &mesh = meshList[meshIndex];
+
+	// Indices into the bindless arrays for this draw (the task shader reads the mesh index too)
+	if (m_drawIndicesStages != 0)
+	{
+		DrawIndices drawIndices = {};
+		drawIndices.mvpBuffer = m_bindless ? m_uniformBufferBindlessIndices[imageIndex] : 0;
+		drawIndices.object = static_cast<uint32_t>(meshIndex);
+		vkCmdPushConstants(commandBuffer, m_pipelineLayout, m_drawIndicesStages, 0, sizeof(DrawIndices), &drawIndices);
+	}
+
+	// The mesh's MVP (its own model matrix): same set, offset to the mesh. Bindless vertex shaders find it through drawIndices instead
+	if (!m_descriptorSets.empty())
+	{
+		VkDescriptorSet descriptorSet = m_meshletPath == MeshletPath::MeshShader ? m_meshShaderSets[imageIndex][meshIndex] : m_descriptorSets[imageIndex];
+		uint32_t mvpOffset = static_cast<uint32_t>(meshIndex * k_mvpStride);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0,
+			1, &descriptorSet, 1, &mvpOffset);
+	}
+
+	// Mesh shaders: a task workgroup per k_meshletsPerTask meshlets, which launches the mesh shader for the visible ones
+	if (m_meshletPath == MeshletPath::MeshShader)
+	{
+		m_cmdDrawMeshTasks(commandBuffer, (mesh.getMeshletCount() + k_meshletsPerTask - 1) / k_meshletsPerTask, 1, 1);
+		return;
+	}
+
+	VkBuffer vertexBuffers[] = { mesh.getVertexBuffer() };			// Buffers to bind
+	VkDeviceSize offsets[] = { 0 };										// Offsets into buffers being bound
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);	// Command to bind vertex buffer before drawing with time
+
+	// Bind mesh index buffer, with 0 offset and the mesh's index type (uint16 whenever its vertices allow)
+	vkCmdBindIndexBuffer(commandBuffer, mesh.getIndexBuffer(), 0, mesh.getIndexType());
+
+	// Execute our pipeline 
+	// a) drawing using vertex buffer
+		//vkCmdDraw(commandBuffer, static_cast<uint32_t>(firstMesh.getVertexCount()), 1, 0, 0);
+	// b) drawing using indices: one draw per sub mesh, each offset to its own vertices
+	// c) the visible meshlets the cull pass wrote (opaque meshes: compacting them reorders the triangles, which blending would show)
+	if (m_meshletPath == MeshletPath::Compute && !mesh.isTransparent())
+	{
+		VkDeviceSize firstDrawOffset = m_firstDrawCommand[meshIndex] * sizeof(VkDrawIndexedIndirectCommand);
+		if (m_drawIndirectCount)
+		{
+			vkCmdDrawIndexedIndirectCount(commandBuffer, m_drawCommandBuffers[imageIndex], firstDrawOffset, m_drawCountBuffers[imageIndex],
+				meshIndex * sizeof(uint32_t), mesh.getMeshletCount(), sizeof(VkDrawIndexedIndirectCommand));
+		}
+		else
+		{
+			// Every slot, culled meshlets draw zero instances
+			vkCmdDrawIndexedIndirect(commandBuffer, m_drawCommandBuffers[imageIndex], firstDrawOffset,
+				mesh.getMeshletCount(), sizeof(VkDrawIndexedIndirectCommand));
+		}
+		return;
+	}
+	for (const auto &subMesh : mesh.getSubMeshes())
+	{
+		vkCmdDrawIndexed(commandBuffer, subMesh.indexCount, 1, subMesh.firstIndex, subMesh.vertexOffset, 0);
+	}
+}
+
+void VulkanRenderer::recordMeshletCulling(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	// Every mesh starts with no draws; the cull pass appends its visible meshlets
+	vkCmdFillBuffer(commandBuffer, m_drawCountBuffers[imageIndex], 0, VK_WHOLE_SIZE, 0);
+
+	VkMemoryBarrier clearBarrier = {};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	// Opaque meshes the CPU didn't already cull, k_meshletsPerCullGroup meshlets per workgroup
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_meshletCullPipeline);
+	for (size_t meshIndex = 0; meshIndex < meshList.size(); meshIndex++)
+	{
+		Mesh &mesh = meshList[meshIndex];
+		if (mesh.isTransparent() || !isVisible(m_visibleMeshes.data(), meshIndex) || mesh.getMeshletCount() == 0)
+		{
+			continue;
+		}
+
+		MeshletCullConstants constants = {};
+		constants.object = static_cast<uint32_t>(meshIndex);
+		constants.firstDrawCommand = m_firstDrawCommand[meshIndex];
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_meshletCullPipelineLayout, 0,
+			1, &m_meshletCullSets[imageIndex][meshIndex], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_meshletCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(commandBuffer, (mesh.getMeshletCount() + k_meshletsPerCullGroup - 1) / k_meshletsPerCullGroup, 1, 1);
+	}
+
+	// Draws and counts are read as indirect arguments
+	VkMemoryBarrier drawBarrier = {};
+	drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+		1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanRenderer::cullMeshes()
+{
+	// World space box of each mesh: its center moves with the transform, its extents through the absolute rotation/scale
+	m_meshBoundsCenters.resize(meshList.size());
+	m_meshBoundsExtents.resize(meshList.size());
+	for (size_t i = 0; i < meshList.size(); i++)
+	{
+		const glm::mat4 &world = m_scene.getWorldTransform(m_meshNodes[i]);
+		glm::mat3 absolute(world);
+		for (int column = 0; column < 3; column++)
+		{
+			absolute[column] = glm::abs(absolute[column]);
+		}
+		m_meshBoundsCenters[i] = glm::vec3(world * glm::vec4(meshList[i].getCenter(), 1.0f));
+		m_meshBoundsExtents[i] = absolute * meshList[i].getExtents();
+	}
+
+	m_visibleMeshes.resize((meshList.size() + 31) / 32);
+	cullAabbs(makeFrustum(m_mvp.projection * m_mvp.view), m_meshBoundsCenters.data(), m_meshBoundsExtents.data(), meshList.size(),
+		m_visibleMeshes.data());
+}
+
+void VulkanRenderer::sortTransparentMeshes()
+{
+	// View space depth of each visible transparent mesh's center (camera looks down -z: further is more negative)
+	std::vector<std::pair<float, size_t>> depths;
+	for (size_t i = 0; i < meshList.size(); i++)
+	{
+		if (meshList[i].isTransparent() && isVisible(m_visibleMeshes.data(), i))
 		{
-			throw std::runtime_error("Failed to End RECORDING a COMMAND BUFFERS!");
+			glm::mat4 modelView = m_mvp.view * m_scene.getWorldTransform(m_meshNodes[i]);
+			depths.push_back({ (modelView * glm::vec4(meshList[i].getCenter(), 1.0f)).z, i });
 		}
 	}
+
+	// Back to front; equal depths keep mesh order so the order doesn't flicker
+	std::stable_sort(depths.begin(), depths.end(),
+		[](const std::pair<float, size_t> &a, const std::pair<float, size_t> &b) { return a.first < b.first; });
+
+	m_transparentOrder.clear();
+	for (const auto &depth : depths)
+	{
+		m_transparentOrder.push_back(depth.second);
+	}
 }
 
 VkResult VulkanRenderer::createDebugUtilsMessengerEXT(
@@ -1391,25 +2383,108 @@ VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkIm
 	return imageView;
 }
 
-VkShaderModule VulkanRenderer::createShaderModule(const std::vector<char>& code)
+VkFormat VulkanRenderer::chooseSupportedFormat(const std::vector<VkFormat> &formats, VkImageTiling tiling, VkFormatFeatureFlags featureFlags)
 {
-	// Shader module creation information
-	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+	// Take the first format (in order of preference) that supports the features with the given tiling
+	for (VkFormat format : formats)
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(m_mainDevice.physicalDevice, format, &properties);
+
+		if (tiling == VK_IMAGE_TILING_LINEAR && (properties.linearTilingFeatures & featureFlags) == featureFlags)
+		{
+			return format;
+		}
+		else if (tiling == VK_IMAGE_TILING_OPTIMAL && (properties.optimalTilingFeatures & featureFlags) == featureFlags)
+		{
+			return format;
+		}
+	}
 
-	shaderModuleCreateInfo.sType	= VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	shaderModuleCreateInfo.codeSize = code.size();										// Size of code
-	shaderModuleCreateInfo.pCode	= reinterpret_cast<const uint32_t*>(code.data());	// pointer to code (of type uint32_t pointer type)
+	throw std::runtime_error("Failed to find a matching FORMAT!");
+}
 
-	VkShaderModule shaderModule;
+VkSampleCountFlagBits VulkanRenderer::chooseSampleCount(VkSampleCountFlagBits requested)
+{
+	// Color and depth attachments must have the same sample count: take the highest both support, up to the requested one
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(m_mainDevice.physicalDevice, &deviceProperties);
+	VkSampleCountFlags supported = deviceProperties.limits.framebufferColorSampleCounts & deviceProperties.limits.framebufferDepthSampleCounts;
 
-	VkResult result = vkCreateShaderModule(m_mainDevice.logicalDevice, &shaderModuleCreateInfo, nullptr, &shaderModule);
+	uint32_t samples = 64;											// VK_SAMPLE_COUNT_64_BIT, the highest count
+	while (samples > static_cast<uint32_t>(requested))
+	{
+		samples >>= 1;
+	}
+	for (; samples > VK_SAMPLE_COUNT_1_BIT; samples >>= 1)
+	{
+		if (supported & samples)
+		{
+			if (samples != static_cast<uint32_t>(requested))
+			{
+				std::cout << "MSAA x" << requested << " not supported, using x" << samples << std::endl;
+			}
+			return static_cast<VkSampleCountFlagBits>(samples);
+		}
+	}
+	return VK_SAMPLE_COUNT_1_BIT;
+}
 
-	if(result != VK_SUCCESS)
+VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags,
+	VkMemoryPropertyFlags propFlags, VkDeviceMemory *imageMemory, VkSampleCountFlagBits samples)
+{
+	/** -- CREATE IMAGE -- **/
+	VkImageCreateInfo imageCreateInfo = {};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;						// Type of image (1D, 2D, 3D)
+	imageCreateInfo.extent.width = width;								// Width of image extent
+	imageCreateInfo.extent.height = height;								// Height of image extent
+	imageCreateInfo.extent.depth = 1;									// Depth of image (just 1, no 3D aspect)
+	imageCreateInfo.mipLevels = 1;										// Number of mipmap levels
+	imageCreateInfo.arrayLayers = 1;									// Number of levels in image array
+	imageCreateInfo.format = format;									// Format type of image
+	imageCreateInfo.tiling = tiling;									// How image data should be "tiled" (arranged for optimal reading)
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;			// Layout of image data on creation
+	imageCreateInfo.usage = useFlags;									// Bit flags defining what image will be used for
+	imageCreateInfo.samples = samples;									// Number of samples for multi-sampling
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;			// Whether image can be shared between queues
+
+	VkImage image;
+	VkResult result = vkCreateImage(m_mainDevice.logicalDevice, &imageCreateInfo, nullptr, &image);
+	if (result != VK_SUCCESS)
 	{
-		throw std::runtime_error("Failed to create Shader Module!");
+		throw std::runtime_error("Failed to create an IMAGE!");
 	}
 
-	return shaderModule;
+	/** -- CREATE MEMORY FOR IMAGE -- **/
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(m_mainDevice.logicalDevice, image, &memoryRequirements);
+
+	VkMemoryAllocateInfo memoryAllocInfo = {};
+	memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocInfo.allocationSize = memoryRequirements.size;
+	// Lazily allocated memory is only a preference: most desktop GPUs don't have it
+	memoryAllocInfo.memoryTypeIndex = findMemoryTypeIndex(m_mainDevice.physicalDevice, memoryRequirements.memoryTypeBits,
+		propFlags & ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, propFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+	result = vkAllocateMemory(m_mainDevice.logicalDevice, &memoryAllocInfo, nullptr, imageMemory);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate memory for an IMAGE!");
+	}
+
+	// Connect memory to image
+	vkBindImageMemory(m_mainDevice.logicalDevice, image, *imageMemory, 0);
+
+	return image;
+}
+
+VkImage VulkanRenderer::createTransientImage(VkFormat format, VkImageUsageFlags useFlags, VkSampleCountFlagBits samples, VkDeviceMemory *imageMemory)
+{
+	// Attachment never loaded or stored: on tilers it can live in tile memory only (lazily allocated memory, if the device has it)
+	return createImage(m_swapchainExtent.width, m_swapchainExtent.height, format, VK_IMAGE_TILING_OPTIMAL,
+		useFlags | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, imageMemory, samples);
 }
 
 
@@ -1417,26 +2492,48 @@ VkShaderModule VulkanRenderer::createShaderModule(const std::vector<char>& code)
 // Clean up our code
 void VulkanRenderer::cleanUp()
 {
+	// Stop watching shaders first: nothing else to reload
+	m_shaderWatcher.destroy();
+
 	// Wait until no actions are being run on device before destroying
 	vkDeviceWaitIdle(m_mainDevice.logicalDevice);
 
-	//Destroy Descriptor pool
-	vkDestroyDescriptorPool(m_mainDevice.logicalDevice, m_descriptorPool, nullptr);
-
-	// Destroy Descriptor Set layout
-	vkDestroyDescriptorSetLayout(m_mainDevice.logicalDevice, m_descriptorSetLayout, nullptr);
-
 	for(size_t i = 0; i < m_uniformBuffer.size(); i++)
 	{
+		m_descriptorSetCache.invalidateBuffer(m_uniformBuffer[i]);
 		vkDestroyBuffer(m_mainDevice.logicalDevice, m_uniformBuffer[i], nullptr);
 		vkFreeMemory(m_mainDevice.logicalDevice, m_uniformBufferMemory[i], nullptr);
 	}
 
-	// Destroy the mesh
+	// Destroy the meshlet culling buffers
+	for (size_t i = 0; i < m_meshletCullBuffers.size(); i++)
+	{
+		m_descriptorSetCache.invalidateBuffer(m_meshletCullBuffers[i]);
+		vkDestroyBuffer(m_mainDevice.logicalDevice, m_meshletCullBuffers[i], nullptr);
+		vkFreeMemory(m_mainDevice.logicalDevice, m_meshletCullBufferMemory[i], nullptr);
+	}
+	for (size_t i = 0; i < m_drawCommandBuffers.size(); i++)
+	{
+		m_descriptorSetCache.invalidateBuffer(m_drawCommandBuffers[i]);
+		m_descriptorSetCache.invalidateBuffer(m_drawCountBuffers[i]);
+		vkDestroyBuffer(m_mainDevice.logicalDevice, m_drawCommandBuffers[i], nullptr);
+		vkFreeMemory(m_mainDevice.logicalDevice, m_drawCommandBufferMemory[i], nullptr);
+		vkDestroyBuffer(m_mainDevice.logicalDevice, m_drawCountBuffers[i], nullptr);
+		vkFreeMemory(m_mainDevice.logicalDevice, m_drawCountBufferMemory[i], nullptr);
+	}
+
+	// Destroy the mesh (its buffers are bound by the mesh shader and cull sets)
 	for (auto& mesh : meshList) 
 	{
+		m_descriptorSetCache.invalidateBuffer(mesh.getVertexBuffer());
+		m_descriptorSetCache.invalidateBuffer(mesh.getMeshletBuffer());
+		m_descriptorSetCache.invalidateBuffer(mesh.getMeshletDataBuffer());
 		mesh.destroyBuffers();
 	}
+
+	//Destroy Descriptor pools (and the update templates of the cached sets)
+	m_descriptorSetCache.destroy();
+	m_descriptorAllocator.destroy();
 	// Destroy Semaphores
 	for(size_t i = 0; i < MAX_FRAME_DRAWS; i++)
 	{
@@ -1445,8 +2542,18 @@ void VulkanRenderer::cleanUp()
 		vkDestroyFence(m_mainDevice.logicalDevice, m_drawFences[i], nullptr);
 	}
 
+	// Destroy GPU timing queries
+	if (m_timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(m_mainDevice.logicalDevice, m_timestampQueryPool, nullptr);
+	}
+
 	// Destroy command pool
 	vkDestroyCommandPool(m_mainDevice.logicalDevice, m_graphicsCmdPool, nullptr);
+	for (auto pool : m_recordCmdPools)
+	{
+		vkDestroyCommandPool(m_mainDevice.logicalDevice, pool, nullptr);
+	}
 
 	// Destroy framebuffer
 	for (auto fb : m_swapchainFramebuffers)
@@ -1454,15 +2561,42 @@ void VulkanRenderer::cleanUp()
 		vkDestroyFramebuffer(m_mainDevice.logicalDevice, fb, nullptr);
 	}
 
-	// Destroy pipeline
-	vkDestroyPipeline(m_mainDevice.logicalDevice, m_graphicsPipeline, nullptr);
+	// Destroy pipelines (registry owns every pipeline, m_graphicsPipeline included; the cull pass is built outside it)
+	m_pipelineRegistry.destroy();
+	destroyRetiredPipelines(true);
+	if (m_meshletCullPipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(m_mainDevice.logicalDevice, m_meshletCullPipeline, nullptr);
+	}
+
+	// Stop the pipeline compiler workers and destroy the pipeline cache
+	m_pipelineCompiler.destroy();
 
-	// Destroy pipeline layout
-	vkDestroyPipelineLayout(m_mainDevice.logicalDevice, m_pipelineLayout, nullptr);
+	// Destroy pipeline layouts and Descriptor Set layouts (m_pipelineLayout and m_descriptorSetLayout included)
+	m_layoutCache.destroy();
+
+	// Destroy the global bindless set, its pool and layout
+	m_bindlessDescriptors.destroy();
 
 	// Destroy Render pass
 	vkDestroyRenderPass(m_mainDevice.logicalDevice, m_renderPass, nullptr);
 
+	// Destroy MSAA color buffers
+	for (size_t i = 0; i < m_colorBufferImages.size(); i++)
+	{
+		vkDestroyImageView(m_mainDevice.logicalDevice, m_colorBufferImageViews[i], nullptr);
+		vkDestroyImage(m_mainDevice.logicalDevice, m_colorBufferImages[i], nullptr);
+		vkFreeMemory(m_mainDevice.logicalDevice, m_colorBufferImageMemory[i], nullptr);
+	}
+
+	// Destroy depth buffers
+	for (size_t i = 0; i < m_depthBufferImages.size(); i++)
+	{
+		vkDestroyImageView(m_mainDevice.logicalDevice, m_depthBufferImageViews[i], nullptr);
+		vkDestroyImage(m_mainDevice.logicalDevice, m_depthBufferImages[i], nullptr);
+		vkFreeMemory(m_mainDevice.logicalDevice, m_depthBufferImageMemory[i], nullptr);
+	}
+
 	// Because we have created IMAGE_VIEWS, we need to destroy them as well
 	for (auto image : m_swapchainImages)
 	{
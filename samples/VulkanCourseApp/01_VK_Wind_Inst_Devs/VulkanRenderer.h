@@ -17,7 +17,22 @@
 // imported for renderpass::subpass
 #include <array>
 
+// imported for extension name checks and buffer uploads (strcmp, memcpy)
+#include <cstring>
+
 #include "Mesh.h"
+#include "PipelineCompiler.h"
+#include "PipelineRegistry.h"
+#include "ShaderReflection.h"
+#include "EmbeddedShaders.h"
+#include "DescriptorLayoutCache.h"
+#include "ShaderWatcher.h"
+#include "BindlessDescriptors.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorSetCache.h"
+#include "SceneGraph.h"
+#include "Frustum.h"
+#include "JobSystem.h"
 
 #include <iostream>
 
@@ -25,15 +40,37 @@
 #include "VulkanValidation.h"
 
 
+// Options picked before init()
+struct RendererSettings
+{
+	bool	 depthPrePass = false;		// Depth-only subpass first, so the color subpass shades each visible pixel once
+	uint32_t overdrawLayers = 0;		// Extra screen covering quads drawn back to front (overdraw benchmark)
+	VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;	// Clamped to what the device supports
+	bool	 compactVertices = false;	// CompactVertex buffers (12 bytes instead of 24): 16 bit positions in the mesh bounds, 8 bit colors
+	bool	 split16BitIndices = false;	// Split meshes too big for 16 bit indices instead of using 32 bit ones (see MeshSettings)
+	bool	 meshlets = false;			// Cull meshlets on the GPU (see Meshlets.h): in a task shader if the device has mesh shaders,
+										// else in a compute pass writing indirect draws
+	bool	 meshShaders = true;		// Off: meshlets always take the compute path
+	bool	 showDepth = false;			// Shade by distance to the camera (shader.frag variant, see setShowDepth)
+};
+
 class VulkanRenderer
 {
 public:
 	VulkanRenderer();
 
-	int init(GLFWwindow *newWindow);
+	// jobSystem: used for transform updates and cmd buffer recording (nullptr == do everything on this thread)
+	int init(GLFWwindow *newWindow, JobSystem *jobSystem, const RendererSettings &settings = RendererSettings());
 
 	void UpdateModel(glm::mat4 newModel);
 
+	// Switch shader.frag's depth view on or off: queues that pipeline variant (compiled once, cached after) and swaps it in
+	// at a frame boundary like a shader reload
+	void setShowDepth(bool showDepth);
+
+	// Average GPU time of a frame's cmd buffer in ms since the last call (0 if timestamps aren't supported)
+	double takeAverageGpuTime();
+
 	void draw();
 	void cleanUp();
 
@@ -41,10 +78,21 @@ public:
 
 private:
 	GLFWwindow *m_window;
+	JobSystem  *m_jobSystem = nullptr;
 	int m_currFrame = 0;
+	RendererSettings m_settings;
 
 	// Scene Objects
 	std::vector<Mesh> meshList;
+	SceneGraph						 m_scene;
+	SceneGraph::NodeHandle			 m_sceneRoot;				// Transform set by UpdateModel; parent of every mesh
+	std::vector<SceneGraph::NodeHandle> m_meshNodes;			// Scene node of each mesh in meshList
+
+	// -- Frustum culling: world space box of each mesh, and which meshes the camera sees
+	std::vector<glm::vec3>			 m_meshBoundsCenters;
+	std::vector<glm::vec3>			 m_meshBoundsExtents;
+	std::vector<uint32_t>			 m_visibleMeshes;			// Bit per mesh in meshList (see isVisible())
+	std::vector<std::vector<uint32_t>> m_recordedVisibleMeshes;	// m_visibleMeshes each cmd buffer was recorded with
 
 		// Scene Settings
 		struct MVP
@@ -54,6 +102,32 @@ private:
 			glm::mat4 model;
 		} m_mvp;
 
+		// Per draw push constants with bindless: indices into the global set's arrays
+		struct DrawIndices
+		{
+			uint32_t mvpBuffer;		// Storage buffer holding this frame's MVPs (one per mesh, k_mvpStride apart)
+			uint32_t object;		// Index of the mesh in meshList
+		};
+
+		// Meshlet culling input (Shaders/meshlet_cull.glsl): a header, then an object per mesh
+		struct MeshletCullHeader
+		{
+			glm::vec4 frustumPlanes[Frustum::PlaneCount];	// World space, pointing inside
+			glm::vec4 cameraPosition;						// w unused
+		};
+		struct MeshletCullObject
+		{
+			glm::mat4 world;		// Meshlet bounds are in float model space: no dequantize here
+			glm::vec4 params;		// x: largest axis scale of world, y: 1 if back facing meshlets may be culled
+		};
+
+		// Push constants of the cull pass
+		struct MeshletCullConstants
+		{
+			uint32_t object;			// Index of the mesh in meshList
+			uint32_t firstDrawCommand;	// m_firstDrawCommand of the mesh
+		};
+
 	// Vulkan Components
 	// -- Main
 	VkInstance m_instance;
@@ -74,27 +148,142 @@ private:
 	std::vector<VkFramebuffer>		m_swapchainFramebuffers;
 	std::vector<VkCommandBuffer>	m_commandBuffers;
 
+	// -- Depth buffer (one per swapchain image, as its framebuffer can be in flight while another image renders)
+	// Transient: only lives inside the render pass, so lazily allocated memory can back it (tile memory only)
+	VkFormat					m_depthFormat;
+	std::vector<VkImage>		m_depthBufferImages;
+	std::vector<VkDeviceMemory> m_depthBufferImageMemory;
+	std::vector<VkImageView>	m_depthBufferImageViews;
+
+	// -- MSAA: multisampled color buffer per swapchain image (only if m_msaaSamples > 1), resolved into the swapchain image
+	// at the end of the color subpass. Transient like the depth buffer: the samples are never stored
+	VkSampleCountFlagBits		m_msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+	std::vector<VkImage>		m_colorBufferImages;
+	std::vector<VkDeviceMemory> m_colorBufferImageMemory;
+	std::vector<VkImageView>	m_colorBufferImageViews;
+
+	// -- Shaders
+	std::vector<ShaderStageDesc> m_shaderStages;			// SPIR-V of the graphics pipeline stages
+	ShaderReflection			 m_shaderReflection;		// Bindings/push constants/vertex inputs read from m_shaderStages
+	SpecializationConstants		 m_shaderFeatures;			// Specialization constant values picking the shader variant (see m_shaderReflection.specConstants)
+	static constexpr float		 k_nearPlane = 0.1f;		// Projection planes, also shader.frag's depth view constants
+	static constexpr float		 k_farPlane = 100.0f;
+	ShaderWatcher				 m_shaderWatcher;			// Recompiles Shaders/*.vert|frag when saved (hot reload)
+
 	// -- Descriptors
+	DescriptorLayoutCache m_layoutCache;					// Owns the set and pipeline layouts
 	VkDescriptorSetLayout m_descriptorSetLayout;
 
-	VkDescriptorPool			 m_descriptorPool;
-	std::vector<VkDescriptorSet> m_descriptorSets;
+	DescriptorAllocator				 m_descriptorAllocator;				// Long lived sets (m_descriptorSets)
+	DescriptorSetCache				 m_descriptorSetCache;				// Reuses sets with identical resources (from m_descriptorAllocator)
+	std::vector<VkDescriptorSet>	 m_descriptorSets;					// [image]: the image's uniform buffer, a dynamic offset picks the mesh's MVP (empty if set 0 is unused, unused with mesh shaders)
+	std::vector<std::vector<VkDescriptorSet>> m_meshShaderSets;		// [image][mesh]: same MVP binding plus the mesh's meshlet buffers (mesh shader path)
 
-	std::vector<VkBuffer>		m_uniformBuffer;			// one for each swapchain
+	// Bindless (VK 1.2 descriptor indexing, if supported): set 1 of every pipeline, bound once per cmd buffer
+	static const uint32_t k_bindlessSet = 1;
+	bool				  m_bindless = false;
+	BindlessDescriptors	  m_bindlessDescriptors;
+	std::vector<uint32_t> m_uniformBufferBindlessIndices;	// Index of each m_uniformBuffer in the storage buffer array
+
+	std::vector<VkBuffer>		m_uniformBuffer;			// one for each swapchain, holding an MVP per mesh
+	static const VkDeviceSize	k_mvpStride = 256;			// Offset between the meshes' MVPs: the largest minUniformBufferOffsetAlignment
+															// a device may have, and 4 matrices for shader_bindless.vert to index by
 	std::vector<VkDeviceMemory> m_uniformBufferMemory;
+	VkShaderStageFlags			m_drawIndicesStages = 0;	// Stages DrawIndices are pushed to (0: the pipelines have no push constants)
+
+	// -- Meshlets (only with m_settings.meshlets). Each path falls back to the next when the device or its SPIR-V is missing
+	enum class MeshletPath
+	{
+		None,			// Whole meshes
+		Compute,		// Cull pass before the render pass writes each mesh's visible meshlets as indirect draws
+		MeshShader		// Task shader culls, mesh shader draws (VK_EXT_mesh_shader): m_shaderStages are task, mesh and fragment
+	};
+	static const uint32_t		k_meshletsPerTask = 32;		// Meshlets a task shader workgroup culls (meshlet.task's local size)
+	static const uint32_t		k_meshletsPerCullGroup = 64;	// Same for the cull pass (meshlet_cull.comp)
+	MeshletPath					m_meshletPath = MeshletPath::None;
+	PFN_vkCmdDrawMeshTasksEXT	m_cmdDrawMeshTasks = nullptr;	// Extension function, from the device
+	std::vector<VkBuffer>		m_meshletCullBuffers;			// Per image: MeshletCullHeader and objects, written with the MVPs
+	std::vector<VkDeviceMemory> m_meshletCullBufferMemory;
+
+	// Compute path: a run of draw slots per mesh (one per meshlet) and a draw count per mesh, per image
+	ShaderStageDesc				m_meshletCullStage;
+	ShaderReflection			m_meshletCullReflection;
+	VkPipeline					m_meshletCullPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout			m_meshletCullPipelineLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout		m_meshletCullSetLayout = VK_NULL_HANDLE;
+	std::vector<std::vector<VkDescriptorSet>> m_meshletCullSets;	// [image][mesh]
+	std::vector<uint32_t>		m_firstDrawCommand;				// Per mesh: its first slot
+	std::vector<VkBuffer>		m_drawCommandBuffers;			// VkDrawIndexedIndirectCommand slots
+	std::vector<VkDeviceMemory> m_drawCommandBufferMemory;
+	bool						m_drawIndirectCount = false;	// Draws compacted behind a GPU count (VK 1.2), else a slot per meshlet
+	std::vector<VkBuffer>		m_drawCountBuffers;				// uint32_t per mesh
+	std::vector<VkDeviceMemory> m_drawCountBufferMemory;
 
 	// -- Pipeline
 	VkPipeline		 m_graphicsPipeline;
 	VkPipelineLayout m_pipelineLayout;
 	VkRenderPass	 m_renderPass;
 
+	PipelineCompiler			   m_pipelineCompiler;			// Builds pipelines on worker threads
+	PipelineRegistry			   m_pipelineRegistry;			// Owns pipelines, dedupes identical state
+	std::shared_future<VkPipeline> m_graphicsPipelineFuture;	// m_graphicsPipeline while it compiles
+	PipelineDesc				   m_graphicsPipelineDesc;		// State m_graphicsPipeline was built from (rebuilt on shader reload)
+	uint32_t					   m_colorSubpass = 0;			// Subpass of m_graphicsPipeline (1 after the depth pre-pass)
+
+	// -- Transparent pass: same as m_graphicsPipeline but blended by the mesh opacity, no depth writes
+	VkPipeline					   m_transparentPipeline = VK_NULL_HANDLE;
+	std::shared_future<VkPipeline> m_transparentPipelineFuture;
+	PipelineDesc				   m_transparentPipelineDesc;
+	std::vector<size_t>			   m_transparentOrder;			// meshList indices of transparent meshes, back to front
+	std::vector<std::vector<size_t>> m_recordedTransparentOrder;	// m_transparentOrder each cmd buffer was recorded with
+
+	// -- Depth pre-pass (only with m_settings.depthPrePass): vertex shader only, writes depth for subpass 1 to test against
+	VkPipeline					   m_depthPrePassPipeline = VK_NULL_HANDLE;
+	std::shared_future<VkPipeline> m_depthPrePassPipelineFuture;
+	PipelineDesc				   m_depthPrePassDesc;
+
+	// -- Hot reload: pipeline is swapped and cmd buffers re-recorded at a frame boundary
+	std::shared_future<VkPipeline> m_reloadedPipelineFuture;	// Pipeline for the reloaded shaders while it compiles
+	std::shared_future<VkPipeline> m_reloadedTransparentFuture;	// Same for the transparent pass
+	std::shared_future<VkPipeline> m_reloadedDepthPrePassFuture;	// Same for the depth pre-pass (its vertex shader must match)
+	bool						   m_reloadRetiresOld = false;	// Pending swap replaces old shader code (not just another cached variant)
+	uint32_t					   m_pipelineGeneration = 0;	// Bumped every time m_graphicsPipeline changes
+	std::vector<uint32_t>		   m_recordedGeneration;		// m_pipelineGeneration each cmd buffer was recorded with
+	std::vector<VkFence>		   m_imageFences;				// Fence of the frame last using each swapchain image (or null)
+
+	// -- Pipelines replaced by a reload: still used by cmd buffers recorded before the swap, so destroyed
+	//	  only once every image was re-recorded (after waiting on its fence) at generation or later
+	struct RetiredPipeline
+	{
+		VkPipeline pipeline;
+		uint32_t   generation;			// m_pipelineGeneration that stopped using it
+	};
+	std::vector<RetiredPipeline>   m_retiredPipelines;
+
+	// -- Dynamic State (set while recording, changing it does not need a new pipeline)
+	bool m_extendedDynamicState = false;		// Device supports cull mode/depth test/topology as dynamic state (VK 1.3)
+	struct
+	{
+		VkCullModeFlags		cullMode		= VK_CULL_MODE_BACK_BIT;
+		VkBool32			depthTestEnable = VK_TRUE;
+		VkPrimitiveTopology topology		= VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	} m_dynamicState;
+
 	// -- Pools 
 	VkCommandPool m_graphicsCmdPool;
+	std::vector<VkCommandPool> m_recordCmdPools;		// One per cmd buffer: pools are externally synchronized, so each can record on its own thread
 
 	// -- Utility
 	VkFormat		m_swapchainImageFormat;
 	VkExtent2D		m_swapchainExtent;
 
+	// -- GPU timing: 2 timestamps (start, end) per cmd buffer
+	VkQueryPool		  m_timestampQueryPool = VK_NULL_HANDLE;
+	float			  m_timestampPeriod = 0.0f;				// ns per timestamp tick
+	std::vector<bool> m_timestampsPending;					// Cmd buffer was submitted and its timestamps not read yet
+	double			  m_gpuTimeTotal = 0.0;					// ms summed since last takeAverageGpuTime()
+	uint32_t		  m_gpuTimeFrames = 0;
+
 	// -- Synchronization
 	std::vector<VkSemaphore> m_semaphoreImageAvailable;
 	std::vector<VkSemaphore> m_semaphoreRenderFinished;
@@ -108,15 +297,28 @@ private:
 	void createLogicalDevice();
 	void createSurface();
 	void createSwapchain();
+	void createColorBufferImage();
+	void createDepthBufferImage();
 	void createRenderPass();
+	void loadShaders();
+	void loadMeshletShaders();
+	ShaderReflection reflectGraphicsShaders(const std::vector<ShaderStageDesc> &shaderStages);
+	void reloadShaders();
+	void updateShaderFeatures();
+	void retirePipeline(VkPipeline oldPipeline, VkPipeline newPipeline);
+	void destroyRetiredPipelines(bool all);
 	void createDescriptorSetLayout();
 	void createGraphicsPipeline();
+	void createMeshletCullPipeline();
+	VkPipelineLayout getPipelineLayout(const ShaderReflection &reflection);
 	void createFramebuffers();
 	void createCommandPool();
 	void createCommandBuffers();
 	void createSynchronization();
+	void createTimestampQueryPool();
 
 	void createUniformBuffers();
+	void createMeshletBuffers();
 	void createDescriptorPool();
 	void createDescriptorSets();
 
@@ -124,6 +326,13 @@ private:
 
 	// - Record Function
 	void recordCommands();
+	void recordCommandBuffer(uint32_t imageIndex);
+	void recordMeshDraw(VkCommandBuffer commandBuffer, size_t meshIndex, uint32_t imageIndex);
+	void recordMeshletCulling(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	void cullMeshes();
+	void sortTransparentMeshes();
+	void readTimestamps(uint32_t imageIndex);
+	void setDynamicState(VkCommandBuffer commandBuffer);
 
 	// -Set Functions
 	void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
@@ -154,10 +363,14 @@ private:
 	VkSurfaceFormatKHR	chooseBestSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &formats);
 	VkPresentModeKHR	chooseBestPresentationMode(const std::vector<VkPresentModeKHR> &presentationModes);
 	VkExtent2D			choseSwapExtent(const VkSurfaceCapabilitiesKHR &surfaceCapabilities);
+	VkFormat			chooseSupportedFormat(const std::vector<VkFormat> &formats, VkImageTiling tiling, VkFormatFeatureFlags featureFlags);
+	VkSampleCountFlagBits chooseSampleCount(VkSampleCountFlagBits requested);
 
 	// -- Create functions
 	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectflags);
-	VkShaderModule createShaderModule(const std::vector<char> &code);
+	VkImage		createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags,
+							VkMemoryPropertyFlags propFlags, VkDeviceMemory *imageMemory, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+	VkImage		createTransientImage(VkFormat format, VkImageUsageFlags useFlags, VkSampleCountFlagBits samples, VkDeviceMemory *imageMemory);
 };
 
 
@@ -6,11 +6,16 @@
 #include <stdexcept>
 #include <vector>
 #include <iostream>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
 
 #include "VulkanRenderer.h"
+#include "JobSystem.h"
 
 
 GLFWwindow *window;
+JobSystem jobSystem;
 VulkanRenderer vulkanRenderer;
 
 void initWindow(std::string wName = "Test Window", const int width = 800, const int height = 600)
@@ -29,25 +34,106 @@ void initWindow(std::string wName = "Test Window", const int width = 800, const
 	window = glfwCreateWindow(width, height, wName.c_str(), nullptr, nullptr);
 }
 
-int main()
+int main(int argc, char **argv)
 {
+	// Command line:
+	//	--depth-prepass		lay down depth in a separate pass before shading
+	//	--overdraw N		draw N full screen quads behind the scene
+	//	--msaa N			N samples per pixel (1, 2, 4, 8, ...)
+	//	--compact-vertices	12 byte vertices: 16 bit snorm positions in the mesh bounds, 8 bit unorm colors
+	//	--split-16bit-indices	split meshes of more than 65535 vertices so they can use 16 bit indices too
+	//	--meshlets			cull meshlets on the GPU (mesh shaders if the device has them, else compute + indirect draws)
+	//	--no-mesh-shaders	with --meshlets: always the compute path
+	//	--show-depth		start with the depth view (D toggles it while running)
+	//	--benchmark N		render N frames, print the average GPU time per frame and exit
+	//	--workers N			job system worker threads (default: one less than the hardware threads)
+	// CPU side benchmarks (scene graph, jobs, SIMD kernels, mesh optimizer, meshlets) are in the CpuBenchmark project
+	RendererSettings settings;
+	int benchmarkFrames = 0;
+	uint32_t workerCount = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--depth-prepass")
+		{
+			settings.depthPrePass = true;
+		}
+		else if (arg == "--compact-vertices")
+		{
+			settings.compactVertices = true;
+		}
+		else if (arg == "--split-16bit-indices")
+		{
+			settings.split16BitIndices = true;
+		}
+		else if (arg == "--meshlets")
+		{
+			settings.meshlets = true;
+		}
+		else if (arg == "--no-mesh-shaders")
+		{
+			settings.meshShaders = false;
+		}
+		else if (arg == "--show-depth")
+		{
+			settings.showDepth = true;
+		}
+		else if (arg == "--overdraw" && i + 1 < argc)
+		{
+			settings.overdrawLayers = static_cast<uint32_t>(std::max(0, std::atoi(argv[++i])));
+		}
+		else if (arg == "--msaa" && i + 1 < argc)
+		{
+			settings.msaaSamples = static_cast<VkSampleCountFlagBits>(std::max(1, std::atoi(argv[++i])));
+		}
+		else if (arg == "--benchmark" && i + 1 < argc)
+		{
+			benchmarkFrames = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (arg == "--workers" && i + 1 < argc)
+		{
+			workerCount = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+		}
+		else
+		{
+			std::cout << "Unknown argument: " << arg << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	// This thread becomes the job system's main thread: GLFW calls queued as main thread jobs run here
+	jobSystem.init(workerCount);
+
 	// create window
 	initWindow("Descriptor Sets and Uniform Buffers", 800, 600);
 
 	// Create Vulkan renderer instance!
-	if(vulkanRenderer.init(window) == EXIT_FAILURE)
+	if(vulkanRenderer.init(window, &jobSystem, settings) == EXIT_FAILURE)
 	{
+		jobSystem.destroy();
 		return EXIT_FAILURE;
 	}
 
 	float angle = 0.0f;
 	float deltaTime = 0.0f;
 	float lastTime = 0.0f;
+	int frame = 0;
+	bool depthKeyWasDown = false;
 
 	// loop until close
 	while(!glfwWindowShouldClose(window))
 	{
 		glfwPollEvents();
+		jobSystem.pumpMainThread();
+
+		// D switches the depth view: another shader variant, compiled the first time and cached after
+		bool depthKeyDown = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+		if (depthKeyDown && !depthKeyWasDown)
+		{
+			settings.showDepth = !settings.showDepth;
+			vulkanRenderer.setShowDepth(settings.showDepth);
+		}
+		depthKeyWasDown = depthKeyDown;
 
 		float currTime = glfwGetTime();
 		deltaTime = currTime - lastTime;
@@ -59,9 +145,19 @@ int main()
 		vulkanRenderer.UpdateModel(glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0, 0.0, 1.0)));
 
 		vulkanRenderer.draw();
+
+		if (benchmarkFrames > 0 && ++frame >= benchmarkFrames)
+		{
+			std::cout << "Depth pre-pass: " << (settings.depthPrePass ? "on" : "off") << ", MSAA: x" << settings.msaaSamples
+				<< ", overdraw layers: " << settings.overdrawLayers << ", vertices: " << (settings.compactVertices ? "compact" : "float")
+				<< ", meshlets: " << (settings.meshlets ? "on" : "off")
+				<< ", average GPU time: " << vulkanRenderer.takeAverageGpuTime() << " ms over " << frame << " frames" << std::endl;
+			break;
+		}
 	}
 
 	vulkanRenderer.cleanUp();
+	jobSystem.destroy();
 
 	//clean up
 	// Destroy glfw window and stop glfw
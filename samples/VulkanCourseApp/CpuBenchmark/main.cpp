@@ -0,0 +1,797 @@
+// CPU side benchmarks of the renderer's building blocks: scene graph, job system, the SIMD batch kernels (transforms,
+// frustum culling, quaternions, packing), the mesh optimizer and meshlets. No window or Vulkan device needed.
+// Builds the sources it measures straight from 01_VK_Wind_Inst_Devs, so it times exactly what the sample runs.
+//
+// Command line (no benchmark named: all of them):
+//	--scene N			time world transform updates of an N node scene graph (default 100000)
+//	--jobs				time job spawning, stealing and dependencies
+//	--transform			time batch vector/matrix transforms at each SIMD level
+//	--cull				time frustum culling of spheres and boxes
+//	--quat				time and check the batch quaternion kernels against glm
+//	--pack				time and check the bulk half / snorm / unorm packing against glm
+//	--mesh				vertex cache stats and time of the mesh optimizer on a big grid
+//	--meshlet			build and cull meshlets of a big sphere on the CPU
+//	--workers N			job system worker threads (default: one less than the hardware threads)
+// e.g.	msbuild VulkanCourseApp.sln /t:CpuBenchmark /p:Configuration=Release /p:Platform=x64
+//		x64\Release\CpuBenchmark.exe --transform --cull
+
+#include <vector>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <cmath>
+#include <cstring>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "BenchmarkTiming.h"
+#include "SceneGraph.h"
+#include "JobSystem.h"
+#include "BatchTransform.h"
+#include "Frustum.h"
+#include "BatchQuat.h"
+#include "BatchPack.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+
+
+JobSystem jobSystem;
+
+// Time SceneGraph::updateWorldTransforms() on a nodeCount node hierarchy (no window or Vulkan needed)
+static void runSceneBenchmark(uint32_t nodeCount)
+{
+	const int runs = 10;
+
+	// Nodes are added breadth first (4 children per node), so the first update also has to reorder them
+	SceneGraph scene;
+	scene.reserve(nodeCount);
+	std::vector<SceneGraph::NodeHandle> nodes;
+	nodes.reserve(nodeCount);
+	for (uint32_t i = 0; i < nodeCount; i++)
+	{
+		SceneGraph::NodeHandle parent = i == 0 ? SceneGraph::k_noParent : nodes[(i - 1) / 4];
+		nodes.push_back(scene.addNode(parent, glm::translate(glm::mat4(1.0f), glm::vec3(0.001f * (i % 7), 0.0f, 0.0f))));
+	}
+
+	JobSystem *jobs = nullptr;
+	auto timeUpdate = [&scene, &jobs](const std::function<void()> &change)
+	{
+		double total = 0.0;
+		for (int run = 0; run < runs; run++)
+		{
+			change();
+			auto start = BenchmarkClock::now();
+			scene.updateWorldTransforms(jobs);
+			total += millisecondsSince(start);
+		}
+		return total / runs;
+	};
+
+	auto start = BenchmarkClock::now();
+	scene.updateWorldTransforms();
+	double firstUpdate = millisecondsSince(start);
+
+	float angle = 0.0f;
+	double allDirty = timeUpdate([&]() {
+		scene.setLocalTransform(nodes[0], glm::rotate(glm::mat4(1.0f), angle += 0.01f, glm::vec3(0.0f, 0.0f, 1.0f)));
+	});
+
+	std::mt19937 random(1234);
+	std::uniform_int_distribution<uint32_t> pick(nodeCount / 2, nodeCount - 1);
+	double fewDirty = timeUpdate([&]() {
+		for (uint32_t i = 0; i < nodeCount / 100; i++)
+		{
+			SceneGraph::NodeHandle node = nodes[pick(random)];
+			scene.setLocalTransform(node, glm::translate(scene.getLocalTransform(node), glm::vec3(0.0f, 0.001f, 0.0f)));
+		}
+	});
+
+	double clean = timeUpdate([]() {});
+
+	jobs = &jobSystem;
+	double allDirtyJobs = timeUpdate([&]() {
+		scene.setLocalTransform(nodes[0], glm::rotate(glm::mat4(1.0f), angle += 0.01f, glm::vec3(0.0f, 0.0f, 1.0f)));
+	});
+
+	std::cout << "Scene graph, " << nodeCount << " nodes:" << std::endl
+		<< "  first update (incl. reorder): " << firstUpdate << " ms" << std::endl
+		<< "  root moved (all dirty):       " << allDirty << " ms" << std::endl
+		<< "  1% of nodes moved:            " << fewDirty << " ms" << std::endl
+		<< "  nothing moved:                " << clean << " ms" << std::endl
+		<< "  root moved, with jobs:        " << allDirtyJobs << " ms (" << jobSystem.getWorkerCount() + 1 << " threads)" << std::endl;
+}
+
+// Job system microbenchmarks: cost of a job, cost of stealing, dependency chains
+static void runJobBenchmark()
+{
+	const uint32_t jobCount = 1000000;
+	std::cout << "Job system, " << jobSystem.getWorkerCount() << " workers + main thread:" << std::endl;
+
+	// Spawn overhead: empty jobs queued on the main thread (workers steal most of them)
+	{
+		JobCounter counter;
+		auto start = BenchmarkClock::now();
+		for (uint32_t i = 0; i < jobCount; i++)
+		{
+			jobSystem.run([]() {}, &counter);
+		}
+		jobSystem.wait(counter);
+		std::cout << "  spawn + run empty job:        " << millisecondsSince(start) * 1000000.0 / jobCount << " ns/job" << std::endl;
+	}
+
+	// Jobs spawning jobs: mostly run from the spawning worker's own queue, little stealing
+	{
+		JobCounter counter;
+		std::atomic<uint32_t> done(0);
+		const uint32_t fanOut = 1000;
+		auto start = BenchmarkClock::now();
+		for (uint32_t i = 0; i < jobCount / fanOut; i++)
+		{
+			jobSystem.run([&counter, &done]() {
+				for (uint32_t j = 0; j < fanOut; j++)
+				{
+					jobSystem.run([&done]() { done++; }, &counter);
+				}
+			}, &counter);
+		}
+		jobSystem.wait(counter);
+		std::cout << "  nested spawn (local queues):  " << millisecondsSince(start) * 1000000.0 / jobCount << " ns/job" << std::endl;
+	}
+
+	// Steal contention: one job queues everything on one worker's deque, every other thread has to steal
+	{
+		JobCounter counter;
+		JobCounter spawner;
+		std::atomic<uint32_t> done(0);
+		auto start = BenchmarkClock::now();
+		jobSystem.run([&counter, &done]() {
+			for (uint32_t i = 0; i < jobCount; i++)
+			{
+				jobSystem.run([&done]() { done++; }, &counter);
+			}
+		}, &spawner);
+		jobSystem.wait(spawner);
+		jobSystem.wait(counter);
+		std::cout << "  single producer, all steal:   " << millisecondsSince(start) * 1000000.0 / jobCount << " ns/job" << std::endl;
+	}
+
+	// Dependencies: a chain where each job only starts once the previous one is done
+	{
+		const uint32_t chainLength = 100000;
+		std::vector<std::unique_ptr<JobCounter>> counters;
+		for (uint32_t i = 0; i < chainLength; i++)
+		{
+			counters.emplace_back(new JobCounter());
+		}
+		auto start = BenchmarkClock::now();
+		for (uint32_t i = 0; i < chainLength; i++)
+		{
+			jobSystem.run([]() {}, counters[i].get(), i > 0 ? counters[i - 1].get() : nullptr);
+		}
+		jobSystem.wait(*counters.back());
+		double chain = millisecondsSince(start);
+		for (auto &counter : counters)
+		{
+			jobSystem.wait(*counter);
+		}
+		std::cout << "  dependency chain:             " << chain * 1000000.0 / chainLength << " ns/job" << std::endl;
+	}
+
+	// Scaling: parallelFor over some real work vs the same work on one thread
+	{
+		const uint32_t itemCount = 1 << 22;
+		std::vector<float> values(itemCount, 1.0f);
+		auto work = [&values](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; i++)
+			{
+				values[i] = std::sqrt(values[i] * 1.0001f + 0.5f);
+			}
+		};
+
+		auto start = BenchmarkClock::now();
+		work(0, itemCount);
+		double serial = millisecondsSince(start);
+
+		JobCounter counter;
+		start = BenchmarkClock::now();
+		jobSystem.parallelFor(itemCount, 16384, work, counter);
+		jobSystem.wait(counter);
+		double parallel = millisecondsSince(start);
+		std::cout << "  parallelFor speed up:         " << serial / parallel << "x (" << serial << " ms -> " << parallel << " ms)" << std::endl;
+	}
+}
+
+// Throughput of the batch transform kernels at every SIMD level the CPU has, against plain GLM (scalar level)
+static void runTransformBenchmark()
+{
+	// Small enough to stay in L2, so this measures the kernels and not memory bandwidth
+	const size_t vectorCount = 1 << 14;
+	const size_t matrixCount = 1 << 12;
+	const int runs = 200;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+	glm::mat4 transform = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 2.0f, 3.0f)), 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+	std::vector<glm::vec3> points(vectorCount), pointsOut(vectorCount);
+	std::vector<glm::vec4> vectors(vectorCount), vectorsOut(vectorCount);
+	std::vector<glm::mat4> matricesA(matrixCount), matricesB(matrixCount), matricesOut(matrixCount);
+	for (size_t i = 0; i < vectorCount; i++)
+	{
+		points[i] = glm::vec3(value(random), value(random), value(random));
+		vectors[i] = glm::vec4(points[i], 1.0f);
+	}
+	for (size_t i = 0; i < matrixCount; i++)
+	{
+		matricesA[i] = glm::rotate(transform, value(random), glm::vec3(0.0f, 0.0f, 1.0f));
+		matricesB[i] = glm::translate(transform, points[i]);
+	}
+
+	// Best of several runs, in millions of elements per second
+	const double vectorMillions = vectorCount / 1000000.0;
+	const double matrixMillions = matrixCount / 1000000.0;
+
+	std::cout << "Batch transforms (M elements/s), CPU supports " << getSimdLevelName(getCpuSimdLevel()) << ":" << std::endl;
+	std::cout << "  level    vec3 points  vec4  mat4*mat4" << std::endl;
+	for (int level = static_cast<int>(SimdLevel::Scalar); level <= static_cast<int>(getCpuSimdLevel()); level++)
+	{
+		setBatchTransformLevel(static_cast<SimdLevel>(level));
+		double pointRate = vectorMillions / bestTime(runs, [&]() { transformPoints(transform, points.data(), pointsOut.data(), vectorCount); });
+		double vectorRate = vectorMillions / bestTime(runs, [&]() { transformVectors(transform, vectors.data(), vectorsOut.data(), vectorCount); });
+		double matrixRate = matrixMillions / bestTime(runs, [&]() { multiplyMatrices(matricesA.data(), matricesB.data(), matricesOut.data(), matrixCount); });
+		std::cout << "  " << getSimdLevelName(getBatchTransformLevel()) << "\t   " << pointRate << "\t" << vectorRate << "\t" << matrixRate << std::endl;
+	}
+	setBatchTransformLevel(getCpuSimdLevel());
+}
+
+// Throughput of the frustum culling kernels for each instruction set the CPU has, conservative and exact
+static void runCullBenchmark()
+{
+	const size_t objectCount = 1 << 14;
+	const int runs = 200;
+
+	// Same camera as the renderer, objects scattered all around it (about a tenth end up visible)
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+	projection[1][1] *= -1;
+	glm::vec3 eye(3.0f, 1.0f, 2.0f);
+	Frustum frustum = makeFrustum(projection * glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> size(0.1f, 4.0f);
+	std::vector<glm::vec4> spheres(objectCount);
+	std::vector<glm::vec3> centers(objectCount), extents(objectCount);
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		centers[i] = eye + glm::vec3(position(random), position(random), position(random));
+		extents[i] = glm::vec3(size(random), size(random), size(random));
+		spheres[i] = glm::vec4(centers[i], glm::length(extents[i]));
+	}
+	std::vector<uint32_t> visible((objectCount + 31) / 32);
+
+	// Best of several runs, in millions of objects per second
+	const double objectMillions = objectCount / 1000000.0;
+
+	std::vector<std::pair<const char *, const FrustumKernels *>> kernelSets = { { "SSE", &getFrustumKernelsSse() } };
+#ifdef SIMD_X86
+	if (getCpuSimdLevel() >= SimdLevel::AVX2)
+	{
+		kernelSets.push_back({ "AVX2", &getFrustumKernelsAvx2() });
+	}
+#endif
+
+	std::cout << "Frustum culling of " << objectCount << " objects (M objects/s):" << std::endl;
+	std::cout << "  level    spheres  exact    boxes  exact" << std::endl;
+	for (const auto &kernels : kernelSets)
+	{
+		std::cout << "  " << kernels.first << "\t   ";
+		for (int shape = 0; shape < 2; shape++)
+		{
+			for (CullPrecision precision : { CullPrecision::Conservative, CullPrecision::Exact })
+			{
+				double rate = objectMillions / bestTime(runs, [&]() {
+					if (shape == 0)
+					{
+						kernels.second->cullSpheres(frustum, spheres.data(), objectCount, visible.data(), precision);
+					}
+					else
+					{
+						kernels.second->cullAabbs(frustum, centers.data(), extents.data(), objectCount, visible.data(), precision);
+					}
+				});
+				std::cout << rate << "\t";
+			}
+		}
+		std::cout << std::endl;
+	}
+
+	std::cout << "  visible: " << cullSpheres(frustum, spheres.data(), objectCount, visible.data()) << " / "
+		<< cullSpheres(frustum, spheres.data(), objectCount, visible.data(), CullPrecision::Exact) << " spheres, "
+		<< cullAabbs(frustum, centers.data(), extents.data(), objectCount, visible.data()) << " / "
+		<< cullAabbs(frustum, centers.data(), extents.data(), objectCount, visible.data(), CullPrecision::Exact) << " boxes" << std::endl;
+}
+
+// Throughput and accuracy of the quaternion kernels for each instruction set the CPU has, against plain GLM
+static void runQuatBenchmark()
+{
+	// Small enough to stay in L2
+	const size_t quatCount = 1 << 12;
+	const size_t blockCount = getQuatBlockCount(quatCount);
+	const int runs = 200;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> weight(0.0f, 1.0f);
+	std::vector<glm::quat> rotationsA(quatCount), rotationsB(quatCount);
+	std::vector<glm::vec3> translationsA(quatCount), translationsB(quatCount);
+	for (size_t i = 0; i < quatCount; i++)
+	{
+		rotationsA[i] = glm::normalize(glm::quat(value(random), value(random), value(random), value(random)));
+		rotationsB[i] = glm::normalize(glm::quat(value(random), value(random), value(random), value(random)));
+		translationsA[i] = glm::vec3(value(random), value(random), value(random));
+		translationsB[i] = glm::vec3(value(random), value(random), value(random));
+	}
+	std::vector<float> weights(blockCount * 8);
+	for (auto &t : weights)
+	{
+		t = weight(random);
+	}
+
+	std::vector<QuatBlock> a(blockCount), b(blockCount), out(blockCount), reference(blockCount);
+	std::vector<DualQuatBlock> dualA(blockCount), dualB(blockCount), dualOut(blockCount), dualReference(blockCount);
+	std::vector<glm::mat4> matrices(quatCount), matrixReference(quatCount);
+	packQuats(rotationsA.data(), quatCount, a.data());
+	packQuats(rotationsB.data(), quatCount, b.data());
+	packDualQuats(rotationsA.data(), translationsA.data(), quatCount, dualA.data());
+	packDualQuats(rotationsB.data(), translationsB.data(), quatCount, dualB.data());
+
+	// Best of several runs, in millions of quaternions per second
+	const double quatMillions = quatCount / 1000000.0;
+
+	// Largest difference from the scalar results
+	auto maxError = [](const float *result, const float *expected, size_t floatCount) {
+		float error = 0.0f;
+		for (size_t i = 0; i < floatCount; i++)
+		{
+			error = std::max(error, std::fabs(result[i] - expected[i]));
+		}
+		return error;
+	};
+
+	const BatchQuatKernels &scalar = getBatchQuatKernelsScalar();
+	scalar.slerpQuats(a.data(), b.data(), weights.data(), reference.data(), blockCount);
+	scalar.blendDualQuats(dualA.data(), dualB.data(), weights.data(), dualReference.data(), blockCount);
+	scalar.dualQuatsToMatrices(dualA.data(), quatCount, matrixReference.data());
+
+	std::vector<std::pair<const char *, const BatchQuatKernels *>> kernelSets = { { "Scalar", &scalar }, { "SSE", &getBatchQuatKernelsSse() } };
+#ifdef SIMD_X86
+	if (getCpuSimdLevel() >= SimdLevel::AVX2)
+	{
+		kernelSets.push_back({ "AVX2", &getBatchQuatKernelsAvx2() });
+	}
+#endif
+
+	std::cout << "Quaternion kernels (M quaternions/s, max error against the scalar glm results in brackets):" << std::endl;
+	std::cout << "  level    slerp  nlerp  dual quat blend  quat->mat4  dual quat->mat4" << std::endl;
+	for (const auto &kernels : kernelSets)
+	{
+		const BatchQuatKernels &k = *kernels.second;
+		double slerpRate = quatMillions / bestTime(runs, [&]() { k.slerpQuats(a.data(), b.data(), weights.data(), out.data(), blockCount); });
+		float slerpError = maxError(out[0].x, reference[0].x, blockCount * 32);
+		double nlerpRate = quatMillions / bestTime(runs, [&]() { k.nlerpQuats(a.data(), b.data(), weights.data(), out.data(), blockCount); });
+		double blendRate = quatMillions / bestTime(runs, [&]() { k.blendDualQuats(dualA.data(), dualB.data(), weights.data(), dualOut.data(), blockCount); });
+		float blendError = maxError(dualOut[0].real.x, dualReference[0].real.x, blockCount * 64);
+		double matrixRate = quatMillions / bestTime(runs, [&]() { k.quatsToMatrices(a.data(), quatCount, matrices.data()); });
+		double dualMatrixRate = quatMillions / bestTime(runs, [&]() { k.dualQuatsToMatrices(dualA.data(), quatCount, matrices.data()); });
+		float dualMatrixError = maxError(&matrices[0][0][0], &matrixReference[0][0][0], quatCount * 16);
+
+		std::cout << "  " << kernels.first << "\t   " << slerpRate << " (" << slerpError << ")\t" << nlerpRate << "\t"
+			<< blendRate << " (" << blendError << ")\t" << matrixRate << "\t" << dualMatrixRate << " (" << dualMatrixError << ")" << std::endl;
+	}
+}
+
+// Throughput of the bulk packing functions for each instruction set the CPU has, checked against glm/gtc/packing.hpp
+static void runPackBenchmark()
+{
+	// Small enough to stay in L2
+	const size_t valueCount = 1 << 14;
+	const size_t vectorCount = valueCount / 4;
+	const int runs = 200;
+
+	// Half: magnitudes from below the smallest subnormal to above the largest half, snorm / unorm: a bit past the clamp
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> exponent(-26.0f, 17.0f);
+	std::uniform_real_distribution<float> signedValue(-1.1f, 1.1f);
+	std::uniform_real_distribution<float> unsignedValue(-0.1f, 1.1f);
+	std::vector<float> halfInput(valueCount), snormInput(valueCount), unormInput(valueCount);
+	std::vector<glm::vec4> snormVectors(vectorCount), unormVectors(vectorCount);
+	for (size_t i = 0; i < valueCount; i++)
+	{
+		halfInput[i] = std::exp2(exponent(random)) * (i % 2 == 0 ? 1.0f : -1.0f);
+		snormInput[i] = signedValue(random);
+		unormInput[i] = unsignedValue(random);
+	}
+	std::memcpy(snormVectors.data(), snormInput.data(), valueCount * sizeof(float));
+	std::memcpy(unormVectors.data(), unormInput.data(), valueCount * sizeof(float));
+
+	// Best of several runs, in GB/s of float data
+	const double floatGigabytes = valueCount * sizeof(float) / 1000000000.0;
+
+	// Values whose bits differ from the glm results
+	auto mismatches = [](const void *result, const void *expected, size_t valueSize, size_t count) {
+		size_t different = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (std::memcmp(static_cast<const char *>(result) + i * valueSize, static_cast<const char *>(expected) + i * valueSize, valueSize) != 0)
+			{
+				different++;
+			}
+		}
+		return different;
+	};
+
+	// glm results, then what each level makes of the same input (packed) and of the glm packed values (unpacked)
+	std::vector<uint16_t> halves(valueCount), glmHalves(valueCount);
+	std::vector<int16_t> snorms(valueCount), glmSnorms(valueCount);
+	std::vector<uint8_t> unorms(valueCount), glmUnorms(valueCount);
+	std::vector<uint32_t> packed(vectorCount), glmSnormPacked(vectorCount), glmUnormPacked(vectorCount);
+	std::vector<float> unpacked(valueCount), glmHalfUnpacked(valueCount), glmSnormUnpacked(valueCount), glmUnormUnpacked(valueCount);
+	std::vector<glm::vec4> unpackedVectors(vectorCount), glmSnormVectors(vectorCount), glmUnormVectors(vectorCount);
+	for (size_t i = 0; i < valueCount; i++)
+	{
+		glmHalves[i] = glm::packHalf1x16(halfInput[i]);
+		glmHalfUnpacked[i] = glm::unpackHalf1x16(glmHalves[i]);
+		glmSnorms[i] = static_cast<int16_t>(glm::packSnorm1x16(snormInput[i]));
+		glmSnormUnpacked[i] = glm::unpackSnorm1x16(static_cast<uint16_t>(glmSnorms[i]));
+		glmUnorms[i] = glm::packUnorm1x8(unormInput[i]);
+		glmUnormUnpacked[i] = glm::unpackUnorm1x8(glmUnorms[i]);
+	}
+	for (size_t i = 0; i < vectorCount; i++)
+	{
+		glmSnormPacked[i] = glm::packSnorm3x10_1x2(snormVectors[i]);
+		glmSnormVectors[i] = glm::unpackSnorm3x10_1x2(glmSnormPacked[i]);
+		glmUnormPacked[i] = glm::packUnorm3x10_1x2(unormVectors[i]);
+		glmUnormVectors[i] = glm::unpackUnorm3x10_1x2(glmUnormPacked[i]);
+	}
+
+	std::vector<std::pair<const char *, const BatchPackKernels *>> kernelSets = { { "Scalar", &getBatchPackKernelsScalar() } };
+#ifdef SIMD_X86
+	if (getCpuSimdLevel() >= SimdLevel::SSE)
+	{
+		kernelSets.push_back({ "SSE", &getBatchPackKernelsSse() });
+	}
+	if (getCpuSimdLevel() >= SimdLevel::AVX2)
+	{
+		kernelSets.push_back({ "AVX2", &getBatchPackKernelsAvx2() });
+	}
+#endif
+
+	std::cout << "Bulk packing (GB/s of floats, pack / unpack; values differing from glm in brackets, pack / unpack)." << std::endl;
+	std::cout << "Half: glm rounds ties away from zero, these round them to even, so some ties differ in the last bit:" << std::endl;
+	std::cout << "  level    half\t\t\tsnorm16\t\t\tunorm8\t\t\tsnorm 10-10-10-2\tunorm 10-10-10-2" << std::endl;
+	for (const auto &kernels : kernelSets)
+	{
+		const BatchPackKernels &k = *kernels.second;
+		std::cout << "  " << kernels.first << "\t";
+
+		double packRate = floatGigabytes / bestTime(runs, [&]() { k.packHalf(halfInput.data(), valueCount, halves.data()); });
+		double unpackRate = floatGigabytes / bestTime(runs, [&]() { k.unpackHalf(glmHalves.data(), valueCount, unpacked.data()); });
+		std::cout << "   " << packRate << " / " << unpackRate << " (" << mismatches(halves.data(), glmHalves.data(), 2, valueCount)
+			<< " / " << mismatches(unpacked.data(), glmHalfUnpacked.data(), 4, valueCount) << ")";
+
+		packRate = floatGigabytes / bestTime(runs, [&]() { k.packSnorm16(snormInput.data(), valueCount, snorms.data()); });
+		unpackRate = floatGigabytes / bestTime(runs, [&]() { k.unpackSnorm16(glmSnorms.data(), valueCount, unpacked.data()); });
+		std::cout << "\t" << packRate << " / " << unpackRate << " (" << mismatches(snorms.data(), glmSnorms.data(), 2, valueCount)
+			<< " / " << mismatches(unpacked.data(), glmSnormUnpacked.data(), 4, valueCount) << ")";
+
+		packRate = floatGigabytes / bestTime(runs, [&]() { k.packUnorm8(unormInput.data(), valueCount, unorms.data()); });
+		unpackRate = floatGigabytes / bestTime(runs, [&]() { k.unpackUnorm8(glmUnorms.data(), valueCount, unpacked.data()); });
+		std::cout << "\t" << packRate << " / " << unpackRate << " (" << mismatches(unorms.data(), glmUnorms.data(), 1, valueCount)
+			<< " / " << mismatches(unpacked.data(), glmUnormUnpacked.data(), 4, valueCount) << ")";
+
+		packRate = floatGigabytes / bestTime(runs, [&]() { k.packSnorm3x10_1x2(snormVectors.data(), vectorCount, packed.data()); });
+		size_t packMismatches = mismatches(packed.data(), glmSnormPacked.data(), 4, vectorCount);
+		unpackRate = floatGigabytes / bestTime(runs, [&]() { k.unpackSnorm3x10_1x2(glmSnormPacked.data(), vectorCount, unpackedVectors.data()); });
+		std::cout << "\t" << packRate << " / " << unpackRate << " (" << packMismatches
+			<< " / " << mismatches(unpackedVectors.data(), glmSnormVectors.data(), 16, vectorCount) << ")";
+
+		packRate = floatGigabytes / bestTime(runs, [&]() { k.packUnorm3x10_1x2(unormVectors.data(), vectorCount, packed.data()); });
+		packMismatches = mismatches(packed.data(), glmUnormPacked.data(), 4, vectorCount);
+		unpackRate = floatGigabytes / bestTime(runs, [&]() { k.unpackUnorm3x10_1x2(glmUnormPacked.data(), vectorCount, unpackedVectors.data()); });
+		std::cout << "\t" << packRate << " / " << unpackRate << " (" << packMismatches
+			<< " / " << mismatches(unpackedVectors.data(), glmUnormVectors.data(), 16, vectorCount) << ")" << std::endl;
+	}
+
+	// Round trip through each format: worst error against the original floats (in range ones, for half)
+	float halfError = 0.0f, snormError = 0.0f, unormError = 0.0f;
+	packHalfArray(halfInput.data(), valueCount, halves.data());
+	unpackHalfArray(halves.data(), valueCount, unpacked.data());
+	for (size_t i = 0; i < valueCount; i++)
+	{
+		float magnitude = std::fabs(halfInput[i]);
+		if (magnitude >= 6.103515625e-5f && magnitude <= 65504.0f)
+		{
+			halfError = std::max(halfError, std::fabs(unpacked[i] - halfInput[i]) / magnitude);
+		}
+	}
+	packSnorm16Array(snormInput.data(), valueCount, snorms.data());
+	unpackSnorm16Array(snorms.data(), valueCount, unpacked.data());
+	for (size_t i = 0; i < valueCount; i++)
+	{
+		snormError = std::max(snormError, std::fabs(unpacked[i] - glm::clamp(snormInput[i], -1.0f, 1.0f)));
+	}
+	packUnorm8Array(unormInput.data(), valueCount, unorms.data());
+	unpackUnorm8Array(unorms.data(), valueCount, unpacked.data());
+	for (size_t i = 0; i < valueCount; i++)
+	{
+		unormError = std::max(unormError, std::fabs(unpacked[i] - glm::clamp(unormInput[i], 0.0f, 1.0f)));
+	}
+	std::cout << "  round trip: half " << halfError << " (relative), snorm16 " << snormError << ", unorm8 " << unormError << std::endl;
+}
+
+// Mesh optimizer on a big grid: vertex cache stats before/after and time, on this thread and over the job system
+static void runMeshBenchmark()
+{
+	const uint32_t gridSize = 1000;			// 2M triangles: split into chunks
+
+	std::vector<Vertex> gridVertices;
+	std::vector<uint32_t> gridIndices;
+	for (uint32_t y = 0; y <= gridSize; y++)
+	{
+		for (uint32_t x = 0; x <= gridSize; x++)
+		{
+			gridVertices.push_back({ glm::vec3(x, y, std::sin(x * 0.1f)), glm::vec3(1.0f) });
+		}
+	}
+	for (uint32_t y = 0; y < gridSize; y++)
+	{
+		for (uint32_t x = 0; x < gridSize; x++)
+		{
+			uint32_t corner = y * (gridSize + 1) + x;
+			uint32_t quad[6] = { corner, corner + 1, corner + gridSize + 2, corner + gridSize + 2, corner + gridSize + 1, corner };
+			gridIndices.insert(gridIndices.end(), quad, quad + 6);
+		}
+	}
+
+	// Same grid with triangles and vertices in random order (worst case input)
+	std::mt19937 random(1234);
+	std::vector<uint32_t> triangleOrder(gridIndices.size() / 3);
+	std::vector<uint32_t> vertexOrder(gridVertices.size());
+	for (uint32_t i = 0; i < triangleOrder.size(); i++) { triangleOrder[i] = i; }
+	for (uint32_t i = 0; i < vertexOrder.size(); i++) { vertexOrder[i] = i; }
+	std::shuffle(triangleOrder.begin(), triangleOrder.end(), random);
+	std::shuffle(vertexOrder.begin(), vertexOrder.end(), random);
+	std::vector<Vertex> shuffledVertices(gridVertices.size());
+	std::vector<uint32_t> shuffledIndices;
+	for (size_t v = 0; v < gridVertices.size(); v++)
+	{
+		shuffledVertices[vertexOrder[v]] = gridVertices[v];
+	}
+	for (uint32_t triangle : triangleOrder)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			shuffledIndices.push_back(vertexOrder[gridIndices[triangle * 3 + corner]]);
+		}
+	}
+
+	std::cout << "Mesh optimizer, " << gridSize << "x" << gridSize << " grid (" << gridIndices.size() / 3 << " triangles, "
+		<< k_vertexCacheSize << " entry cache):" << std::endl;
+	auto run = [](const char *name, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices)
+	{
+		MeshOptimizeStats stats;
+		double times[2];
+		JobSystem *jobSystems[2] = { nullptr, &jobSystem };
+		for (int i = 0; i < 2; i++)
+		{
+			std::vector<Vertex> optimizedVertices = vertices;
+			std::vector<uint32_t> optimizedIndices = indices;
+			auto start = BenchmarkClock::now();
+			stats = optimizeMesh(optimizedVertices, optimizedIndices, jobSystems[i]);
+			times[i] = millisecondsSince(start);
+		}
+		std::cout << "  " << name << ": ACMR " << stats.before.acmr << " -> " << stats.after.acmr
+			<< ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr
+			<< ", " << times[0] << " ms (" << times[1] << " ms with " << jobSystem.getWorkerCount() + 1 << " threads)" << std::endl;
+	};
+	run("row by row", gridVertices, gridIndices);
+	run("shuffled  ", shuffledVertices, shuffledIndices);
+}
+
+// Meshlets of a big sphere: build time, fill, and how many the GPU test culls from a few viewpoints
+static void runMeshletBenchmark()
+{
+	const uint32_t rings = 500;
+	const uint32_t segments = 1000;			// ~1M triangles
+
+	std::vector<Vertex> sphereVertices;
+	std::vector<uint32_t> sphereIndices;
+	for (uint32_t ring = 0; ring <= rings; ring++)
+	{
+		for (uint32_t segment = 0; segment <= segments; segment++)
+		{
+			float theta = glm::pi<float>() * ring / rings;
+			float phi = 2.0f * glm::pi<float>() * segment / segments;
+			glm::vec3 position(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			sphereVertices.push_back({ position, glm::vec3(1.0f) });
+		}
+	}
+	for (uint32_t ring = 0; ring < rings; ring++)
+	{
+		for (uint32_t segment = 0; segment < segments; segment++)
+		{
+			uint32_t corner = ring * (segments + 1) + segment;
+			uint32_t quad[6] = { corner, corner + 1, corner + segments + 1, corner + 1, corner + segments + 2, corner + segments + 1 };
+			sphereIndices.insert(sphereIndices.end(), quad, quad + 6);		// Counter clockwise seen from outside
+		}
+	}
+	optimizeMesh(sphereVertices, sphereIndices, &jobSystem);
+
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshletData;
+	auto start = BenchmarkClock::now();
+	buildMeshlets(sphereVertices.data(), sphereIndices.data(), 0, static_cast<uint32_t>(sphereIndices.size()), 0, meshlets, meshletData);
+	double buildTime = millisecondsSince(start);
+
+	size_t meshletVertices = 0;
+	size_t withCone = 0;
+	for (const auto &meshlet : meshlets)
+	{
+		meshletVertices += meshlet.vertexCount;
+		withCone += meshlet.coneCutoff < 1.0f ? 1 : 0;
+	}
+	std::cout << "Meshlets, sphere of " << sphereIndices.size() / 3 << " triangles (at most " << k_meshletMaxVertices << " vertices, "
+		<< k_meshletMaxTriangles << " triangles each):" << std::endl;
+	std::cout << "  " << meshlets.size() << " meshlets in " << buildTime << " ms, " << static_cast<double>(sphereIndices.size() / 3) / meshlets.size()
+		<< " triangles and " << static_cast<double>(meshletVertices) / meshlets.size() << " vertices each on average, "
+		<< withCone << " with a usable cone" << std::endl;
+
+	// Visible meshlets as the renderer's camera would see the sphere, and whether any culled one still had a front face
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.1f, 100.0f);
+	projection[1][1] *= -1;
+	const glm::vec3 cameraPositions[] = { glm::vec3(0.0f, 0.0f, 4.0f), glm::vec3(3.0f, 1.0f, 2.0f), glm::vec3(1.2f, 0.0f, 0.5f) };
+	for (const auto &cameraPosition : cameraPositions)
+	{
+		glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		Frustum frustum = makeFrustum(projection * view);
+		glm::mat4 world(1.0f);
+
+		size_t visible = 0;
+		size_t wronglyCulled = 0;
+		start = BenchmarkClock::now();
+		for (const auto &meshlet : meshlets)
+		{
+			visible += isMeshletVisible(meshlet, world, frustum.planes, cameraPosition, true) ? 1 : 0;
+		}
+		double cullTime = millisecondsSince(start);
+
+		for (const auto &meshlet : meshlets)
+		{
+			if (isMeshletVisible(meshlet, world, frustum.planes, cameraPosition, true) ||
+				!isMeshletVisible(meshlet, world, frustum.planes, cameraPosition, false))
+			{
+				continue;						// Visible, or culled by the frustum alone
+			}
+			for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+			{
+				glm::vec3 a = sphereVertices[sphereIndices[i]].a_position;
+				glm::vec3 b = sphereVertices[sphereIndices[i + 1]].a_position;
+				glm::vec3 c = sphereVertices[sphereIndices[i + 2]].a_position;
+				if (glm::dot(glm::cross(b - a, c - a), cameraPosition - a) > 0.0f)
+				{
+					wronglyCulled++;
+					break;
+				}
+			}
+		}
+		std::cout << "  camera at (" << cameraPosition.x << ", " << cameraPosition.y << ", " << cameraPosition.z << "): "
+			<< visible << " visible (" << 100.0 * visible / meshlets.size() << "%), tested in " << cullTime << " ms, "
+			<< wronglyCulled << " culled with a front face" << std::endl;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t sceneNodes = 0;
+	bool jobs = false;
+	bool transform = false;
+	bool cull = false;
+	bool quat = false;
+	bool pack = false;
+	bool mesh = false;
+	bool meshlet = false;
+	uint32_t workerCount = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--scene" && i + 1 < argc)
+		{
+			sceneNodes = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+		}
+		else if (arg == "--jobs")
+		{
+			jobs = true;
+		}
+		else if (arg == "--transform")
+		{
+			transform = true;
+		}
+		else if (arg == "--cull")
+		{
+			cull = true;
+		}
+		else if (arg == "--quat")
+		{
+			quat = true;
+		}
+		else if (arg == "--pack")
+		{
+			pack = true;
+		}
+		else if (arg == "--mesh")
+		{
+			mesh = true;
+		}
+		else if (arg == "--meshlet")
+		{
+			meshlet = true;
+		}
+		else if (arg == "--workers" && i + 1 < argc)
+		{
+			workerCount = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+		}
+		else
+		{
+			std::cout << "Unknown argument: " << arg << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (sceneNodes == 0 && !jobs && !transform && !cull && !quat && !pack && !mesh && !meshlet)
+	{
+		sceneNodes = 100000;
+		jobs = transform = cull = quat = pack = mesh = meshlet = true;
+	}
+
+	jobSystem.init(workerCount);
+	if (sceneNodes > 0)
+	{
+		runSceneBenchmark(sceneNodes);
+	}
+	if (jobs)
+	{
+		runJobBenchmark();
+	}
+	if (transform)
+	{
+		runTransformBenchmark();
+	}
+	if (cull)
+	{
+		runCullBenchmark();
+	}
+	if (quat)
+	{
+		runQuatBenchmark();
+	}
+	if (pack)
+	{
+		runPackBenchmark();
+	}
+	if (mesh)
+	{
+		runMeshBenchmark();
+	}
+	if (meshlet)
+	{
+		runMeshletBenchmark();
+	}
+	jobSystem.destroy();
+
+	return 0;
+}
@@ -0,0 +1,260 @@
+// Times the GLM functions the renderer leans on (matrix, quaternion, packing and geometric) in one GLM configuration and
+// writes the numbers as JSON, so configurations can be compared before picking compile flags.
+//
+// The configuration is fixed at compile time (GLM_FORCE_* change the inline functions, so two of them can't share one
+// executable). The project builds the one in the GlmConfig property:
+//	Default		no GLM_FORCE_* defines (what the renderer uses)
+//	Intrinsics	GLM_FORCE_INTRINSICS: GLM's SIMD code, most of which only kicks in for aligned types
+//	Aligned		GLM_FORCE_INTRINSICS + GLM_FORCE_DEFAULT_ALIGNED_GENTYPES: vec / mat / quat are aligned, the SIMD paths are used
+//	Pure		GLM_FORCE_PURE: plain C++, no intrinsics at all
+// e.g.	msbuild VulkanCourseApp.sln /t:GlmBenchmark /p:Configuration=Release /p:Platform=x64 /p:GlmConfig=Aligned
+//		x64\Release\GlmBenchmark-Aligned.exe [output.json]		(default output: glm_benchmark_aligned.json)
+// Add /arch:AVX2 to the compiler options to let GLM use AVX / AVX2 as well; the JSON records what GLM ended up using.
+
+#if defined(GLM_FORCE_PURE)
+#define GLM_BENCHMARK_CONFIG "pure"
+#elif defined(GLM_FORCE_DEFAULT_ALIGNED_GENTYPES)
+#define GLM_BENCHMARK_CONFIG "aligned"
+#elif defined(GLM_FORCE_INTRINSICS)
+#define GLM_BENCHMARK_CONFIG "intrinsics"
+#else
+#define GLM_BENCHMARK_CONFIG "default"
+#endif
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdlib>
+
+#include "BenchmarkTiming.h"
+
+
+struct BenchmarkResult
+{
+	const char *group;
+	const char *name;
+	double nsPerCall;
+};
+
+// Inputs: small enough to stay in L2, indexed so no call can be worked out at compile time
+static const size_t c_inputCount = 1024;
+static const int c_runs = 200;
+
+struct BenchmarkData
+{
+	std::vector<glm::mat4> matrices;
+	std::vector<glm::vec4> vec4s;
+	std::vector<glm::vec3> vec3s, axes;
+	std::vector<glm::quat> quats;
+	std::vector<float> scalars;
+
+	// Outputs, read back into the checksum so nothing gets optimized away
+	std::vector<glm::mat4> matrixOut;
+	std::vector<glm::vec4> vec4Out;
+	std::vector<glm::vec3> vec3Out;
+	std::vector<glm::quat> quatOut;
+	std::vector<float> floatOut;
+	std::vector<glm::uint64> packedOut;
+};
+
+static std::vector<BenchmarkResult> s_results;
+
+// Best of several runs over all inputs, in nanoseconds per call
+template<typename Call>
+static void measure(const char *group, const char *name, Call call)
+{
+	double best = bestTime(c_runs, [&call]() {
+		for (size_t i = 0; i < c_inputCount; i++)
+		{
+			call(i);
+		}
+	});
+	s_results.push_back({ group, name, best / c_inputCount * 1e9 });
+}
+
+static size_t next(size_t i)
+{
+	return (i + 1) % c_inputCount;
+}
+
+static void runMatrixBenchmarks(BenchmarkData &d)
+{
+	const char *group = "matrix";
+	measure(group, "mat4 * mat4", [&](size_t i) { d.matrixOut[i] = d.matrices[i] * d.matrices[next(i)]; });
+	measure(group, "mat4 * vec4", [&](size_t i) { d.vec4Out[i] = d.matrices[i] * d.vec4s[i]; });
+	measure(group, "inverse(mat4)", [&](size_t i) { d.matrixOut[i] = glm::inverse(d.matrices[i]); });
+	measure(group, "transpose(mat4)", [&](size_t i) { d.matrixOut[i] = glm::transpose(d.matrices[i]); });
+	measure(group, "translate", [&](size_t i) { d.matrixOut[i] = glm::translate(d.matrices[i], d.vec3s[i]); });
+	measure(group, "rotate", [&](size_t i) { d.matrixOut[i] = glm::rotate(d.matrices[i], d.scalars[i], d.axes[i]); });
+	measure(group, "scale", [&](size_t i) { d.matrixOut[i] = glm::scale(d.matrices[i], d.vec3s[i]); });
+	measure(group, "perspective", [&](size_t i) { d.matrixOut[i] = glm::perspective(0.5f + d.scalars[i], 1.5f, 0.1f, 100.0f); });
+	measure(group, "lookAt", [&](size_t i) { d.matrixOut[i] = glm::lookAt(d.vec3s[i], d.vec3s[next(i)], glm::vec3(0.0f, 1.0f, 0.0f)); });
+}
+
+static void runQuaternionBenchmarks(BenchmarkData &d)
+{
+	const char *group = "quaternion";
+	measure(group, "quat * quat", [&](size_t i) { d.quatOut[i] = d.quats[i] * d.quats[next(i)]; });
+	measure(group, "quat * vec3", [&](size_t i) { d.vec3Out[i] = d.quats[i] * d.vec3s[i]; });
+	measure(group, "normalize(quat)", [&](size_t i) { d.quatOut[i] = glm::normalize(d.quats[i]); });
+	measure(group, "slerp", [&](size_t i) { d.quatOut[i] = glm::slerp(d.quats[i], d.quats[next(i)], d.scalars[i] * 0.5f); });
+	measure(group, "angleAxis", [&](size_t i) { d.quatOut[i] = glm::angleAxis(d.scalars[i], d.axes[i]); });
+	measure(group, "mat4_cast", [&](size_t i) { d.matrixOut[i] = glm::mat4_cast(d.quats[i]); });
+	measure(group, "quat_cast", [&](size_t i) { d.quatOut[i] = glm::quat_cast(d.matrixOut[i]); });		// Of the mat4_cast results
+}
+
+static void runPackingBenchmarks(BenchmarkData &d)
+{
+	const char *group = "packing";
+	measure(group, "packHalf4x16", [&](size_t i) { d.packedOut[i] = glm::packHalf4x16(d.vec4s[i]); });
+	measure(group, "unpackHalf4x16", [&](size_t i) { d.vec4Out[i] = glm::unpackHalf4x16(d.packedOut[i]); });
+	measure(group, "packSnorm4x16", [&](size_t i) { d.packedOut[i] = glm::packSnorm4x16(d.vec4s[i]); });
+	measure(group, "unpackSnorm4x16", [&](size_t i) { d.vec4Out[i] = glm::unpackSnorm4x16(d.packedOut[i]); });
+	measure(group, "packUnorm4x8", [&](size_t i) { d.packedOut[i] = glm::packUnorm4x8(d.vec4s[i]); });
+	measure(group, "unpackUnorm4x8", [&](size_t i) { d.vec4Out[i] = glm::unpackUnorm4x8(static_cast<glm::uint32>(d.packedOut[i])); });
+	measure(group, "packSnorm3x10_1x2", [&](size_t i) { d.packedOut[i] = glm::packSnorm3x10_1x2(d.vec4s[i]); });
+	measure(group, "unpackSnorm3x10_1x2", [&](size_t i) { d.vec4Out[i] = glm::unpackSnorm3x10_1x2(static_cast<glm::uint32>(d.packedOut[i])); });
+}
+
+static void runGeometricBenchmarks(BenchmarkData &d)
+{
+	const char *group = "geometric";
+	measure(group, "dot(vec4)", [&](size_t i) { d.floatOut[i] = glm::dot(d.vec4s[i], d.vec4s[next(i)]); });
+	measure(group, "dot(vec3)", [&](size_t i) { d.floatOut[i] = glm::dot(d.vec3s[i], d.vec3s[next(i)]); });
+	measure(group, "cross", [&](size_t i) { d.vec3Out[i] = glm::cross(d.vec3s[i], d.vec3s[next(i)]); });
+	measure(group, "length(vec3)", [&](size_t i) { d.floatOut[i] = glm::length(d.vec3s[i]); });
+	measure(group, "distance(vec3)", [&](size_t i) { d.floatOut[i] = glm::distance(d.vec3s[i], d.vec3s[next(i)]); });
+	measure(group, "normalize(vec3)", [&](size_t i) { d.vec3Out[i] = glm::normalize(d.vec3s[i]); });
+	measure(group, "normalize(vec4)", [&](size_t i) { d.vec4Out[i] = glm::normalize(d.vec4s[i]); });
+	measure(group, "reflect(vec3)", [&](size_t i) { d.vec3Out[i] = glm::reflect(d.vec3s[i], d.axes[i]); });
+}
+
+static std::string getArchName()
+{
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+	return "AVX2";
+#elif GLM_ARCH & GLM_ARCH_AVX_BIT
+	return "AVX";
+#elif GLM_ARCH & GLM_ARCH_SSE42_BIT
+	return "SSE4.2";
+#elif GLM_ARCH & GLM_ARCH_SSE41_BIT
+	return "SSE4.1";
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+	return "SSE2";
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+	return "NEON";
+#else
+	return "none";
+#endif
+}
+
+static std::string getCompilerName()
+{
+#if defined(__clang__)
+	return "clang " __clang_version__;
+#elif defined(_MSC_VER)
+	return "MSVC " + std::to_string(_MSC_VER);
+#elif defined(__GNUC__)
+	return "GCC " __VERSION__;
+#else
+	return "unknown";
+#endif
+}
+
+static bool writeJson(const std::string &path, double checksum)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "{\n";
+	file << "  \"config\": \"" << GLM_BENCHMARK_CONFIG << "\",\n";
+	file << "  \"compiler\": \"" << getCompilerName() << "\",\n";
+	file << "  \"glm\": {\n";
+	file << "    \"version\": " << GLM_VERSION << ",\n";
+	file << "    \"simd\": " << (GLM_CONFIG_SIMD == GLM_ENABLE ? "true" : "false") << ",\n";
+	file << "    \"arch\": \"" << getArchName() << "\",\n";
+	file << "    \"alignedGentypes\": " << (GLM_CONFIG_ALIGNED_GENTYPES == GLM_ENABLE ? "true" : "false") << ",\n";
+	file << "    \"sizeofVec3\": " << sizeof(glm::vec3) << ",\n";
+	file << "    \"alignofMat4\": " << alignof(glm::mat4) << "\n";
+	file << "  },\n";
+	file << "  \"inputCount\": " << c_inputCount << ",\n";
+	file << "  \"runs\": " << c_runs << ",\n";
+	file << "  \"checksum\": " << checksum << ",\n";
+	file << "  \"results\": [\n";
+	for (size_t i = 0; i < s_results.size(); i++)
+	{
+		const BenchmarkResult &result = s_results[i];
+		file << "    { \"group\": \"" << result.group << "\", \"name\": \"" << result.name << "\", \"nsPerCall\": "
+			<< result.nsPerCall << ", \"millionCallsPerSecond\": " << 1000.0 / result.nsPerCall << " }"
+			<< (i + 1 < s_results.size() ? "," : "") << "\n";
+	}
+	file << "  ]\n";
+	file << "}\n";
+	return static_cast<bool>(file);
+}
+
+int main(int argc, char **argv)
+{
+	std::string outputPath = argc > 1 ? argv[1] : std::string("glm_benchmark_") + GLM_BENCHMARK_CONFIG + ".json";
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+	auto randomVec3 = [&]() { return glm::vec3(value(random), value(random), value(random)); };
+
+	BenchmarkData d;
+	for (size_t i = 0; i < c_inputCount; i++)
+	{
+		// Well conditioned transforms, like the scene's
+		glm::mat4 m = glm::translate(glm::mat4(1.0f), randomVec3() * 10.0f);
+		m = glm::rotate(m, value(random) * 3.0f, glm::normalize(randomVec3() + glm::vec3(0.0f, 0.0f, 2.0f)));
+		d.matrices.push_back(glm::scale(m, glm::vec3(1.5f) + randomVec3()));
+		d.vec4s.push_back(glm::vec4(randomVec3(), value(random)));
+		d.vec3s.push_back(randomVec3() * 10.0f);
+		d.axes.push_back(glm::normalize(randomVec3() + glm::vec3(2.0f, 0.0f, 0.0f)));
+		d.quats.push_back(glm::normalize(glm::quat(value(random), value(random), value(random), value(random))));
+		d.scalars.push_back(value(random) * 0.5f + 0.5f);
+	}
+	d.matrixOut = d.matrices;
+	d.vec4Out = d.vec4s;
+	d.vec3Out = d.vec3s;
+	d.quatOut = d.quats;
+	d.floatOut = d.scalars;
+	d.packedOut.assign(c_inputCount, 0);
+
+	runMatrixBenchmarks(d);
+	runQuaternionBenchmarks(d);
+	runPackingBenchmarks(d);
+	runGeometricBenchmarks(d);
+
+	double checksum = 0.0;
+	for (size_t i = 0; i < c_inputCount; i++)
+	{
+		checksum += d.matrixOut[i][3][0] + d.vec4Out[i].x + d.vec3Out[i].y + d.quatOut[i].w + d.floatOut[i] + static_cast<double>(d.packedOut[i] & 0xFF);
+	}
+
+	std::cout << "GLM " << GLM_BENCHMARK_CONFIG << " configuration (SIMD " << (GLM_CONFIG_SIMD == GLM_ENABLE ? getArchName() : "off")
+		<< "), ns per call:" << std::endl;
+	for (const BenchmarkResult &result : s_results)
+	{
+		std::cout << "  " << result.group << "\t" << result.name << "\t" << result.nsPerCall << std::endl;
+	}
+
+	if (!writeJson(outputPath, checksum))
+	{
+		std::cout << "Failed to write " << outputPath << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "Written to " << outputPath << std::endl;
+	return EXIT_SUCCESS;
+}